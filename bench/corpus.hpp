@@ -0,0 +1,230 @@
+#pragma once
+
+//
+// CORPUS
+// --------
+//  Deterministic generators for the benchmark inputs. Every document is built from a fixed seed with a
+//  splitmix64 stream, so the same scale yields byte identical text on every platform and standard library.
+//  All documents are ASCII, characters outside of it are written as \u escapes, so they can be widened to
+//  any character type one code unit at a time.
+//
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdio>
+
+namespace corpus {
+    class random {
+    public:
+        explicit random(std::uint64_t seed) noexcept
+            : _State(seed)
+        {
+        }
+
+        std::uint64_t next(void) noexcept {
+            std::uint64_t z = (_State += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            return z ^ (z >> 31);
+        }
+
+        std::uint64_t below(std::uint64_t bound) noexcept {
+            return this->next() % bound;
+        }
+
+        double between(double lo, double hi) noexcept {
+            return lo + (hi - lo) * static_cast<double>(this->next() >> 11) * 0x1.0p-53;
+        }
+
+        bool chance(unsigned percent) noexcept {
+            return this->below(100) < percent;
+        }
+
+    private:
+        std::uint64_t _State;
+    };
+
+    struct document {
+        std::string name;
+        std::string text;
+    };
+
+    namespace detail {
+        inline constexpr std::string_view words[] = {
+            "json", "parser", "stream", "value", "object", "array", "token", "buffer", "thread", "cache",
+            "latency", "release", "build", "morning", "coffee", "deploy", "weekend", "review", "merge", "shard",
+        };
+
+        inline void floating(std::string& out, double value) {
+            char buffer[32];
+            const int length = std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+            out.append(buffer, static_cast<std::size_t>(length));
+        }
+
+        inline void number(std::string& out, std::uint64_t value) {
+            out += std::to_string(value);
+        }
+
+        inline void sentence(std::string& out, random& rng, std::size_t words) {
+            for (std::size_t i = 0; i < words; ++i) {
+                if (i != 0) {
+                    out += ' ';
+                }
+                out += detail::words[rng.below(std::size(detail::words))];
+                switch (rng.below(16)) {
+                case 0: out += "\\n"; break;
+                case 1: out += "\\\"quoted\\\""; break;
+                case 2: out += " \\u00e9t\\u00e9"; break;
+                case 3: out += " \\ud83d\\ude00"; break;
+                default: break;
+                }
+            }
+        }
+
+        inline void handle(std::string& out, random& rng) {
+            out += detail::words[rng.below(std::size(detail::words))];
+            out += '_';
+            detail::number(out, rng.below(10000));
+        }
+    }
+
+    // Array of status objects with nested users, entity lists, mixed types and nulls.
+    inline document twitter(std::size_t statuses) {
+        random rng(0x7477697474657200ull);
+        std::string out = "[";
+        for (std::size_t i = 0; i < statuses; ++i) {
+            if (i != 0) {
+                out += ',';
+            }
+            out += "{\"id\":";
+            detail::number(out, 1000000000000000000ull + rng.below(1000000000000000000ull));
+            out += ",\"created_at\":\"Mon Oct 18 12:";
+            detail::number(out, 10 + rng.below(50));
+            out += ":00 +0000 2026\",\"text\":\"";
+            detail::sentence(out, rng, 8 + rng.below(16));
+            out += "\",\"truncated\":false,\"user\":{\"id\":";
+            detail::number(out, rng.below(4000000000ull));
+            out += ",\"name\":\"";
+            detail::sentence(out, rng, 2);
+            out += "\",\"screen_name\":\"";
+            detail::handle(out, rng);
+            out += "\",\"followers_count\":";
+            detail::number(out, rng.below(100000));
+            out += ",\"verified\":";
+            out += rng.chance(10) ? "true" : "false";
+            out += ",\"lang\":\"en\"},\"entities\":{\"hashtags\":[";
+            for (std::uint64_t n = rng.below(4), k = 0; k < n; ++k) {
+                out += k != 0 ? ",{\"text\":\"" : "{\"text\":\"";
+                detail::handle(out, rng);
+                out += "\",\"indices\":[";
+                detail::number(out, k * 10);
+                out += ',';
+                detail::number(out, k * 10 + 8);
+                out += "]}";
+            }
+            out += "],\"urls\":[]},\"coordinates\":";
+            if (rng.chance(20)) {
+                out += "{\"type\":\"Point\",\"coordinates\":[";
+                detail::floating(out, rng.between(-180.0, 180.0));
+                out += ',';
+                detail::floating(out, rng.between(-90.0, 90.0));
+                out += "]}";
+            }
+            else {
+                out += "null";
+            }
+            out += ",\"retweet_count\":";
+            detail::number(out, rng.below(5000));
+            out += ",\"favorited\":";
+            out += rng.chance(30) ? "true" : "false";
+            out += '}';
+        }
+        out += ']';
+        return { "twitter", std::move(out) };
+    }
+
+    // Feature collection of polygons, almost all of it floating point coordinate pairs.
+    inline document canada(std::size_t rings, std::size_t points) {
+        random rng(0x63616e6164610000ull);
+        std::string out = "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\",\"properties\":{\"name\":\"Canada\"},\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[";
+        for (std::size_t r = 0; r < rings; ++r) {
+            out += r != 0 ? ",[" : "[";
+            double lon = rng.between(-141.0, -52.0);
+            double lat = rng.between(41.0, 83.0);
+            for (std::size_t p = 0; p < points; ++p) {
+                lon += rng.between(-0.01, 0.01);
+                lat += rng.between(-0.01, 0.01);
+                out += p != 0 ? ",[" : "[";
+                detail::floating(out, lon);
+                out += ',';
+                detail::floating(out, lat);
+                out += ']';
+            }
+            out += ']';
+        }
+        out += "]}}]}";
+        return { "canada", std::move(out) };
+    }
+
+    // Objects and arrays alternating down to depth, with a few scalars on every level.
+    inline document nested(std::size_t depth, std::size_t width) {
+        random rng(0x6e65737465640000ull);
+        std::string out;
+        for (std::size_t d = 0; d < depth; ++d) {
+            if (d % 2 == 0) {
+                out += "{\"level\":";
+                detail::number(out, static_cast<std::uint64_t>(d));
+                out += ",\"flag\":";
+                out += rng.chance(50) ? "true" : "false";
+                out += ",\"child\":";
+            }
+            else {
+                out += '[';
+                for (std::size_t w = 0; w < width; ++w) {
+                    detail::number(out, rng.below(1000));
+                    out += ',';
+                }
+            }
+        }
+        out += "null";
+        for (std::size_t d = depth; d-- > 0;) {
+            out += d % 2 == 0 ? '}' : ']';
+        }
+        return { "nested", std::move(out) };
+    }
+
+    // Records whose members are all strings, long and full of escapes.
+    inline document strings(std::size_t records) {
+        random rng(0x737472696e677300ull);
+        constexpr std::string_view fields[] = { "title", "author", "summary", "body", "footer" };
+        std::string out = "[";
+        for (std::size_t i = 0; i < records; ++i) {
+            out += i != 0 ? ",{" : "{";
+            for (std::size_t f = 0; f < std::size(fields); ++f) {
+                if (f != 0) {
+                    out += ',';
+                }
+                out += '"';
+                out += fields[f];
+                out += "\":\"";
+                detail::sentence(out, rng, 4 + rng.below(f == 3 ? 96 : 16));
+                out += '"';
+            }
+            out += '}';
+        }
+        out += ']';
+        return { "strings", std::move(out) };
+    }
+
+    // The full corpus, scale multiplies the size of every document.
+    inline std::vector<document> make(std::size_t scale) {
+        std::vector<document> documents{};
+        documents.push_back(corpus::twitter(100 * scale));
+        documents.push_back(corpus::canada(4 * scale, 1000));
+        documents.push_back(corpus::nested(64 * scale, 8));
+        documents.push_back(corpus::strings(100 * scale));
+        return documents;
+    }
+}
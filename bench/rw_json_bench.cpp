@@ -0,0 +1,214 @@
+//
+// RW_JSON_BENCH
+// ---------------
+//  Parse and serialize throughput over the generated corpus, see corpus.hpp. Every benchmark repeats its body
+//  until the minimum time has passed and reports input megabytes, documents and nanoseconds per value node
+//  per second of wall time. Megabytes count the characters of the document, not the bytes of a wide string.
+//
+//  usage: rw_json_bench [--seconds S] [--scale N] [filter]
+//  Only benchmarks whose name contains filter run.
+//
+
+#include "rw-json.hpp"
+#include "corpus.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <locale>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+    using namespace rw::json;
+
+    struct options {
+        double seconds{ 0.5 };
+        std::size_t scale{ 1 };
+        std::string_view filter{};
+    };
+
+    struct result {
+        double seconds{ 0.0 };
+        std::size_t iterations{ 0 };
+    };
+
+    volatile std::size_t sink = 0;
+
+    template<typename F>
+    result measure(const options& opts, F&& body) {
+        using clock = std::chrono::steady_clock;
+        result r{};
+        const clock::time_point start = clock::now();
+        do {
+            body();
+            ++r.iterations;
+            r.seconds = std::chrono::duration<double>(clock::now() - start).count();
+        } while (r.seconds < opts.seconds);
+        return r;
+    }
+
+    bool selected(const options& opts, std::string_view name) {
+        return name.find(opts.filter) != std::string_view::npos;
+    }
+
+    void report(std::string_view name, const corpus::document& doc, std::size_t nodes, const result& r) {
+        const double mb = static_cast<double>(doc.text.size()) * static_cast<double>(r.iterations) / (1024.0 * 1024.0);
+        const double ns = r.seconds * 1e9 / (static_cast<double>(nodes) * static_cast<double>(r.iterations));
+        std::printf("%-22.*s %-8s %10.1f MB/s %12.1f docs/s %8.2f ns/node\n",
+            static_cast<int>(name.size()), name.data(), doc.name.c_str(),
+            mb / r.seconds, static_cast<double>(r.iterations) / r.seconds, ns);
+    }
+
+    template<typename Char>
+    std::basic_string<Char> widen(const std::string& text) {
+        std::basic_string<Char> wide(text.size(), Char());
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            wide[i] = static_cast<Char>(static_cast<unsigned char>(text[i]));
+        }
+        return wide;
+    }
+
+    template<typename Char>
+    basic_value<Char> parse(const std::basic_string<Char>& text) {
+        std::basic_istringstream<Char> is(text);
+        basic_reader<Char> reader(is);
+        basic_value<Char> value{};
+        if (!(reader >> value)) {
+            throw std::runtime_error("Corpus document does not parse");
+        }
+        return value;
+    }
+
+    template<typename Char>
+    std::size_t nodes(const basic_value<Char>& value) {
+        std::size_t count = 1;
+        if (value.is_array()) {
+            for (const auto& element : value.array()) {
+                count += nodes(element);
+            }
+        }
+        else if (value.is_object()) {
+            for (const auto& member : value.object()) {
+                count += nodes(member.second);
+            }
+        }
+        return count;
+    }
+
+    template<typename Char>
+    void bench_parse(const options& opts, std::string_view name, const corpus::document& doc) {
+        if (!selected(opts, name)) {
+            return;
+        }
+        // Standard libraries without stream facets for the character type cannot read it at all, e.g. libstdc++
+        // for char8_t and char16_t. Anything else that goes wrong fails the run.
+        if (!std::has_facet<std::ctype<Char>>(std::locale())) {
+            std::printf("%-22.*s %-8s unsupported: no std::ctype facet\n", static_cast<int>(name.size()), name.data(), doc.name.c_str());
+            return;
+        }
+        const std::basic_string<Char> text = widen<Char>(doc.text);
+        const std::size_t count = nodes(parse(text));
+        const result r = measure(opts, [&] {
+            sink = sink + parse(text).is_object();
+        });
+        report(name, doc, count, r);
+    }
+
+    void bench_serialize(const options& opts, std::string_view name, const corpus::document& doc, bool indentation) {
+        if (!selected(opts, name)) {
+            return;
+        }
+        const value parsed = parse(doc.text);
+        const std::size_t count = nodes(parsed);
+        const serializer serialize(indentation);
+        std::ostringstream os{};
+        const result r = measure(opts, [&] {
+            os.str(std::string{});
+            serialize(os, parsed);
+            sink = sink + static_cast<std::size_t>(os.tellp());
+        });
+        report(name, doc, count, r);
+    }
+
+    template<typename Container>
+    void bench_convert(const options& opts, std::string_view name, const corpus::document& doc, const value& source) {
+        const std::string to = std::string(name) + "_to_stl";
+        const std::string from = std::string(name) + "_from_stl";
+        const std::size_t count = nodes(source);
+
+        Container container{};
+        source >> container;
+
+        if (selected(opts, to)) {
+            const result r = measure(opts, [&] {
+                Container c{};
+                source >> c;
+                sink = sink + c.size();
+            });
+            report(to, doc, count, r);
+        }
+
+        if (selected(opts, from)) {
+            const result r = measure(opts, [&] {
+                value v{};
+                v << container;
+                sink = sink + v.is_array();
+            });
+            report(from, doc, count, r);
+        }
+    }
+
+    options parse_options(int argc, char** argv) {
+        options opts{};
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg = argv[i];
+            if (arg == "--seconds" && i + 1 < argc) {
+                opts.seconds = std::strtod(argv[++i], nullptr);
+            }
+            else if (arg == "--scale" && i + 1 < argc) {
+                opts.scale = std::max<std::size_t>(std::strtoull(argv[++i], nullptr, 10), 1);
+            }
+            else {
+                opts.filter = arg;
+            }
+        }
+        return opts;
+    }
+}
+
+int main(int argc, char** argv) {
+    try {
+        const options opts = parse_options(argc, argv);
+        const std::vector<corpus::document> documents = corpus::make(opts.scale);
+
+        for (const corpus::document& doc : documents) {
+            std::printf("# %s: %zu bytes\n", doc.name.c_str(), doc.text.size());
+            bench_parse<char>(opts, "reader", doc);
+            bench_parse<char8_t>(opts, "u8reader", doc);
+            bench_parse<char16_t>(opts, "u16reader", doc);
+            bench_serialize(opts, "serializer", doc, false);
+            bench_serialize(opts, "serializer_indented", doc, true);
+
+            if (doc.name == "canada") {
+                const value parsed = parse(doc.text);
+                const value& rings = parsed.object().at(key_view("features")).array()[0]
+                    .object().at(key_view("geometry")).object().at(key_view("coordinates"));
+                bench_convert<std::vector<std::vector<std::vector<double>>>>(opts, "vector", doc, rings);
+            }
+            if (doc.name == "strings") {
+                bench_convert<std::vector<std::map<std::string, std::string>>>(opts, "map", doc, parse(doc.text));
+            }
+        }
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "rw_json_bench: %s\n", e.what());
+        return 1;
+    }
+}
@@ -13,13 +13,38 @@
 
 #include <iostream>       // For basic_i|o|stream   | used by: json::reader, json::writer, json::serializer, json::deserializer
 #include <vector>         // For vector             | used by: json::array
-#include <unordered_map>  // For unordered_map      | used by: json::object
-#include <variant>        // For variant            | used by: json::value
+#include <variant>        // For variant            | used by: json::key, json::value
 #include <iomanip>        // For quoted             | used by: json::reader, json::writer, json::serializer, json::deserializer
 #include <optional>       // For optional           | used by: json::serialize, json::deserialize
 #include <sstream>        // For i|o|stringstream   | used by: json::reader, json::writer, json::serializer, json::deserializer
 #include <memory>         // For smart pointers     | used by: extensions
-#include <array>          // For array              | used by: json::array
+#include <array>          // For array              | used by: json::array, json::statistics
+#include <stdexcept>      // For runtime_error      | used by: json::object, json::serializer, json::deserializer
+#include <string_view>    // For basic_string_view  | used by: json::key
+#include <deque>          // For deque              | used by: json::key_pool
+#include <unordered_map>  // For unordered_map      | used by: json::key_pool
+#include <shared_mutex>   // For shared_mutex       | used by: json::key_pool
+#include <mutex>          // For unique_lock        | used by: json::key_pool
+#include <bit>            // For bit_cast           | used by: json::tape, json::binary_reader, json::binary_writer
+#include <cstdint>        // For int64_t, uint64_t  | used by: json::number, json::tape
+#include <cmath>          // For double_t           | used by: json::number
+#include <cstring>        // For memcmp, memcpy     | used by: json::reader, json::snapshot
+#include <charconv>       // For to|from_chars      | used by: json::reader, json::writer
+#include <limits>         // For numeric_limits     | used by: json::number
+#include <compare>        // For partial_ordering   | used by: json::number
+#include <ranges>         // For sized_range        | used by: json::array, json::object
+#include <algorithm>      // For min                | used by: json::reader
+#include <thread>         // For thread             | used by: json::reclaimer, json::batch_deserializer, json::async_sink
+#include <condition_variable> // For condition_variable | used by: json::reclaimer, json::batch_deserializer, json::async_sink
+#include <span>           // For span               | used by: json::array, json::snapshot
+#include <functional>     // For invoke, identity   | used by: json::writer
+#include <utility>        // For as_const, cmp_less | used by: json::array, json::number
+#include <iterator>       // For default_sentinel   | used by: json::path
+#include <atomic>         // For atomic             | used by: json::array, json::object, json::stats_hook, json::counting_allocator
+#include <regex>          // For basic_regex        | used by: json::schema
+#include <coroutine>      // For coroutine_handle   | used by: json::generator, json::task
+#include <exception>      // For exception_ptr      | used by: json::generator, json::task
+#include <chrono>         // For steady_clock       | used by: json::statistics
 
 #ifndef RW_NAMESPACE
     #define RW_NAMESPACE                rw
@@ -59,6 +84,311 @@ namespace detail {
 
     template<typename T, typename Allocator>
     using rebind_alloc_t = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+    template<typename Container>
+    concept is_reservable = requires(Container& c, typename Container::size_type n) {
+        c.reserve(n);
+    };
+
+    template<typename Container>
+    concept is_reusable_sequence = std::ranges::random_access_range<Container> && requires(Container& c) {
+        c.emplace_back();
+        c.erase(c.begin(), c.end());
+    };
+
+    template<typename Container>
+    concept is_reusable_map = std::ranges::random_access_range<Container> && requires(Container& c, typename Container::key_type&& k) {
+        c.try_emplace(std::move(k));
+        c.erase(c.begin(), c.end());
+    };
+
+    template<typename Container, typename Source>
+    inline void reserve_for(Container& container, const Source& source) {
+        if constexpr (is_reservable<Container> && std::ranges::sized_range<const Source>) {
+            container.reserve(static_cast<typename Container::size_type>(std::ranges::size(source)));
+        }
+    }
+
+    template<typename Char, typename Traits>
+    inline std::size_t hash_chars(std::basic_string_view<Char, Traits> str) noexcept {
+        return std::hash<std::basic_string_view<Char>>{}(std::basic_string_view<Char>(str.data(), str.size()));
+    }
+
+    template<typename Char, typename Traits>
+    struct hashed_view {
+        std::basic_string_view<Char, Traits> view{};
+        std::size_t                          hash{ 0 };
+
+        friend bool operator==(const hashed_view& lhs, const hashed_view& rhs) noexcept {
+            return lhs.hash == rhs.hash && lhs.view == rhs.view;
+        }
+    };
+
+    struct hashed_view_hash {
+        template<typename Char, typename Traits>
+        std::size_t operator()(const hashed_view<Char, Traits>& key) const noexcept {
+            return key.hash;
+        }
+    };
+
+    template<typename T>
+    concept has_cached_hash = requires(const T& key) {
+        { key.hash() } -> std::convertible_to<std::size_t>;
+    };
+
+    template<typename T>
+    concept is_string_like = requires(const T& str) {
+        typename T::traits_type;
+        std::basic_string_view<typename T::traits_type::char_type, typename T::traits_type>(str);
+    };
+
+    // Hashes keys, string views, strings and character pointers alike, so a map using it can be
+    // searched with any of them without constructing a key. Keys carrying a hash are not rehashed.
+    struct transparent_hash {
+        using is_transparent = void;
+
+        template<typename K>
+        std::size_t operator()(const K& key) const noexcept {
+            if constexpr (has_cached_hash<K>) {
+                return key.hash();
+            }
+            else if constexpr (std::is_pointer_v<std::decay_t<K>>) {
+                using char_type = std::remove_cv_t<std::remove_pointer_t<std::decay_t<K>>>;
+                return hash_chars(std::basic_string_view<char_type>(key));
+            }
+            else if constexpr (is_string_like<K>) {
+                using traits_type = typename K::traits_type;
+                return hash_chars(std::basic_string_view<typename traits_type::char_type, traits_type>(key));
+            }
+            else {
+                return std::hash<K>{}(key);
+            }
+        }
+    };
+
+    // splitmix64 finalizer, spreads the bits of hashes that are combined or compared by value.
+    inline std::size_t mix_hash(std::uint64_t h) noexcept {
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+        return static_cast<std::size_t>(h ^ (h >> 31));
+    }
+
+    inline std::size_t combine_hash(std::size_t seed, std::size_t value) noexcept {
+        return mix_hash(static_cast<std::uint64_t>(seed) ^ (static_cast<std::uint64_t>(value) + 0x9e3779b97f4a7c15ull + (static_cast<std::uint64_t>(seed) << 6)));
+    }
+
+    // Integers hash exactly, doubles with an integral value hash like that integer, so values that compare
+    // equal hash equal whatever their kind and integers above 2^53 do not collide with their neighbours.
+    inline std::size_t hash_number(std::int64_t number) noexcept {
+        return combine_hash(3, mix_hash(static_cast<std::uint64_t>(number)));
+    }
+
+    inline std::size_t hash_number(std::uint64_t number) noexcept {
+        if (number <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max())) {
+            return hash_number(static_cast<std::int64_t>(number));
+        }
+        return combine_hash(4, mix_hash(number));
+    }
+
+    inline std::size_t hash_number(double number) noexcept {
+        constexpr double limit = 9223372036854775808.0; // 2^63
+        if (number >= -limit && number < limit && static_cast<double>(static_cast<std::int64_t>(number)) == number) {
+            return hash_number(static_cast<std::int64_t>(number));
+        }
+        if (number >= limit && number < 2.0 * limit) {
+            return hash_number(static_cast<std::uint64_t>(number));
+        }
+        return combine_hash(3, std::hash<double>{}(number));
+    }
+
+    inline std::size_t hash_boolean(bool boolean) noexcept {
+        return combine_hash(5, boolean ? 1 : 0);
+    }
+
+    // Lazily computed hash of a container. 0 means not computed, a computed 0 is stored as 1. Atomic so
+    // concurrent const readers may compute and store it, they all store the same value.
+    class hash_cache {
+    public:
+        hash_cache(void) = default;
+
+        hash_cache(const hash_cache& other) noexcept
+            : _Value(other.load())
+        {
+        }
+
+        hash_cache& operator=(const hash_cache& other) noexcept {
+            _Value.store(other.load(), std::memory_order_relaxed);
+            return *this;
+        }
+
+        std::size_t load(void) const noexcept {
+            return _Value.load(std::memory_order_relaxed);
+        }
+
+        std::size_t store(std::size_t hash) const noexcept {
+            hash = hash == 0 ? 1 : hash;
+            _Value.store(hash, std::memory_order_relaxed);
+            return hash;
+        }
+
+        void reset(void) noexcept {
+            if (this->load() != 0) {
+                _Value.store(0, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        mutable std::atomic<std::size_t> _Value{ 0 };
+    };
+
+    // Where a caching writer left the text of a container. The text is identified by id and lies either in
+    // buffer, when the container was written on its own, or at offset inside the text of the container it was
+    // last written in, identified by parent. Nested containers refer to their parent text the same way, so a
+    // document keeps a single copy of its text however deep it is.
+    struct text_cache_base {
+        virtual ~text_cache_base() = default;
+
+        virtual std::size_t bytes(void) const noexcept = 0;
+
+        std::uint64_t id{ 0 };
+        std::uint64_t parent{ 0 };
+        std::size_t   offset{ 0 };
+        std::size_t   length{ 0 };
+        bool          indentation{ false };
+        int           level{ 0 };
+        bool          dirty{ false };
+    };
+
+    template<typename Char, typename Traits>
+    struct text_cache : text_cache_base {
+        std::size_t bytes(void) const noexcept override {
+            return sizeof(*this) + (buffer ? sizeof(*buffer) + (buffer->capacity() + 1) * sizeof(Char) : 0);
+        }
+
+        std::shared_ptr<const std::basic_string<Char, Traits>> buffer{};
+    };
+
+    inline std::uint64_t next_text_id(void) noexcept {
+        static std::atomic<std::uint64_t> next{ 0 };
+        return next.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    // Hash cache of a container that also records where a caching writer left its text. reset() drops the
+    // hash and marks the text dirty, the location stays so that the unchanged children can still be found in
+    // it. Copies only keep the hash, moves keep both, a text found under another parent is not used.
+    // Const writes claim the text before touching it, see text_claim.
+    class node_cache : public hash_cache {
+    public:
+        node_cache(void) = default;
+
+        node_cache(const node_cache& other) noexcept
+            : hash_cache(other)
+        {
+        }
+
+        node_cache(node_cache&& other) noexcept
+            : hash_cache(other)
+            , _Text(std::move(other._Text))
+        {
+        }
+
+        node_cache& operator=(const node_cache& other) noexcept {
+            hash_cache::operator=(other);
+            _Text.reset();
+            return *this;
+        }
+
+        node_cache& operator=(node_cache&& other) noexcept {
+            hash_cache::operator=(other);
+            _Text = std::move(other._Text);
+            return *this;
+        }
+
+        void reset(void) noexcept {
+            hash_cache::reset();
+            if (_Text) {
+                _Text->dirty = true;
+            }
+        }
+
+        template<typename Char, typename Traits>
+        text_cache<Char, Traits>* text(void) const noexcept {
+            return dynamic_cast<text_cache<Char, Traits>*>(_Text.get());
+        }
+
+        template<typename Char, typename Traits>
+        text_cache<Char, Traits>& make_text(void) const {
+            if (auto* text = this->template text<Char, Traits>()) {
+                return *text;
+            }
+            auto text = std::make_unique<text_cache<Char, Traits>>();
+            auto& ref = *text;
+            _Text = std::move(text);
+            return ref;
+        }
+
+        void drop_text(void) const noexcept {
+            _Text.reset();
+        }
+
+        // Heap bytes of the text location and of the buffer it owns, see memory_usage(). 0 while a write
+        // has the text claimed.
+        std::size_t bytes(void) const noexcept {
+            if (!this->claim()) {
+                return 0;
+            }
+            std::size_t bytes = _Text ? _Text->bytes() : 0;
+            this->release();
+            return bytes;
+        }
+
+        bool claim(void) const noexcept {
+            return !_Busy.exchange(true, std::memory_order_acquire);
+        }
+
+        void release(void) const noexcept {
+            _Busy.store(false, std::memory_order_release);
+        }
+
+    private:
+        mutable std::unique_ptr<text_cache_base> _Text{};
+        mutable std::atomic<bool>                _Busy{ false };
+    };
+
+    // Exclusive use of the text of a container for the duration of a write. Concurrent writes of one value
+    // claim each container they write, one that another write holds is written without its text.
+    class text_claim {
+    public:
+        explicit text_claim(const node_cache& cache) noexcept
+            : _Cache(cache)
+            , _Owns(cache.claim())
+        {
+        }
+
+        text_claim(const text_claim&) = delete;
+        text_claim& operator=(const text_claim&) = delete;
+
+        ~text_claim() {
+            if (_Owns) {
+                _Cache.release();
+            }
+        }
+
+        bool owns(void) const noexcept {
+            return _Owns;
+        }
+
+    private:
+        const node_cache& _Cache;
+        bool              _Owns;
+    };
+
+    template<typename Map, typename K>
+    concept is_transparent_lookup = requires {
+        typename Map::hasher::is_transparent;
+        typename Map::key_equal::is_transparent;
+    } && !std::same_as<std::remove_cvref_t<K>, typename Map::key_type>
+      && std::predicate<const typename Map::key_equal&, const typename Map::key_type&, const K&>;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -79,7 +409,7 @@ namespace detail {
 //
 
 enum class type_id : std::size_t {
-    invalid = ~0,
+    invalid = ~std::size_t{ 0 },
     null    =  0,
     string  =  1,
     number  =  2,
@@ -92,1151 +422,8567 @@ enum class type_id : std::size_t {
 
 
 //
-// WRITER
+// KEY
+// -----
+//  Immutable object key. Either owns its characters or refers to an entry of a basic_key_pool,
+//  in which case it must not outlive the pool. The pool entry keeps the hash of an interned key,
+//  owned keys hash their characters when asked, and keys interned by the same pool compare by pointer.
 //
 
 template<typename Char, typename Traits = std::char_traits<Char>>
-class basic_writer {
+class basic_interned_key {
 public:
-    basic_writer(std::basic_ostream<Char, Traits>& os, bool indentation = false, int level = 0)
-        : _Os(os)
-        , _Indentation(indentation)
-        , _Level(level)
+    using char_type   = Char;
+    using traits_type = Traits;
+    using view_type   = std::basic_string_view<Char, Traits>;
+
+    basic_interned_key(view_type str, std::size_t hash)
+        : _Value(str)
+        , _Hash(hash)
     {
-        this->indent();
     }
 
-    basic_writer& operator<<(std::nullptr_t) {
-        if constexpr (std::same_as<Char, char>) {
-            _Os << "null";
-        }
-        if constexpr (std::same_as<Char, wchar_t>) {
-            _Os << L"null";
-        }
-        if constexpr (std::same_as<Char, char8_t>) {
-            _Os << u8"null";
-        }
-        if constexpr (std::same_as<Char, char16_t>) {
-            _Os << u"null";
-        }
-        if constexpr (std::same_as<Char, char32_t>) {
-            _Os << U"null";
-        }
-        return *this;
+    view_type view(void) const noexcept {
+        return _Value;
     }
 
-    template<std::size_t N>
-    basic_writer& operator<<(const Char(&str)[N]) {
-        _Os << std::quoted(str);
-        return *this;
+    std::size_t hash(void) const noexcept {
+        return _Hash;
     }
 
-    template<typename ... Ts>
-    basic_writer& operator<<(const std::basic_string<Char, Ts...>& str) {
-        _Os << std::quoted(str);
-        return *this;
+private:
+    std::basic_string<Char, Traits> _Value{};
+    std::size_t                     _Hash{ 0 };
+};
+
+// Non-owning key used for lookups. Carries the hash of its characters, so a key view built once can be used
+// for any number of lookups without hashing again.
+template<typename Char, typename Traits = std::char_traits<Char>>
+class basic_key_view {
+public:
+    using char_type   = Char;
+    using traits_type = Traits;
+    using view_type   = std::basic_string_view<Char, Traits>;
+    using size_type   = typename view_type::size_type;
+
+    basic_key_view(void) = default;
+
+    basic_key_view(const Char* str) noexcept
+        : basic_key_view(view_type(str))
+    {
     }
 
-    template<typename ... Ts>
-    basic_writer& operator<<(std::basic_string<Char, Ts...>&& str) {
-        _Os << std::quoted(str);
-        return *this;
+    basic_key_view(view_type str) noexcept
+        : _Value(str)
+        , _Hash(detail::hash_chars(str))
+    {
     }
 
-    template<typename ... Ts>
-    basic_writer& operator<<(std::basic_string_view<Char, Ts...> str) {
-        _Os << std::quoted(str);
-        return *this;
+    basic_key_view(view_type str, std::size_t hash) noexcept
+        : _Value(str)
+        , _Hash(hash)
+    {
     }
 
-    template<typename T> requires (std::is_arithmetic_v<T> && !std::same_as<bool, T>)
-        basic_writer& operator<<(const T& number) {
-        _Os << number;
-        return *this;
+    template<typename Key> requires (detail::has_cached_hash<Key> && !std::same_as<Key, basic_key_view>)
+    basic_key_view(const Key& key) noexcept
+        : _Value(key.view())
+        , _Hash(key.hash())
+    {
     }
 
-    template<typename T> requires std::same_as<bool, T>
-    basic_writer& operator<<(const T& object) {
-        _Os << std::boolalpha << object;
-        return *this;
+    view_type view(void) const noexcept {
+        return _Value;
     }
 
-    template<typename Key, typename Value>
-    basic_writer& operator<<(const std::pair<Key, Value>& pair) {
-        if constexpr (detail::is_quotable<Key>) {
-            _Os << std::quoted(pair.first);
-        }
-        else {
-            _Os << Char('"');
-            (*this) << pair.second;
-            _Os << Char('"');
-        }
-        _Os << Char(':');
-        this->space();
-        (*this) << pair.second;
-        return *this;
+    operator view_type(void) const noexcept {
+        return _Value;
     }
 
-    template<typename Container> requires detail::is_single_container<Container>
-    basic_writer& operator<<(const Container& container) {
-        this->begin(Char('['));
-        auto it = container.begin();
+    const Char* data(void) const noexcept {
+        return _Value.data();
+    }
 
-        this->linebreak();
-        this->indent();
-        (*this) << (*it);
-        ++it;
+    size_type size(void) const noexcept {
+        return _Value.size();
+    }
 
-        do {
-            _Os << Char(',');
-            this->linebreak();
-            this->indent();
-            (*this) << (*it);
-            ++it;
-        } while (it != container.end());
-        this->end(Char(']'));
-        return *this;
+    std::size_t hash(void) const noexcept {
+        return _Hash;
     }
 
-    template<typename Container> requires detail::is_pair_container<Container>
-    basic_writer& operator<<(const Container& container) {
-        this->begin(Char('{'));
-        auto it = container.begin();
+    friend bool operator==(const basic_key_view& lhs, const basic_key_view& rhs) noexcept {
+        return lhs._Hash == rhs._Hash && lhs._Value == rhs._Value;
+    }
 
-        this->linebreak();
-        this->indent();
-        (*this) << (*it);
-        ++it;
+private:
+    view_type   _Value{};
+    std::size_t _Hash{ detail::hash_chars(view_type{}) };
+};
 
-        do {
-            _Os << Char(',');
-            this->linebreak();
-            this->indent();
-            (*this) << (*it);
-            ++it;
-        } while (it != container.end());
-        this->end(Char('}'));
-        return *this;
+template<typename Char, typename Traits = std::char_traits<Char>, typename Allocator = std::allocator<Char>>
+class basic_key {
+public:
+    using char_type      = Char;
+    using traits_type    = Traits;
+    using allocator_type = Allocator;
+    using string_type    = std::basic_string<Char, Traits, Allocator>;
+    using view_type      = std::basic_string_view<Char, Traits>;
+    using interned_type  = basic_interned_key<Char, Traits>;
+    using key_view_type  = basic_key_view<Char, Traits>;
+    using size_type      = typename view_type::size_type;
+
+    basic_key(void) = default;
+
+    basic_key(const Char* str)
+        : basic_key(view_type(str))
+    {
     }
 
-    operator bool() const noexcept {
-        return !(_Os.bad() || _Os.fail());
+    basic_key(view_type str)
+        : _Value(std::in_place_index<0>, str)
+    {
     }
 
-protected:
-    void begin(const Char& c) {
-        _Os << c;
-        ++_Level;
+    basic_key(const string_type& str)
+        : _Value(std::in_place_index<0>, str)
+    {
     }
 
-    void end(const Char& c) {
-        this->linebreak();
-        --_Level;
-        this->indent();
-        _Os << c;
+    basic_key(string_type&& str)
+        : _Value(std::in_place_index<0>, std::move(str))
+    {
     }
 
-    void linebreak(void) {
-        if (_Indentation) {
-            _Os << Char('\n');
-        }
+    basic_key(const interned_type& key) noexcept
+        : _Value(std::in_place_index<1>, &key)
+    {
     }
 
-    void indent(void) {
-        for (int i = 0; i < _Level && _Indentation; ++i) {
-            _Os << Char('\t');
-        }
+    basic_key(const key_view_type& key)
+        : _Value(std::in_place_index<0>, key.view())
+    {
     }
 
-    void space(void) {
-        if (_Indentation) {
-            _Os << Char(' ');
+    view_type view(void) const noexcept {
+        if (const interned_type* const* interned = std::get_if<1>(&_Value)) {
+            return (*interned)->view();
         }
+        return view_type(*std::get_if<0>(&_Value));
     }
 
-    std::basic_ostream<Char, Traits>& _Os;
-    bool                              _Indentation{ false };
-    int                               _Level{ 0 };
-};
-
-using writer    = basic_writer<char>;
-using wwriter   = basic_writer<wchar_t>;
-using u8writer  = basic_writer<char8_t>;
-using u16writer = basic_writer<char16_t>;
-using u32writer = basic_writer<char32_t>;
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    operator view_type(void) const noexcept {
+        return this->view();
+    }
 
+    string_type str(void) const& {
+        return string_type(this->view());
+    }
 
-//
-// READER
-//
+    string_type str(void) && {
+        if (string_type* owned = std::get_if<0>(&_Value)) {
+            return std::move(*owned);
+        }
+        return string_type(this->view());
+    }
 
-template<typename Char, typename Traits = std::char_traits<Char>>
-class basic_reader {
-public:
-    basic_reader(std::basic_istream<Char, Traits>& is)
-        : _Is(is)
-    {
+    const Char* data(void) const noexcept {
+        return this->view().data();
     }
 
-    type_id type(void) const noexcept {
-        _Is >> std::ws;
-        Char ch = _Is.peek();
-        switch (ch) {
-        case Char('n'): return type_id::null;
-        case Char('"'): return type_id::string;
-        case Char('0'): return type_id::number;
-        case Char('1'): return type_id::number;
-        case Char('2'): return type_id::number;
-        case Char('3'): return type_id::number;
-        case Char('4'): return type_id::number;
-        case Char('5'): return type_id::number;
-        case Char('6'): return type_id::number;
-        case Char('7'): return type_id::number;
-        case Char('8'): return type_id::number;
-        case Char('9'): return type_id::number;
-        case Char('['): return type_id::array;
-        case Char('{'): return type_id::object;
-        case Char('t'): return type_id::boolean;
-        default:
-            break;
-        }
-        return type_id::invalid;
+    size_type size(void) const noexcept {
+        return this->view().size();
     }
 
-    basic_reader& operator>>(std::nullptr_t) {
-        Char ch[5]{};
-        _Is >> ch;
-
-        bool _Equals = false;
-
-        if constexpr (std::same_as<Char, char>) {
-            _Equals = std::memcmp(ch, "null", 5 * sizeof(Char)) == 0;
-        }
-        if constexpr (std::same_as<Char, wchar_t>) {
-            _Equals = std::memcmp(ch, L"null", 5 * sizeof(Char)) == 0;
-        }
-        if constexpr (std::same_as<Char, char8_t>) {
-            _Equals = std::memcmp(ch, u8"null", 5 * sizeof(Char)) == 0;
-        }
-        if constexpr (std::same_as<Char, char16_t>) {
-            _Equals = std::memcmp(ch, u"null", 5 * sizeof(Char)) == 0;
-        }
-        if constexpr (std::same_as<Char, char32_t>) {
-            _Equals = std::memcmp(ch, U"null", 5 * sizeof(Char)) == 0;
-        }
-
-        if (!_Equals) {
-            _Is.setstate(std::ios::failbit);
-        }
-
-        return *this;
+    bool empty(void) const noexcept {
+        return this->view().empty();
     }
 
-    template<typename ... Ts>
-    basic_reader& operator>>(std::basic_string<Char, Ts...>& str) {
-        _Is >> std::quoted(str);
-        return *this;
+    // Stored in the pool entry of interned keys, owned keys hash their characters on every call.
+    std::size_t hash(void) const noexcept {
+        if (const interned_type* const* interned = std::get_if<1>(&_Value)) {
+            return (*interned)->hash();
+        }
+        return detail::hash_chars(this->view());
     }
 
-    template<typename T> requires (std::is_arithmetic_v<T> && !std::same_as<bool, T>)
-        basic_reader& operator>>(T& number) {
-        _Is >> number;
-        return *this;
+    bool interned(void) const noexcept {
+        return _Value.index() == 1;
     }
 
-    template<typename T> requires std::same_as<bool, T>
-    basic_reader& operator>>(T& b) {
-        _Is >> std::boolalpha >> b;
-        return *this;
+    // Characters the key has room for in its own buffer, interned keys own none.
+    size_type capacity(void) const noexcept {
+        const string_type* owned = std::get_if<0>(&_Value);
+        return owned ? owned->capacity() : 0;
     }
 
-    template<typename Key, typename Value>
-    basic_reader& operator>>(std::pair<Key, Value>& pair) {
-        char ch{};
-        if constexpr (detail::is_quotable<Key>) {
-            _Is >> std::quoted(pair.first);
-        }
-        else {
-            _Is >> ch;
-            if (ch != Char('"')) {
-                _Is.setstate(std::ios::failbit);
-                return *this;
+    friend bool operator==(const basic_key& lhs, const basic_key& rhs) noexcept {
+        if (lhs.interned() && rhs.interned()) {
+            if (std::get<1>(lhs._Value) == std::get<1>(rhs._Value)) {
+                return true;
             }
-
-            (*this) >> pair.second;
-
-            _Is >> ch;
-            if (ch != Char('"')) {
-                _Is.setstate(std::ios::failbit);
-                return *this;
+            if (lhs.hash() != rhs.hash()) {
+                return false;
             }
         }
-
-        _Is >> ch;
-        if (ch != Char(':')) {
-            _Is.setstate(std::ios::failbit);
-            return *this;
-        }
-
-        (*this) >> pair.second;
-        return *this;
+        return lhs.view() == rhs.view();
     }
 
-    template<typename Container> requires detail::is_single_container<Container>
-    basic_reader& operator>>(Container& container) {
-        Container _Temp{};
-        char ch{};
-        _Is >> ch;
-        if (ch != Char('[')) {
-            _Is.setstate(std::ios::failbit);
-            return *this;
-        }
-
-        if (_Is.peek() != Char(']')) {
-            auto it = std::back_inserter(_Temp);
-            do {
-                typename Container::value_type _TempValue{};
-                (*this) >> _TempValue;
-                *it = std::move(_TempValue);
-                _Is >> ch;
-                ++it;
-            } while (ch == Char(','));
-        }
-        else {
-            _Is >> ch;
-        }
-
-        if (ch != Char(']')) {
-            _Is.setstate(std::ios::failbit);
-            return *this;
+    friend bool operator==(const basic_key& lhs, const key_view_type& rhs) noexcept {
+        if (lhs.interned() && lhs.hash() != rhs.hash()) {
+            return false;
         }
-
-        container = std::move(_Temp);
-
-        return *this;
+        return lhs.view() == rhs.view();
     }
 
-    template<typename Container> requires detail::is_pair_container<Container>
-    basic_reader& operator>>(Container& container) {
-        using pair_type = std::pair<std::remove_const_t<typename Container::value_type::first_type>, typename Container::value_type::second_type>;
-
-        Container _Temp{};
-        char ch{};
-        _Is >> ch;
-        if (ch != Char('{')) {
-            _Is.setstate(std::ios::failbit);
-            return *this;
-        }
-
-        if (_Is.peek() != Char('}')) {
-            auto it = std::inserter(_Temp, _Temp.end());
-            do {
-                pair_type _TempValue{};
-                (*this) >> _TempValue;
-                *it = std::move(_TempValue);
-                _Is >> ch;
-                ++it;
-            } while (ch == Char(','));
-        }
-        else {
-            _Is >> ch;
-        }
-
-        if (ch != Char('}')) {
-            _Is.setstate(std::ios::failbit);
-            return *this;
-        }
+    friend bool operator==(const basic_key& lhs, view_type rhs) noexcept {
+        return lhs.view() == rhs;
+    }
 
-        container = std::move(_Temp);
+    friend bool operator==(const basic_key& lhs, const string_type& rhs) noexcept {
+        return lhs.view() == view_type(rhs);
+    }
 
-        return *this;
+    friend bool operator==(const basic_key& lhs, const Char* rhs) noexcept {
+        return lhs.view() == view_type(rhs);
     }
 
-    operator bool() const noexcept {
-        return !(_Is.bad() || _Is.fail());
+    friend std::basic_ostream<Char, Traits>& operator<<(std::basic_ostream<Char, Traits>& os, const basic_key& key) {
+        return (os << key.view());
     }
 
-protected:
-    std::basic_istream<Char, Traits>& _Is;
+private:
+    std::variant<string_type, const interned_type*> _Value{};
 };
 
-using reader    = basic_reader<char>;
-using wreader   = basic_reader<wchar_t>;
-using u8reader  = basic_reader<char8_t>;
-using u16reader = basic_reader<char16_t>;
-using u32reader = basic_reader<char32_t>;
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+RW_JSON_NAMESPACE_END
+RW_NAMESPACE_END
 
+namespace std {
+    template<typename Char, typename Traits, typename Allocator>
+    struct hash<RW_NAMESPACE::RW_JSON_NAMESPACE::basic_key<Char, Traits, Allocator>> {
+        std::size_t operator()(const RW_NAMESPACE::RW_JSON_NAMESPACE::basic_key<Char, Traits, Allocator>& key) const noexcept {
+            return key.hash();
+        }
+    };
+}
 
+RW_NAMESPACE_BEGIN
+RW_JSON_NAMESPACE_BEGIN
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-//
-//  FULL API
-// ----------
-//  Provides extended access to c++<=>json mappings.
-//
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 
 //
-// CONCEPTS
+// KEY POOL
+// ----------
+//  Thread safe intern table for object keys, shareable between documents and readers.
+//  Entries are never released before the pool itself. Lookups only take a shared lock
+//  on one of shard_count shards, inserting locks that shard exclusively.
 //
 
-template<typename T, typename JType>
-concept is_user_value = requires (const T& ut, JType& jt) {
-    { jt << ut } -> std::same_as<JType&>;
-}&& requires (T& ut, const JType& jt) {
-    { jt >> ut } -> std::same_as<const JType&>;
-};
-
-template<typename T, typename JNull>
-concept is_default_null = std::same_as<T, JNull>;
-
-template<typename T, typename JString>
-concept is_default_string = std::constructible_from<JString, T> && !std::same_as<T, std::nullptr_t>;
+template<typename Char, typename Traits = std::char_traits<Char>>
+class basic_key_pool {
+public:
+    using char_type     = Char;
+    using traits_type   = Traits;
+    using view_type     = std::basic_string_view<Char, Traits>;
+    using interned_type = basic_interned_key<Char, Traits>;
+    using size_type     = std::size_t;
+
+    static constexpr size_type shard_count = 16;
+
+    basic_key_pool(void) = default;
+    basic_key_pool(const basic_key_pool&) = delete;
+    basic_key_pool& operator=(const basic_key_pool&) = delete;
+
+    const interned_type& intern(view_type str) {
+        const detail::hashed_view<Char, Traits> key{ str, detail::hash_chars(str) };
+        shard& s = _Shards[(key.hash >> (sizeof(std::size_t) * 8 - 4)) % shard_count];
+
+        {
+            std::shared_lock<std::shared_mutex> lock(s.mutex);
+            auto it = s.lookup.find(key);
+            if (it != s.lookup.end()) {
+                return *it->second;
+            }
+        }
 
-template<typename T, typename JNumber>
-concept is_default_number = std::is_arithmetic_v<T> && !std::same_as<T, bool>;
+        std::unique_lock<std::shared_mutex> lock(s.mutex);
+        auto it = s.lookup.find(key);
+        if (it != s.lookup.end()) {
+            return *it->second;
+        }
 
-template<typename T, typename JArray>
-concept is_default_array = detail::is_single_container<T> && is_user_value<typename T::value_type, typename JArray::value_type> && !is_user_value<T, typename JArray::value_type::strin_type>;
+        const interned_type& interned = s.keys.emplace_back(str, key.hash);
+        s.lookup.emplace(detail::hashed_view<Char, Traits>{ interned.view(), key.hash }, &interned);
+        return interned;
+    }
 
-template<typename T, typename JObject>
-concept is_default_object = detail::is_pair_container<T> && is_user_value<typename T::mapped_type, typename JObject::mapped_type>;
+    size_type size(void) const {
+        size_type count = 0;
+        for (const shard& s : _Shards) {
+            std::shared_lock<std::shared_mutex> lock(s.mutex);
+            count += s.keys.size();
+        }
+        return count;
+    }
 
-template<typename T, typename JBool>
-concept is_default_boolean = std::same_as<T, JBool>;
+private:
+    struct shard {
+        using lookup_type = std::unordered_map<detail::hashed_view<Char, Traits>, const interned_type*, detail::hashed_view_hash>;
 
-template<typename T, typename JSerializer>
-concept is_serializable = requires (const JSerializer& js, const T& val) {
-    { js(std::declval<typename JSerializer::stream_type&>(), val) } -> std::same_as<const JSerializer&>;
-};
+        mutable std::shared_mutex mutex{};
+        std::deque<interned_type> keys{};
+        lookup_type               lookup{};
+    };
 
-template<typename T, typename JDeserializer>
-concept is_deserializable = requires (const JDeserializer& jds, T& val) {
-    { jds(std::declval<typename JDeserializer::stream_type&>(), val) } -> std::same_as<const JDeserializer&>;
+    std::array<shard, shard_count> _Shards{};
 };
 
-
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
 //
-// ARRAY
+// NUMBER
+// --------
+//  Json number that keeps integers as integers. Values are stored as signed integer when they fit,
+//  as unsigned integer when they only fit that, and as floating point otherwise, so integer ids above
+//  2^53 survive a round trip and integer reads and writes never go through floating point.
 //
 
-template<typename JValue, typename Allocator = std::allocator<JValue>>
-class basic_array {
+enum class number_kind : unsigned char {
+    integer          = 0,
+    unsigned_integer = 1,
+    floating         = 2
+};
+
+template<typename Int = std::int64_t, typename UInt = std::uint64_t, typename Float = std::double_t>
+class basic_number {
 public:
-    using array_type      = std::vector<JValue, Allocator>;
-    using value_type      = typename array_type::value_type;
-    using allocator_type  = typename array_type::allocator_type;
-    using size_type       = typename array_type::size_type;
-    using difference_type = typename array_type::difference_type;
-    using iterator        = typename array_type::iterator;
-    using const_iterator  = typename array_type::const_iterator;
+    using int_type   = Int;
+    using uint_type  = UInt;
+    using float_type = Float;
 
-    iterator begin(void) noexcept {
-        return _Value.begin();
+    constexpr basic_number(void) noexcept = default;
+
+    template<typename T> requires (std::is_integral_v<T> && std::is_signed_v<T> && !std::same_as<T, bool>)
+    constexpr basic_number(T number) noexcept {
+        this->assign(number);
     }
 
-    iterator end(void) noexcept {
-        return _Value.end();
+    template<typename T> requires (std::is_integral_v<T> && std::is_unsigned_v<T> && !std::same_as<T, bool>)
+    constexpr basic_number(T number) noexcept {
+        this->assign(number);
     }
 
-    const_iterator begin(void) const noexcept {
-        return _Value.begin();
+    template<typename T> requires std::is_floating_point_v<T>
+    constexpr basic_number(T number) noexcept {
+        this->assign(number);
     }
 
-    const_iterator end(void) const noexcept {
-        return _Value.end();
+    template<typename T> requires (std::is_arithmetic_v<T> && !std::same_as<T, bool>)
+    constexpr basic_number& operator=(T number) noexcept {
+        this->assign(number);
+        return *this;
     }
 
-    const_iterator cbegin(void) const noexcept {
-        return _Value.cbegin();
+    constexpr number_kind kind(void) const noexcept {
+        return _Kind;
     }
 
-    const_iterator cend(void) const noexcept {
-        return _Value.cend();
+    constexpr bool is_integer(void) const noexcept {
+        return _Kind == number_kind::integer;
     }
 
-    size_type size(void) const noexcept {
-        return _Value.size();
+    constexpr bool is_unsigned_integer(void) const noexcept {
+        return _Kind == number_kind::unsigned_integer;
     }
 
-    bool contains(size_type idx) const noexcept {
-        return idx < size();
+    constexpr bool is_floating(void) const noexcept {
+        return _Kind == number_kind::floating;
     }
 
-    value_type& operator[](size_type idx) {
-        difference_type difference = idx - size() + 1;
-        for (difference_type i = 0; i < difference && difference > 0; ++i) {
-            _Value.emplace_back();
+    // The number converted to T. Numbers outside the range of T saturate at its limits, NaN converts to 0.
+    template<typename T> requires (std::is_arithmetic_v<T> && !std::same_as<T, bool>)
+    constexpr T as(void) const noexcept {
+        switch (_Kind) {
+        case number_kind::integer:          return basic_number::saturate<T>(_Int);
+        case number_kind::unsigned_integer: return basic_number::saturate<T>(_UInt);
+        default:
+            break;
         }
-        return _Value[idx];
+        return basic_number::saturate<T>(_Float);
     }
 
-    const value_type& operator[](size_type idx) const {
-        return _Value[idx];
+    constexpr operator float_type(void) const noexcept {
+        return this->as<float_type>();
     }
 
-    array_type& get(void) noexcept {
-        return _Value;
+    template<typename T> requires (std::is_arithmetic_v<T> && !std::same_as<T, bool>)
+    constexpr explicit operator T(void) const noexcept {
+        return this->as<T>();
     }
 
-    const array_type& get(void) const noexcept {
-        return _Value;
+    friend constexpr bool operator==(const basic_number& lhs, const basic_number& rhs) noexcept {
+        if (lhs._Kind == rhs._Kind) {
+            switch (lhs._Kind) {
+            case number_kind::integer:          return lhs._Int == rhs._Int;
+            case number_kind::unsigned_integer: return lhs._UInt == rhs._UInt;
+            default:                            return lhs._Float == rhs._Float;
+            }
+        }
+        if (lhs.is_floating()) {
+            return rhs.equals(lhs._Float);
+        }
+        if (rhs.is_floating()) {
+            return lhs.equals(rhs._Float);
+        }
+        return false;
     }
 
-protected:
-    array_type _Value{};
-};
+    template<typename T> requires (std::is_arithmetic_v<T> && !std::same_as<T, bool>)
+    friend constexpr bool operator==(const basic_number& lhs, T rhs) noexcept {
+        return lhs == basic_number(rhs);
+    }
 
-template<typename T, typename JValue, typename Allocator> requires is_default_array<T, basic_array<JValue, Allocator>>
-inline basic_array<JValue, Allocator>& operator<<(basic_array<JValue, Allocator>& jarray, const T& container) {
-    typename basic_array<JValue, Allocator>::array_type _Temp{};
-    for (const auto& value : container) {
-        _Temp.emplace_back() << value;
+    template<typename T> requires (std::is_arithmetic_v<T> && !std::same_as<T, bool>)
+    friend constexpr std::partial_ordering operator<=>(const basic_number& lhs, T rhs) noexcept {
+        return lhs <=> basic_number(rhs);
     }
-    jarray.get() = std::move(_Temp);
-    return jarray;
-}
 
-template<typename T, typename JValue, typename Allocator> requires is_default_array<T, basic_array<JValue, Allocator>>
-inline const basic_array<JValue, Allocator>& operator>>(const basic_array<JValue, Allocator>& jarray, T& container) {
-    using container_value = typename T::value_type;
-    T _Temp{};
-    auto it = std::back_inserter(_Temp, _Temp.end());
-    for (const auto& value : jarray.get()) {
-        *it = std::move(value >> container_value{});
-        ++it;
+    // Exact like operator==, integers are not rounded to double to be compared with floating numbers.
+    friend constexpr std::partial_ordering operator<=>(const basic_number& lhs, const basic_number& rhs) noexcept {
+        if (lhs.is_floating() && rhs.is_floating()) {
+            return lhs._Float <=> rhs._Float;
+        }
+        if (rhs.is_floating()) {
+            return lhs.compare(rhs._Float);
+        }
+        if (lhs.is_floating()) {
+            return 0 <=> rhs.compare(lhs._Float);
+        }
+        if (lhs._Kind == rhs._Kind) {
+            return lhs.is_integer() ? (lhs._Int <=> rhs._Int) : (lhs._UInt <=> rhs._UInt);
+        }
+        return lhs.is_integer() ? std::partial_ordering::less : std::partial_ordering::greater;
     }
-    container = std::move(_Temp);
-    return jarray;
-}
-
-template<typename Char, typename Traits, typename JValue, typename Allocator>
-inline basic_writer<Char, Traits>& operator<<(basic_writer<Char, Traits>& w, const basic_array<JValue, Allocator>& jarray) {
-    return (w << jarray.get());
-}
 
-template<typename Char, typename Traits, typename JValue, typename Allocator>
-inline basic_reader<Char, Traits>& operator>>(basic_reader<Char, Traits>& r, basic_array<JValue, Allocator>& jarray) {
-    return (r >> jarray.get());
-}
+private:
+    // Exact ordering of this integer against a floating point number: the integral part of number is compared
+    // as an integer, its fraction breaks ties.
+    constexpr std::partial_ordering compare(float_type number) const noexcept {
+        constexpr float_type limit = -static_cast<float_type>(std::numeric_limits<int_type>::min());
+        if (number != number) {
+            return std::partial_ordering::unordered;
+        }
+        if (this->is_integer()) {
+            if (number < -limit) {
+                return std::partial_ordering::greater;
+            }
+            if (number >= limit) {
+                return std::partial_ordering::less;
+            }
+            int_type whole = static_cast<int_type>(number);
+            if (_Int != whole) {
+                return _Int <=> whole;
+            }
+            return static_cast<float_type>(whole) <=> number;
+        }
+        if (number < 0) {
+            return std::partial_ordering::greater;
+        }
+        if (number >= 2 * limit) {
+            return std::partial_ordering::less;
+        }
+        uint_type whole = static_cast<uint_type>(number);
+        if (_UInt != whole) {
+            return _UInt <=> whole;
+        }
+        return static_cast<float_type>(whole) <=> number;
+    }
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    template<typename T, typename U>
+    static constexpr T saturate(U number) noexcept {
+        if constexpr (std::is_floating_point_v<T> && std::is_floating_point_v<U>) {
+            if (number > static_cast<U>(std::numeric_limits<T>::max())) {
+                return std::numeric_limits<T>::infinity();
+            }
+            if (number < static_cast<U>(std::numeric_limits<T>::lowest())) {
+                return -std::numeric_limits<T>::infinity();
+            }
+        }
+        else if constexpr (std::is_floating_point_v<U>) {
+            // lowest() is 0 or a power of two and converts exactly, max() may round up to the next one.
+            if (number != number) {
+                return T{};
+            }
+            if (number <= static_cast<U>(std::numeric_limits<T>::lowest())) {
+                return std::numeric_limits<T>::lowest();
+            }
+            if (number >= static_cast<U>(std::numeric_limits<T>::max())) {
+                return std::numeric_limits<T>::max();
+            }
+        }
+        else if constexpr (std::is_integral_v<T>) {
+            if (std::cmp_less(number, std::numeric_limits<T>::lowest())) {
+                return std::numeric_limits<T>::lowest();
+            }
+            if (std::cmp_greater(number, std::numeric_limits<T>::max())) {
+                return std::numeric_limits<T>::max();
+            }
+        }
+        return static_cast<T>(number);
+    }
 
+    // Exact comparison of this integer with a floating point number, 2^53 + 1 is not equal to 2^53.0.
+    constexpr bool equals(float_type number) const noexcept {
+        constexpr float_type limit = -static_cast<float_type>(std::numeric_limits<int_type>::min());
+        if (this->is_integer()) {
+            return number >= -limit && number < limit && static_cast<float_type>(static_cast<int_type>(number)) == number
+                && static_cast<int_type>(number) == _Int;
+        }
+        return number >= limit && number < 2 * limit && static_cast<uint_type>(number) == _UInt;
+    }
 
-//
-// OBJECT
-//
+    template<typename T>
+    constexpr void assign(T number) noexcept {
+        if constexpr (std::is_floating_point_v<T>) {
+            _Kind  = number_kind::floating;
+            _Float = static_cast<float_type>(number);
+        }
+        else if constexpr (std::is_signed_v<T>) {
+            _Kind = number_kind::integer;
+            _Int  = static_cast<int_type>(number);
+        }
+        else if (static_cast<std::uintmax_t>(number) <= static_cast<std::uintmax_t>(std::numeric_limits<int_type>::max())) {
+            _Kind = number_kind::integer;
+            _Int  = static_cast<int_type>(number);
+        }
+        else {
+            _Kind = number_kind::unsigned_integer;
+            _UInt = static_cast<uint_type>(number);
+        }
+    }
 
-template<typename JKey, typename JValue, typename Allocator = std::allocator<std::pair<const JKey, JValue>>>
-class basic_object {
-public:
-    using object_type     = std::unordered_map<JKey, JValue, std::hash<JKey>, std::equal_to<JKey>, Allocator>;
-    using key_type        = typename object_type::key_type;
-    using mapped_type     = typename object_type::mapped_type;
-    using allocator_type  = typename object_type::allocator_type;
-    using size_type       = typename object_type::size_type;
-    using difference_type = typename object_type::difference_type;
-    using iterator        = typename object_type::iterator;
-    using const_iterator  = typename object_type::const_iterator;
+    union {
+        int_type   _Int{ 0 };
+        uint_type  _UInt;
+        float_type _Float;
+    };
+    number_kind _Kind{ number_kind::integer };
+};
 
-    iterator begin(void) noexcept {
-        return _Value.begin();
-    }
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    iterator end(void) noexcept {
-        return _Value.end();
-    }
 
-    const_iterator begin(void) const noexcept {
-        return _Value.begin();
-    }
+//
+// STATS
+// -------
+//  Counters collected by readers and writers when RW_JSON_STATS is defined before this header is included.
+//  Without it stats_enabled is false, the counting code compiles to nothing and statistics stay zero.
+//  Attach a statistics object to a reader, writer, serializer or deserializer with stats(&s), or pass one to
+//  serialize() or deserialize(). Nodes count the values read into or written from basic_value, elements of
+//  packed arrays are not counted. Bytes come from the stream position, streams that cannot report it leave
+//  them at 0. A hook installed with stats_hook::install() receives the statistics of every successful
+//  serialize() and deserialize() call.
+//
 
-    const_iterator end(void) const noexcept {
-        return _Value.end();
-    }
+#ifdef RW_JSON_STATS
+inline constexpr bool stats_enabled = true;
+#else
+inline constexpr bool stats_enabled = false;
+#endif
 
-    const_iterator cbegin(void) const noexcept {
-        return _Value.cbegin();
-    }
+struct statistics {
+    using duration = std::chrono::nanoseconds;
 
-    const_iterator cend(void) const noexcept {
-        return _Value.cend();
-    }
+    std::size_t                bytes{ 0 };
+    std::array<std::size_t, 6> nodes{};
+    std::size_t                max_depth{ 0 };
+    std::size_t                string_bytes{ 0 };
+    std::size_t                escapes{ 0 };
+    duration                   parse_time{ 0 };
+    duration                   convert_time{ 0 };
+    duration                   write_time{ 0 };
 
-    size_type size(void) const noexcept {
-        return _Value.size();
+    std::size_t count(type_id id) const noexcept {
+        return nodes[static_cast<std::size_t>(id)];
     }
 
-    bool contains(const key_type& key) const noexcept {
-        return _Value.contains(key);
+    std::size_t count(void) const noexcept {
+        std::size_t total = 0;
+        for (std::size_t n : nodes) {
+            total += n;
+        }
+        return total;
     }
 
-    mapped_type& operator[](const key_type& key) {
-        return _Value[key];
+    statistics& operator+=(const statistics& other) noexcept {
+        bytes += other.bytes;
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            nodes[i] += other.nodes[i];
+        }
+        max_depth = std::max(max_depth, other.max_depth);
+        string_bytes += other.string_bytes;
+        escapes += other.escapes;
+        parse_time += other.parse_time;
+        convert_time += other.convert_time;
+        write_time += other.write_time;
+        return *this;
     }
+};
 
-    mapped_type& operator[](key_type&& key) {
-        return _Value[std::move(key)];
-    }
+// Receives statistics for export, called on the thread that ran the call.
+class stats_hook {
+public:
+    virtual ~stats_hook() = default;
 
-    const mapped_type& operator[](const key_type& key) const {
-        return _Value.at(key);
-    }
+    virtual void parsed(const statistics& stats) = 0;
+    virtual void serialized(const statistics& stats) = 0;
 
-    object_type& get(void) noexcept {
-        return _Value;
+    // Installs hook for all threads and returns the previous one, nullptr uninstalls. The caller keeps ownership.
+    static stats_hook* install(stats_hook* hook) noexcept {
+        return current().exchange(hook, std::memory_order_acq_rel);
     }
 
-    const object_type& get(void) const noexcept {
-        return _Value;
+    static stats_hook* installed(void) noexcept {
+        return current().load(std::memory_order_acquire);
     }
 
 private:
-    object_type _Value{};
-};
-
-template<typename T, typename JKey, typename JValue, typename Allocator> requires is_default_object<T, basic_object<JKey, JValue, Allocator>>
-inline basic_object<JKey, JValue, Allocator>& operator<<(basic_object<JKey, JValue, Allocator>& jobject, const T& container) {
-    typename basic_object<JKey, JValue, Allocator>::object_type _Temp{};
-    for (const auto& [key, value] : container) {
-        _Temp[typename basic_object<JKey, JValue, Allocator>::key_type(key)] << value;
+    static std::atomic<stats_hook*>& current(void) noexcept {
+        static std::atomic<stats_hook*> hook{ nullptr };
+        return hook;
     }
-    jobject.get() = std::move(_Temp);
-    return jobject;
-}
+};
 
-template<typename T, typename JKey, typename JValue, typename Allocator> requires is_default_object<T, basic_object<JKey, JValue, Allocator>>
-inline basic_object<JKey, JValue, Allocator>& operator<<(basic_object<JKey, JValue, Allocator>& jobject, T&& container) {
-    typename basic_object<JKey, JValue, Allocator>::object_type _Temp{};
-    for (auto&& [key, value] : container) {
-        _Temp[typename basic_object<JKey, JValue, Allocator>::key_type(std::move(key))] << value;
-    }
-    jobject.get() = std::move(_Temp);
-    return jobject;
-}
+namespace detail {
+    // Adds the time until its destruction to one phase of stats.
+    class stats_timer {
+    public:
+        stats_timer(statistics* stats, statistics::duration statistics::* phase) noexcept
+            : _Stats(stats_enabled ? stats : nullptr)
+            , _Phase(phase)
+        {
+            if (_Stats) {
+                _Start = std::chrono::steady_clock::now();
+            }
+        }
 
-template<typename T, typename JKey, typename JValue, typename Allocator> requires is_default_object<T, basic_object<JKey, JValue, Allocator>>
-inline const basic_object<JKey, JValue, Allocator>& operator>>(const basic_object<JKey, JValue, Allocator>& jobject, T& container) {
-    using container_key = std::remove_const_t<typename T::value_type::first_type>;
-    using container_value = typename T::value_type::second_type;
-    T _Temp{};
-    auto it = std::inserter(_Temp, _Temp.end());
-    for (const auto& [key, value] : jobject.get()) {
-        *it = std::pair<container_key&&, container_value&&>(container_key(key), std::move(value >> container_value{}));
-        ++it;
-    }
-    container = std::move(_Temp);
-    return jobject;
-}
+        stats_timer(const stats_timer&) = delete;
+        stats_timer& operator=(const stats_timer&) = delete;
 
-template<typename Char, typename Traits, typename JKey, typename JValue, typename Allocator>
-inline basic_writer<Char, Traits>& operator<<(basic_writer<Char, Traits>& w, const basic_object<JKey, JValue, Allocator>& jobject) {
-    return (w << jobject.get());
-}
+        ~stats_timer() {
+            if (_Stats) {
+                _Stats->*_Phase += std::chrono::duration_cast<statistics::duration>(std::chrono::steady_clock::now() - _Start);
+            }
+        }
 
-template<typename Char, typename Traits, typename JKey, typename JValue, typename Allocator>
-inline basic_reader<Char, Traits>& operator>>(basic_reader<Char, Traits>& r, basic_object<JKey, JValue, Allocator>& jobject) {
-    return (r >> jobject.get());
+    private:
+        statistics*                           _Stats{ nullptr };
+        statistics::duration statistics::*    _Phase{ nullptr };
+        std::chrono::steady_clock::time_point _Start{};
+    };
+
+    // Stream position without touching the stream state, -1 if the buffer cannot tell.
+    template<typename Char, typename Traits>
+    std::streamoff position(std::basic_ios<Char, Traits>& stream, std::ios_base::openmode which) {
+        if (!stream.rdbuf()) {
+            return -1;
+        }
+        return static_cast<std::streamoff>(stream.rdbuf()->pubseekoff(0, std::ios_base::cur, which));
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
 //
-// VALUE
+// WRITER
 //
 
-template<typename Char, typename Traits = std::char_traits<Char>, typename Allocator = std::allocator<Char>>
-class basic_value {
+template<typename Char, typename Traits = std::char_traits<Char>>
+class basic_writer {
 public:
-    using char_type      = Char;
-    using traits_type    = Traits;
-    using allocator_type = Allocator;
-    using null_type      = std::nullptr_t;
-    using string_type    = std::basic_string<Char, Traits, Allocator>;
-    using number_type    = std::double_t;
-    using array_type     = basic_array<basic_value<Char, Traits, Allocator>, typename detail::rebind_alloc_t<basic_value<Char, Traits, Allocator>, Allocator>>;
-    using object_type    = basic_object<string_type, basic_value<Char, Traits, Allocator>, typename detail::rebind_alloc_t<std::pair<const string_type, basic_value<Char, Traits, Allocator>>, Allocator>>;
-    using boolean_type   = bool;
-    using value_type     = std::variant<null_type, string_type, number_type, array_type, object_type, boolean_type>;
-
-    bool is_null(void) const noexcept {
-        return _Value.index() == 0;
+    basic_writer(std::basic_ostream<Char, Traits>& os, bool indentation = false, int level = 0)
+        : _Os(os)
+        , _Indentation(indentation)
+        , _Level(level)
+    {
+        this->indent();
     }
 
-    null_type& to_null(void) {
-        if (!this->is_null()) {
-            _Value = null_type{};
+    basic_writer& operator<<(std::nullptr_t) {
+        if constexpr (std::same_as<Char, char>) {
+            _Os << "null";
         }
-        return std::get<null_type>(_Value);
+        if constexpr (std::same_as<Char, wchar_t>) {
+            _Os << L"null";
+        }
+        if constexpr (std::same_as<Char, char8_t>) {
+            _Os << u8"null";
+        }
+        if constexpr (std::same_as<Char, char16_t>) {
+            _Os << u"null";
+        }
+        if constexpr (std::same_as<Char, char32_t>) {
+            _Os << U"null";
+        }
+        return *this;
     }
 
-    null_type& null(void) {
-        return std::get<null_type>(_Value);
+    template<std::size_t N>
+    basic_writer& operator<<(const Char(&str)[N]) {
+        this->quote(str);
+        return *this;
     }
 
-    null_type& null(null_type& ref) noexcept {
-        if (!this->is_null()) {
-            return ref;
-        }
-        return std::get<null_type>(_Value);
+    template<typename ... Ts>
+    basic_writer& operator<<(const std::basic_string<Char, Ts...>& str) {
+        this->quote(str);
+        return *this;
     }
 
-    const null_type& null(void) const {
-        return std::get<null_type>(_Value);
+    template<typename ... Ts>
+    basic_writer& operator<<(std::basic_string<Char, Ts...>&& str) {
+        this->quote(str);
+        return *this;
     }
 
-    const null_type& null(const null_type& ref) const noexcept {
-        if (!this->is_null()) {
-            return ref;
-        }
-        return std::get<null_type>(_Value);
+    template<typename ... Ts>
+    basic_writer& operator<<(std::basic_string_view<Char, Ts...> str) {
+        this->quote(str);
+        return *this;
     }
 
-    bool is_string(void) const noexcept {
-        return _Value.index() == 1;
+    template<typename T> requires (std::is_arithmetic_v<T> && !std::same_as<bool, T>)
+        basic_writer& operator<<(const T& number) {
+        char buffer[64]{};
+        auto [end, ec] = std::to_chars(std::begin(buffer), std::end(buffer), number);
+        for (const char* it = buffer; it != end; ++it) {
+            _Os.put(Char(*it));
+        }
+        return *this;
     }
 
-    string_type& to_string(void) {
-        if (!this->is_string()) {
-            _Value = string_type{};
+    template<typename Int, typename UInt, typename Float>
+    basic_writer& operator<<(const basic_number<Int, UInt, Float>& number) {
+        switch (number.kind()) {
+        case number_kind::integer:          return (*this) << number.template as<Int>();
+        case number_kind::unsigned_integer: return (*this) << number.template as<UInt>();
+        default:
+            break;
         }
-        return std::get<string_type>(_Value);
+        return (*this) << number.template as<Float>();
     }
 
-    string_type& string(void) {
-        return std::get<string_type>(_Value);
+    template<typename T> requires std::same_as<bool, T>
+    basic_writer& operator<<(const T& object) {
+        _Os << std::boolalpha << object;
+        return *this;
     }
 
-    string_type& string(string_type& ref) noexcept {
-        if (!this->is_string()) {
-            return ref;
+    template<typename Key, typename Value>
+    basic_writer& operator<<(const std::pair<Key, Value>& pair) {
+        if constexpr (detail::is_quotable<Key>) {
+            this->quote(pair.first);
         }
-        return std::get<string_type>(_Value);
+        else if constexpr (std::is_convertible_v<const Key&, std::basic_string_view<Char, Traits>>) {
+            this->quote(std::basic_string_view<Char, Traits>(pair.first));
+        }
+        else {
+            _Os << Char('"');
+            (*this) << pair.first;
+            _Os << Char('"');
+        }
+        _Os << Char(':');
+        this->space();
+        (*this) << pair.second;
+        return *this;
     }
 
-    const string_type& string(void) const {
-        return std::get<string_type>(_Value);
+    template<typename Container> requires detail::is_single_container<Container>
+    basic_writer& operator<<(const Container& container) {
+        return this->sequence(container.begin(), container.end(), Char('['), Char(']'));
     }
 
-    const string_type& string(const string_type& ref) const noexcept {
-        if (!this->is_string()) {
-            return ref;
-        }
-        return std::get<string_type>(_Value);
+    template<typename Container> requires detail::is_pair_container<Container>
+    basic_writer& operator<<(const Container& container) {
+        return this->sequence(container.begin(), container.end(), Char('{'), Char('}'));
     }
 
-    bool is_number(void) const noexcept {
-        return _Value.index() == 2;
+    // Writes [first, last) as a json array, passing every element through projection first.
+    template<typename Iterator, typename Projection = std::identity>
+    basic_writer& array(Iterator first, Iterator last, Projection projection = {}) {
+        return this->sequence(first, last, Char('['), Char(']'), projection);
     }
 
-    number_type& to_number(void) {
-        if (!this->is_number()) {
-            _Value = number_type{};
-        }
-        return std::get<number_type>(_Value);
+    // Writes [first, last) as a json object, projection has to yield key/value pairs.
+    template<typename Iterator, typename Projection = std::identity>
+    basic_writer& object(Iterator first, Iterator last, Projection projection = {}) {
+        return this->sequence(first, last, Char('{'), Char('}'), projection);
     }
 
-    number_type& number(void) {
-        return std::get<number_type>(_Value);
+    // Ends a record of a line-delimited stream, regardless of indentation.
+    void newline(void) {
+        _Os << Char('\n');
     }
 
-    number_type& number(number_type& ref) noexcept {
-        if (!this->is_number()) {
-            return ref;
-        }
-        return std::get<number_type>(_Value);
+    operator bool() const noexcept {
+        return !(_Os.bad() || _Os.fail());
     }
 
-    const number_type& number(void) const {
-        return std::get<number_type>(_Value);
+    // Counts a value about to be written, see STATS.
+    void count(type_id id) noexcept {
+        if constexpr (stats_enabled) {
+            if (_Stats) {
+                ++_Stats->nodes[static_cast<std::size_t>(id)];
+                _Stats->max_depth = std::max(_Stats->max_depth, static_cast<std::size_t>(std::max(_Level, 0)));
+            }
+        }
     }
 
-    const number_type& number(const number_type& ref) const noexcept {
-        if (!this->is_number()) {
-            return ref;
-        }
-        return std::get<number_type>(_Value);
+    void stats(statistics* stats) noexcept {
+        _Stats = stats;
     }
 
-    bool is_boolean(void) const noexcept {
-        return _Value.index() == 5;
+    statistics* stats(void) const noexcept {
+        return _Stats;
     }
 
-    boolean_type& to_boolean(void) {
-        if (!this->is_boolean()) {
-            _Value = boolean_type{};
-        }
-        return std::get<boolean_type>(_Value);
+    // With caching enabled arrays and objects remember where their text was written, and later writes splice
+    // it in until the container is accessed through a non-const member. Modifying a nested value goes through
+    // the non-const accessors of all its ancestors, which marks their text dirty too, so only the modified
+    // paths are written again. A value modified through a reference or iterator taken before a write does not
+    // reach its ancestors, call basic_value::invalidate() on the value written before writing it again. The
+    // outermost container keeps the text of the whole write, nested ones only its location. Concurrent writes
+    // of one value are safe: each claims the containers it writes, and writes those another one holds in full.
+    void caching(bool caching) noexcept {
+        _Caching = caching;
     }
 
-    boolean_type& boolean(void) {
-        return std::get<boolean_type>(_Value);
+    bool caching(void) const noexcept {
+        return _Caching;
     }
 
-    boolean_type& boolean(boolean_type& ref) noexcept {
-        if (!this->is_boolean()) {
-            return ref;
+    // Writes a container through body, or splices the text cached for it when caching is enabled.
+    template<typename Body>
+    basic_writer& cached(const detail::node_cache& cache, Body body) {
+        if (!_Caching) {
+            return body(*this);
+        }
+        detail::text_claim claim(cache);
+        if (!claim.owns()) {
+            basic_writer plain(_Os, *this);
+            plain._Caching = false;
+            body(plain);
+            return *this;
+        }
+        if (_Recording) {
+            return this->record(cache, body);
         }
-        return std::get<boolean_type>(_Value);
-    }
 
-    const boolean_type& boolean(void) const {
-        return std::get<boolean_type>(_Value);
-    }
+        auto* text = cache.template text<Char, Traits>();
+        if (text && !text->dirty && this->anchored(*text)) {
+            _Os.write(text->buffer->data(), static_cast<std::streamsize>(text->length));
+            return *this;
+        }
 
-    const boolean_type& boolean(const boolean_type& ref) const noexcept {
-        if (!this->is_boolean()) {
-            return ref;
+        // The outermost container records the whole write into one buffer, nested ones remember their range.
+        std::basic_ostringstream<Char, Traits> os{};
+        basic_writer nested(os, *this);
+        nested._Recording = true;
+        if (!nested.record(cache, body)) {
+            _Os.setstate(std::ios::failbit);
+            return *this;
         }
-        return std::get<boolean_type>(_Value);
-    }
 
-    bool is_array(void) const noexcept {
-        return _Value.index() == 3;
+        auto buffer = std::make_shared<const std::basic_string<Char, Traits>>(std::move(os).str());
+        _Os.write(buffer->data(), static_cast<std::streamsize>(buffer->size()));
+        if ((text = cache.template text<Char, Traits>()) != nullptr) {
+            text->buffer = std::move(buffer);
+        }
+        return *this;
     }
 
-    array_type& to_array(void) {
-        if (!this->is_array()) {
-            _Value = array_type{};
-        }
-        return std::get<array_type>(_Value);
+protected:
+    // Smaller containers are cheaper to write again than to locate.
+    static constexpr std::size_t cache_threshold = 64;
+
+    // The container being recorded: the text it was last written as, if it can be found, and its new text.
+    struct text_frame {
+        const Char*    old{ nullptr };
+        std::uint64_t  old_id{ 0 };
+        std::uint64_t  id{ 0 };
+        std::streamoff begin{ 0 };
+    };
+
+    // Continues the output of parent into os, without the initial indentation.
+    basic_writer(std::basic_ostream<Char, Traits>& os, const basic_writer& parent)
+        : _Os(os)
+        , _Indentation(parent._Indentation)
+        , _Level(parent._Level)
+        , _Stats(parent._Stats)
+        , _Caching(parent._Caching)
+    {
     }
 
-    array_type& array(void) {
-        return std::get<array_type>(_Value);
+    bool anchored(const detail::text_cache<Char, Traits>& text) const noexcept {
+        return text.buffer && text.indentation == _Indentation && (!_Indentation || text.level == _Level);
     }
 
-    array_type& array(array_type& ref) noexcept {
-        if (!this->is_array()) {
-            return ref;
+    // The text the container was last written as, from its own buffer or from inside the text of the
+    // container being recorded around it.
+    const Char* previous(const detail::text_cache<Char, Traits>* text) const noexcept {
+        if (text == nullptr) {
+            return nullptr;
         }
-        return std::get<array_type>(_Value);
+        if (this->anchored(*text)) {
+            return text->buffer->data();
+        }
+        if (_Frame && _Frame->old && text->parent != 0 && text->parent == _Frame->old_id) {
+            return _Frame->old + text->offset;
+        }
+        return nullptr;
     }
 
-    const array_type& array(void) const {
-        return std::get<array_type>(_Value);
-    }
+    // Writes a container into the recording, splicing its previous text if it is unchanged and otherwise
+    // writing it through body, and records where its text now lies. The caller holds the claim on cache.
+    template<typename Body>
+    basic_writer& record(const detail::node_cache& cache, Body body) {
+        auto*          text  = cache.template text<Char, Traits>();
+        const Char*    old   = this->previous(text);
+        std::streamoff begin = static_cast<std::streamoff>(_Os.tellp());
 
-    const array_type& array(const array_type& ref) const noexcept {
-        if (!this->is_array()) {
-            return ref;
+        text_frame frame{ old, old ? text->id : 0, 0, begin };
+        if (old && !text->dirty) {
+            _Os.write(old, static_cast<std::streamsize>(text->length));
+            frame.id = text->id;
+        }
+        else {
+            frame.id = detail::next_text_id();
+            text_frame* parent = std::exchange(_Frame, &frame);
+            body(*this);
+            _Frame = parent;
+            if (!_Os) {
+                return *this;
+            }
         }
-        return std::get<array_type>(_Value);
-    }
 
-    bool is_object(void) const noexcept {
-        return _Value.index() == 4;
+        std::size_t length = static_cast<std::size_t>(static_cast<std::streamoff>(_Os.tellp()) - begin);
+        if (length < cache_threshold) {
+            cache.drop_text();
+            return *this;
+        }
+
+        auto& entry = cache.template make_text<Char, Traits>();
+        entry.id          = frame.id;
+        entry.parent      = _Frame ? _Frame->id : 0;
+        entry.offset      = _Frame ? static_cast<std::size_t>(begin - _Frame->begin) : 0;
+        entry.length      = length;
+        entry.indentation = _Indentation;
+        entry.level       = _Level;
+        entry.dirty       = false;
+        entry.buffer.reset();
+        return *this;
     }
 
-    object_type& to_object(void) {
-        if (!this->is_object()) {
-            _Value = object_type{};
+    template<typename String>
+    void quote(const String& str) {
+        if constexpr (stats_enabled && std::is_convertible_v<const String&, std::basic_string_view<Char, Traits>>) {
+            if (_Stats) {
+                const std::basic_string_view<Char, Traits> view(str);
+                _Stats->string_bytes += view.size();
+                for (Char c : view) {
+                    _Stats->escapes += (c == Char('"') || c == Char('\\')) ? 1 : 0;
+                }
+            }
         }
-        return std::get<object_type>(_Value);
+        _Os << std::quoted(str);
     }
 
-    object_type& object(void) {
-        return std::get<object_type>(_Value);
-    }
+    template<typename Iterator, typename Projection = std::identity>
+    basic_writer& sequence(Iterator first, Iterator last, Char open, Char close, Projection projection = {}) {
+        if (first == last) {
+            _Os << open << close;
+            return *this;
+        }
 
-    object_type& object(object_type& ref) noexcept {
-        if (!this->is_object()) {
-            return ref;
+        this->begin(open);
+        for (Iterator it = first; it != last; ++it) {
+            if (it != first) {
+                _Os << Char(',');
+            }
+            this->linebreak();
+            this->indent();
+            (*this) << std::invoke(projection, *it);
         }
-        return std::get<object_type>(_Value);
+        this->end(close);
+        return *this;
     }
 
-    const object_type& object(void) const {
-        return std::get<object_type>(_Value);
+    void begin(const Char& c) {
+        _Os << c;
+        ++_Level;
     }
 
-    const object_type& object(const object_type& ref) const noexcept {
-        if (!this->is_object()) {
-            return ref;
+    void end(const Char& c) {
+        this->linebreak();
+        --_Level;
+        this->indent();
+        _Os << c;
+    }
+
+    void linebreak(void) {
+        if (_Indentation) {
+            _Os << Char('\n');
         }
-        return std::get<object_type>(_Value);
     }
 
-    value_type& get(void) noexcept {
-        return _Value;
+    void indent(void) {
+        for (int i = 0; i < _Level && _Indentation; ++i) {
+            _Os << Char('\t');
+        }
     }
 
-    const value_type& get(void) const noexcept {
-        return _Value;
+    void space(void) {
+        if (_Indentation) {
+            _Os << Char(' ');
+        }
     }
 
-private:
-    value_type _Value{ null_type{} };
+    std::basic_ostream<Char, Traits>& _Os;
+    bool                              _Indentation{ false };
+    int                               _Level{ 0 };
+    statistics*                       _Stats{ nullptr };
+    bool                              _Caching{ false };
+    bool                              _Recording{ false };
+    text_frame*                       _Frame{ nullptr };
 };
 
-template<typename Char, typename Traits, typename Allocator>
-inline basic_writer<Char, Traits>& operator<<(basic_writer<Char, Traits>& w, const basic_value<Char, Traits, Allocator>& jvalue) {
-    return std::visit([&](const auto& value) -> basic_writer<Char, Traits>&{
-        return (w << value);
-    }, jvalue.get());
-}
-
-template<typename Char, typename Traits, typename Allocator>
-inline basic_reader<Char, Traits>& operator>>(basic_reader<Char, Traits>& r, basic_value<Char, Traits, Allocator>& jvalue) {
-    switch (r.type()) {
-    case type_id::null:    return (r >> jvalue.to_null());
-    case type_id::string:  return (r >> jvalue.to_string());
-    case type_id::number:  return (r >> jvalue.to_number());
-    case type_id::array:   return (r >> jvalue.to_array());
-    case type_id::object:  return (r >> jvalue.to_object());
-    case type_id::boolean: return (r >> jvalue.to_boolean());
-    default:
-        throw std::bad_typeid();
-    }
-}
+using writer    = basic_writer<char>;
+using wwriter   = basic_writer<wchar_t>;
+using u8writer  = basic_writer<char8_t>;
+using u16writer = basic_writer<char16_t>;
+using u32writer = basic_writer<char32_t>;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
 //
-// NULL
+// READER
+// --------
+//  read_flags::reuse parses into the existing value instead of building a new one. Strings, vectors and
+//  object entries are overwritten in place wherever the shape matches, so re-reading a document of the same
+//  shape does not allocate. On error the target is left partially overwritten.
+//  read_flags::pack_arrays stores arrays holding only numbers or only booleans in a packed buffer, see ARRAY.
 //
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_null<T, typename basic_value<Char, Traits, Allocator>::null_type>
-basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
-    jvalue.get() = typename basic_value<Char, Traits, Allocator>::null_type(value);
-    return jvalue;
-}
-
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_null<T, typename basic_value<Char, Traits, Allocator>::null_type>
-basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
-    jvalue.get() = typename basic_value<Char, Traits, Allocator>::null_type(std::forward<T>(value));
-    return jvalue;
-}
-
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_null<T, typename basic_value<Char, Traits, Allocator>::null_type>
-const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
-    value = T(std::get<typename basic_value<Char, Traits, Allocator>::null_type>(jvalue.get()));
-    return jvalue;
-}
-
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::null_type>
-basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
-    typename basic_value<Char, Traits, Allocator>::null_type v{};
-    jvalue.get() = std::move(v << value);
-    return jvalue;
-}
+enum class read_flags : unsigned {
+    none        = 0,
+    reuse       = 1 << 0,
+    pack_arrays = 1 << 1
+};
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::null_type>
-basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
-    typename basic_value<Char, Traits, Allocator>::null_type v{};
-    jvalue.get() = std::move(v << value);
-    return jvalue;
+constexpr read_flags operator|(read_flags lhs, read_flags rhs) noexcept {
+    return static_cast<read_flags>(static_cast<unsigned>(lhs) | static_cast<unsigned>(rhs));
 }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::null_type>
-const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
-    std::get<typename basic_value<Char, Traits, Allocator>::null_type>(jvalue.get()) >> value;
-    return jvalue;
+constexpr read_flags operator&(read_flags lhs, read_flags rhs) noexcept {
+    return static_cast<read_flags>(static_cast<unsigned>(lhs) & static_cast<unsigned>(rhs));
 }
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template<typename Char, typename Traits = std::char_traits<Char>>
+class basic_reader {
+public:
+    basic_reader(std::basic_istream<Char, Traits>& is, basic_key_pool<Char, Traits>* pool = nullptr)
+        : _Is(is)
+        , _Pool(pool)
+    {
+    }
 
+    basic_reader(std::basic_istream<Char, Traits>& is, read_flags flags, basic_key_pool<Char, Traits>* pool = nullptr)
+        : _Is(is)
+        , _Pool(pool)
+        , _Flags(flags)
+    {
+    }
 
-//
-// STRING
-//
+    type_id type(void) const noexcept {
+        _Is >> std::ws;
+        Char ch = _Is.peek();
+        switch (ch) {
+        case Char('n'): return type_id::null;
+        case Char('"'): return type_id::string;
+        case Char('0'): return type_id::number;
+        case Char('1'): return type_id::number;
+        case Char('2'): return type_id::number;
+        case Char('3'): return type_id::number;
+        case Char('4'): return type_id::number;
+        case Char('5'): return type_id::number;
+        case Char('6'): return type_id::number;
+        case Char('7'): return type_id::number;
+        case Char('8'): return type_id::number;
+        case Char('9'): return type_id::number;
+        case Char('-'): return type_id::number;
+        case Char('['): return type_id::array;
+        case Char('{'): return type_id::object;
+        case Char('t'): return type_id::boolean;
+        case Char('f'): return type_id::boolean;
+        default:
+            break;
+        }
+        return type_id::invalid;
+    }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_string<T, typename basic_value<Char, Traits, Allocator>::string_type>
-basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
-    jvalue.get() = typename basic_value<Char, Traits, Allocator>::string_type(value);
-    return jvalue;
-}
+    basic_reader& operator>>(std::nullptr_t) {
+        Char ch[5]{};
+        _Is >> ch;
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_string<T, typename basic_value<Char, Traits, Allocator>::string_type>
-basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
-    jvalue.get() = typename basic_value<Char, Traits, Allocator>::string_type(std::forward<T>(value));
-    return jvalue;
-}
+        bool _Equals = false;
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_string<T, typename basic_value<Char, Traits, Allocator>::string_type>
+        if constexpr (std::same_as<Char, char>) {
+            _Equals = std::memcmp(ch, "null", 5 * sizeof(Char)) == 0;
+        }
+        if constexpr (std::same_as<Char, wchar_t>) {
+            _Equals = std::memcmp(ch, L"null", 5 * sizeof(Char)) == 0;
+        }
+        if constexpr (std::same_as<Char, char8_t>) {
+            _Equals = std::memcmp(ch, u8"null", 5 * sizeof(Char)) == 0;
+        }
+        if constexpr (std::same_as<Char, char16_t>) {
+            _Equals = std::memcmp(ch, u"null", 5 * sizeof(Char)) == 0;
+        }
+        if constexpr (std::same_as<Char, char32_t>) {
+            _Equals = std::memcmp(ch, U"null", 5 * sizeof(Char)) == 0;
+        }
+
+        if (!_Equals) {
+            _Is.setstate(std::ios::failbit);
+        }
+
+        return *this;
+    }
+
+    template<typename ... Ts>
+    basic_reader& operator>>(std::basic_string<Char, Ts...>& str) {
+        this->unquote(str);
+        return *this;
+    }
+
+    template<typename T> requires (std::is_arithmetic_v<T> && !std::same_as<bool, T>)
+        basic_reader& operator>>(T& number) {
+        this->read_number();
+        if (!this->parse_number(number)) {
+            _Is.setstate(std::ios::failbit);
+        }
+        return *this;
+    }
+
+    template<typename Int, typename UInt, typename Float>
+    basic_reader& operator>>(basic_number<Int, UInt, Float>& number) {
+        bool floating = this->read_number();
+
+        if (!floating) {
+            Int i{};
+            if (this->parse_number(i)) {
+                number = i;
+                return *this;
+            }
+            UInt u{};
+            if (_Number.front() != '-' && this->parse_number(u)) {
+                number = u;
+                return *this;
+            }
+        }
+
+        Float f{};
+        if (!this->parse_number(f)) {
+            _Is.setstate(std::ios::failbit);
+        }
+        number = f;
+        return *this;
+    }
+
+    template<typename T> requires std::same_as<bool, T>
+    basic_reader& operator>>(T& b) {
+        _Is >> std::boolalpha >> b;
+        return *this;
+    }
+
+    template<typename Key, typename Value>
+    basic_reader& operator>>(std::pair<Key, Value>& pair) {
+        Char ch{};
+        if constexpr (detail::is_quotable<Key>) {
+            this->unquote(pair.first);
+        }
+        else if constexpr (std::constructible_from<Key, const basic_interned_key<Char, Traits>&> && std::constructible_from<Key, std::basic_string_view<Char, Traits>>) {
+            this->unquote(_Key);
+            pair.first = this->template make_key<Key>();
+        }
+        else {
+            _Is >> ch;
+            if (ch != Char('"')) {
+                _Is.setstate(std::ios::failbit);
+                return *this;
+            }
+
+            (*this) >> pair.first;
+
+            _Is >> ch;
+            if (ch != Char('"')) {
+                _Is.setstate(std::ios::failbit);
+                return *this;
+            }
+        }
+
+        _Is >> ch;
+        if (ch != Char(':')) {
+            _Is.setstate(std::ios::failbit);
+            return *this;
+        }
+
+        (*this) >> pair.second;
+        return *this;
+    }
+
+    template<typename Container> requires detail::is_single_container<Container>
+    basic_reader& operator>>(Container& container) {
+        if constexpr (detail::is_reusable_sequence<Container>) {
+            if ((_Flags & read_flags::reuse) != read_flags::none) {
+                return this->read_into(container);
+            }
+        }
+
+        Container _Temp{};
+        Char ch{};
+        _Is >> ch;
+        if (ch != Char('[')) {
+            _Is.setstate(std::ios::failbit);
+            return *this;
+        }
+
+        if ((_Is >> std::ws).peek() != Char(']')) {
+            this->reserve(_Temp);
+            ++_Depth;
+            auto it = std::back_inserter(_Temp);
+            do {
+                typename Container::value_type _TempValue{};
+                (*this) >> _TempValue;
+                *it = std::move(_TempValue);
+                _Is >> ch;
+                ++it;
+            } while (ch == Char(','));
+            --_Depth;
+            this->hint(_Temp.size());
+        }
+        else {
+            _Is >> ch;
+        }
+
+        if (ch != Char(']')) {
+            _Is.setstate(std::ios::failbit);
+            return *this;
+        }
+
+        container = std::move(_Temp);
+
+        return *this;
+    }
+
+    template<typename Container> requires detail::is_pair_container<Container>
+    basic_reader& operator>>(Container& container) {
+        using pair_type = std::pair<std::remove_const_t<typename Container::value_type::first_type>, typename Container::value_type::second_type>;
+
+        if constexpr (detail::is_reusable_map<Container> && std::constructible_from<typename Container::key_type, std::basic_string_view<Char, Traits>>) {
+            if ((_Flags & read_flags::reuse) != read_flags::none) {
+                return this->read_into(container);
+            }
+        }
+
+        Container _Temp{};
+        Char ch{};
+        _Is >> ch;
+        if (ch != Char('{')) {
+            _Is.setstate(std::ios::failbit);
+            return *this;
+        }
+
+        if ((_Is >> std::ws).peek() != Char('}')) {
+            this->reserve(_Temp);
+            ++_Depth;
+            auto it = std::inserter(_Temp, _Temp.end());
+            do {
+                pair_type _TempValue{};
+                (*this) >> _TempValue;
+                *it = std::move(_TempValue);
+                _Is >> ch;
+                ++it;
+            } while (ch == Char(','));
+            --_Depth;
+            this->hint(_Temp.size());
+        }
+        else {
+            _Is >> ch;
+        }
+
+        if (ch != Char('}')) {
+            _Is.setstate(std::ios::failbit);
+            return *this;
+        }
+
+        container = std::move(_Temp);
+
+        return *this;
+    }
+
+    bool consume(Char c) {
+        _Is >> std::ws;
+        if (!Traits::eq_int_type(_Is.peek(), Traits::to_int_type(c))) {
+            return false;
+        }
+        _Is.get();
+        return true;
+    }
+
+    bool expect(Char c) {
+        Char ch{};
+        _Is >> ch;
+        if (ch != c) {
+            _Is.setstate(std::ios::failbit);
+            return false;
+        }
+        return true;
+    }
+
+    // Steps over the next value without building it. Only the structure is checked, not the scalars.
+    bool skip(void) {
+        _Is >> std::ws;
+        std::size_t depth = 0;
+        do {
+            auto ch = _Is.get();
+            if (Traits::eq_int_type(ch, Traits::eof())) {
+                _Is.setstate(std::ios::failbit);
+                return false;
+            }
+            switch (Traits::to_char_type(ch)) {
+            case Char('"'):
+                for (ch = _Is.get(); !Traits::eq_int_type(ch, Traits::eof()); ch = _Is.get()) {
+                    if (Traits::eq_int_type(ch, Traits::to_int_type(Char('\\')))) {
+                        _Is.get();
+                    }
+                    else if (Traits::eq_int_type(ch, Traits::to_int_type(Char('"')))) {
+                        break;
+                    }
+                }
+                break;
+            case Char('['):
+            case Char('{'):
+                ++depth;
+                break;
+            case Char(']'):
+            case Char('}'):
+                if (depth == 0) {
+                    _Is.setstate(std::ios::failbit);
+                    return false;
+                }
+                --depth;
+                break;
+            default:
+                if (depth == 0) {
+                    for (ch = _Is.peek(); !Traits::eq_int_type(ch, Traits::eof()) && !this->delimiter(Traits::to_char_type(ch)); ch = _Is.peek()) {
+                        _Is.get();
+                    }
+                }
+                break;
+            }
+        } while (depth > 0);
+        return static_cast<bool>(*this);
+    }
+
+    operator bool() const noexcept {
+        return !(_Is.bad() || _Is.fail());
+    }
+
+    void pool(basic_key_pool<Char, Traits>* pool) noexcept {
+        _Pool = pool;
+    }
+
+    basic_key_pool<Char, Traits>* pool(void) const noexcept {
+        return _Pool;
+    }
+
+    void flags(read_flags flags) noexcept {
+        _Flags = flags;
+    }
+
+    read_flags flags(void) const noexcept {
+        return _Flags;
+    }
+
+    // Counts a value about to be read, see STATS.
+    void count(type_id id) noexcept {
+        if constexpr (stats_enabled) {
+            if (_Stats && id != type_id::invalid) {
+                ++_Stats->nodes[static_cast<std::size_t>(id)];
+                _Stats->max_depth = std::max(_Stats->max_depth, _Depth);
+            }
+        }
+    }
+
+    void stats(statistics* stats) noexcept {
+        _Stats = stats;
+    }
+
+    statistics* stats(void) const noexcept {
+        return _Stats;
+    }
+
+protected:
+    // Escapes are what the quoted text takes beyond the unescaped characters and the two quotes.
+    template<typename String>
+    void unquote(String& str) {
+        if constexpr (stats_enabled) {
+            if (_Stats) {
+                _Is >> std::ws;
+                const std::streamoff first = detail::position(_Is, std::ios_base::in);
+                _Is >> std::quoted(str);
+                const std::streamoff last = detail::position(_Is, std::ios_base::in);
+                _Stats->string_bytes += str.size();
+                if (first >= 0 && last >= first + 2 + static_cast<std::streamoff>(str.size())) {
+                    _Stats->escapes += static_cast<std::size_t>(last - first - 2) - str.size();
+                }
+                return;
+            }
+        }
+        _Is >> std::quoted(str);
+    }
+
+    template<typename Container> requires detail::is_reusable_sequence<Container>
+    basic_reader& read_into(Container& container) {
+        if (!this->expect(Char('['))) {
+            return *this;
+        }
+
+        std::size_t count = 0;
+        if (!this->consume(Char(']'))) {
+            ++_Depth;
+            do {
+                if (count == container.size()) {
+                    container.emplace_back();
+                }
+                (*this) >> *(container.begin() + count);
+                ++count;
+            } while (*this && this->consume(Char(',')));
+            --_Depth;
+            this->expect(Char(']'));
+        }
+
+        container.erase(container.begin() + count, container.end());
+        return *this;
+    }
+
+    template<typename Container> requires detail::is_reusable_map<Container>
+    basic_reader& read_into(Container& container) {
+        using key_type = typename Container::key_type;
+
+        if (!this->expect(Char('{'))) {
+            return *this;
+        }
+
+        std::size_t count = 0;
+        if (!this->consume(Char('}'))) {
+            ++_Depth;
+            do {
+                this->unquote(_Key);
+                if (!this->expect(Char(':'))) {
+                    break;
+                }
+
+                auto it = container.begin() + count;
+                if (count < container.size() && it->first == std::basic_string_view<Char, Traits>(_Key)) {
+                    (*this) >> it->second;
+                    ++count;
+                    continue;
+                }
+
+                container.erase(it, container.end());
+                auto [pos, inserted] = container.try_emplace(this->template make_key<key_type>());
+                if (inserted) {
+                    (*this) >> pos->second;
+                    ++count;
+                }
+                else {
+                    typename Container::mapped_type discard{};
+                    (*this) >> discard;
+                }
+            } while (*this && this->consume(Char(',')));
+            --_Depth;
+            this->expect(Char('}'));
+        }
+
+        container.erase(container.begin() + count, container.end());
+        return *this;
+    }
+
+    template<typename Key>
+    Key make_key(void) const {
+        if constexpr (std::constructible_from<Key, const basic_interned_key<Char, Traits>&>) {
+            if (_Pool) {
+                return Key(_Pool->intern(_Key));
+            }
+        }
+        return Key(std::basic_string_view<Char, Traits>(_Key));
+    }
+
+    //
+    // Containers reserve the element count of the last container read at the same depth,
+    // documents with repeating shapes, e.g. arrays of records, then grow each record only once.
+    //
+
+    static constexpr std::size_t hint_limit = 4096;
+
+    template<typename Container>
+    void reserve(Container& container) {
+        if constexpr (detail::is_reservable<Container>) {
+            if (_Depth < _Hints.size() && _Hints[_Depth] > 0) {
+                container.reserve(std::min(_Hints[_Depth], hint_limit));
+            }
+        }
+    }
+
+    void hint(std::size_t count) {
+        if (_Hints.size() <= _Depth) {
+            _Hints.resize(_Depth + 1);
+        }
+        _Hints[_Depth] = count;
+    }
+
+    bool read_number(void) {
+        bool floating = false;
+        _Number.clear();
+        _Is >> std::ws;
+        for (auto ch = _Is.peek(); !Traits::eq_int_type(ch, Traits::eof()); ch = _Is.peek()) {
+            switch (Traits::to_char_type(ch)) {
+            case Char('.'):
+            case Char('e'):
+            case Char('E'):
+                floating = true;
+                [[fallthrough]];
+            case Char('0'): case Char('1'): case Char('2'): case Char('3'): case Char('4'):
+            case Char('5'): case Char('6'): case Char('7'): case Char('8'): case Char('9'):
+            case Char('-'):
+            case Char('+'):
+                _Number.push_back(static_cast<char>(Traits::to_char_type(ch)));
+                _Is.get();
+                continue;
+            default:
+                break;
+            }
+            break;
+        }
+        if (_Number.empty()) {
+            _Is.setstate(std::ios::failbit);
+            _Number.push_back('\0');
+        }
+        return floating;
+    }
+
+    static bool delimiter(Char ch) noexcept {
+        switch (ch) {
+        case Char(','): case Char(']'): case Char('}'):
+        case Char(' '): case Char('\t'): case Char('\n'): case Char('\r'):
+            return true;
+        default:
+            break;
+        }
+        return false;
+    }
+
+    template<typename T>
+    bool parse_number(T& number) const noexcept {
+        const char* first = _Number.data();
+        const char* last  = _Number.data() + _Number.size();
+        auto [end, ec] = std::from_chars(first, last, number);
+        return ec == std::errc{} && end == last;
+    }
+
+    std::basic_istream<Char, Traits>& _Is;
+    basic_key_pool<Char, Traits>*     _Pool{ nullptr };
+    read_flags                        _Flags{ read_flags::none };
+    std::basic_string<Char, Traits>   _Key{};
+    std::string                       _Number{};
+    std::vector<std::size_t>          _Hints{};
+    std::size_t                       _Depth{ 0 };
+    statistics*                       _Stats{ nullptr };
+};
+
+using reader    = basic_reader<char>;
+using wreader   = basic_reader<wchar_t>;
+using u8reader  = basic_reader<char8_t>;
+using u16reader = basic_reader<char16_t>;
+using u32reader = basic_reader<char32_t>;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  FULL API
+// ----------
+//  Provides extended access to c++<=>json mappings.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//
+// CONCEPTS
+//
+
+template<typename T, typename JType>
+concept is_user_value = requires (const T& ut, JType& jt) {
+    { jt << ut } -> std::same_as<JType&>;
+}&& requires (T& ut, const JType& jt) {
+    { jt >> ut } -> std::same_as<const JType&>;
+};
+
+template<typename T, typename JNull>
+concept is_default_null = std::same_as<T, JNull>;
+
+template<typename T, typename JString>
+concept is_default_string = std::constructible_from<JString, T> && !std::same_as<T, std::nullptr_t>;
+
+template<typename T, typename JNumber>
+concept is_default_number = std::is_arithmetic_v<T> && !std::same_as<T, bool>;
+
+template<typename T, typename JArray>
+concept is_default_array = detail::is_single_container<T> && is_user_value<typename T::value_type, typename JArray::value_type> && !is_default_string<T, typename JArray::value_type::string_type>;
+
+template<typename T, typename JObject>
+concept is_default_object = detail::is_pair_container<T> && is_user_value<typename T::mapped_type, typename JObject::mapped_type>;
+
+template<typename T, typename JBool>
+concept is_default_boolean = std::same_as<T, JBool>;
+
+template<typename T, typename JSerializer>
+concept is_serializable = requires (const JSerializer& js, const T& val) {
+    { js(std::declval<typename JSerializer::stream_type&>(), val) } -> std::same_as<const JSerializer&>;
+};
+
+template<typename T, typename JDeserializer>
+concept is_deserializable = requires (const JDeserializer& jds, T& val) {
+    { jds(std::declval<typename JDeserializer::stream_type&>(), val) } -> std::same_as<const JDeserializer&>;
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// ARRAY
+// -------
+//  An array holding only numbers or only booleans can be packed into one contiguous buffer of double_t,
+//  int64_t or uint8_t (0 or 1) instead of one value per element. Arrays are packed when converted from a
+//  container of such elements, by pack() or when read with read_flags::pack_arrays. span<T>() exposes the
+//  buffer, and the writer and container conversions use it directly.
+//  Non-const access through iterators, operator[] or get() unpacks the array first. Const access never does:
+//  the const iterators and element() yield the elements of a packed array by value, converted on the fly,
+//  while the const operator[] and get(), which return references into the storage, throw std::logic_error
+//  for packed arrays.
+//
+
+template<typename JValue, typename Allocator = std::allocator<JValue>>
+class basic_array {
+public:
+    using array_type      = std::vector<JValue, Allocator>;
+    using value_type      = typename array_type::value_type;
+    using allocator_type  = typename array_type::allocator_type;
+    using size_type       = typename array_type::size_type;
+    using difference_type = typename array_type::difference_type;
+    using iterator        = typename array_type::iterator;
+    using float_type      = std::double_t;
+    using integer_type    = std::int64_t;
+    using boolean_type    = std::uint8_t;
+
+    template<typename T>
+    using packed_type     = std::vector<T, typename std::allocator_traits<Allocator>::template rebind_alloc<T>>;
+
+    template<typename T>
+    static constexpr bool is_packable = std::same_as<T, float_type> || std::same_as<T, integer_type> || std::same_as<T, boolean_type>;
+
+    // Iterates any storage without unpacking it. Elements of unpacked arrays are referenced in place, those
+    // of packed arrays are converted into the iterator and the reference stays valid until it is advanced.
+    class const_iterator {
+    public:
+        using value_type        = JValue;
+        using reference         = const JValue&;
+        using pointer           = const JValue*;
+        using difference_type   = std::ptrdiff_t;
+        using iterator_category = std::input_iterator_tag;
+
+        const_iterator(void) = default;
+
+        const_iterator(const basic_array& array, size_type index) noexcept
+            : _Array(&array)
+            , _Values(array.packed() ? nullptr : std::get<array_type>(array._Value).data())
+            , _Index(index)
+        {
+        }
+
+        reference operator*(void) const {
+            if (_Values != nullptr) {
+                return _Values[_Index];
+            }
+            _Element = _Array->element(_Index);
+            return _Element;
+        }
+
+        pointer operator->(void) const {
+            return &**this;
+        }
+
+        const_iterator& operator++(void) noexcept {
+            ++_Index;
+            return *this;
+        }
+
+        const_iterator operator++(int) noexcept {
+            const_iterator it = *this;
+            ++_Index;
+            return it;
+        }
+
+        friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) noexcept {
+            return lhs._Index == rhs._Index;
+        }
+
+    private:
+        const basic_array* _Array{ nullptr };
+        const JValue*      _Values{ nullptr };
+        size_type          _Index{ 0 };
+        mutable JValue     _Element{};
+    };
+
+    iterator begin(void) {
+        return this->get().begin();
+    }
+
+    iterator end(void) {
+        return this->get().end();
+    }
+
+    const_iterator begin(void) const noexcept {
+        return const_iterator(*this, 0);
+    }
+
+    const_iterator end(void) const noexcept {
+        return const_iterator(*this, this->size());
+    }
+
+    const_iterator cbegin(void) const noexcept {
+        return this->begin();
+    }
+
+    const_iterator cend(void) const noexcept {
+        return this->end();
+    }
+
+    size_type size(void) const noexcept {
+        return std::visit([](const auto& storage) -> size_type { return storage.size(); }, _Value);
+    }
+
+    size_type capacity(void) const noexcept {
+        return std::visit([](const auto& storage) -> size_type { return storage.capacity(); }, _Value);
+    }
+
+    void reserve(size_type count) {
+        std::visit([count](auto& storage) { storage.reserve(count); }, _Value);
+    }
+
+    bool contains(size_type idx) const noexcept {
+        return idx < size();
+    }
+
+    value_type& operator[](size_type idx) {
+        array_type& array = this->get();
+        if (idx >= array.size()) {
+            array.resize(idx + 1);
+        }
+        return array[idx];
+    }
+
+    const value_type& operator[](size_type idx) const {
+        return this->get()[idx];
+    }
+
+    // The element at idx by value, for packed and unpacked arrays alike.
+    value_type element(size_type idx) const {
+        return std::visit([idx](const auto& storage) -> value_type {
+            using element_type = typename std::remove_cvref_t<decltype(storage)>::value_type;
+            if constexpr (std::same_as<element_type, value_type>) {
+                return storage[idx];
+            }
+            else {
+                value_type _Temp{};
+                if constexpr (std::same_as<element_type, boolean_type>) {
+                    _Temp << (storage[idx] != 0);
+                }
+                else {
+                    _Temp << storage[idx];
+                }
+                return _Temp;
+            }
+        }, _Value);
+    }
+
+    array_type& get(void) {
+        this->unpack();
+        _Cache.reset();
+        return std::get<array_type>(_Value);
+    }
+
+    const array_type& get(void) const {
+        if (this->packed()) {
+            throw std::logic_error("Packed json array has no values to reference, iterate it or use element()");
+        }
+        return std::get<array_type>(_Value);
+    }
+
+    bool packed(void) const noexcept {
+        return _Value.index() != 0;
+    }
+
+    template<typename T> requires is_packable<T>
+    bool packed(void) const noexcept {
+        return std::holds_alternative<packed_type<T>>(_Value);
+    }
+
+    template<typename T> requires is_packable<T>
+    std::span<const T> span(void) const {
+        return std::get<packed_type<T>>(_Value);
+    }
+
+    template<typename T> requires is_packable<T>
+    packed_type<T>& to_packed(void) {
+        _Cache.reset();
+        if (!this->template packed<T>()) {
+            _Value = packed_type<T>{};
+        }
+        return std::get<packed_type<T>>(_Value);
+    }
+
+    // Merkle style hash over the elements, cached until the array is accessed through a non-const member or
+    // invalidated. Packed and unpacked arrays with equal elements hash equal.
+    std::size_t hash(void) const {
+        if (std::size_t cached = _Cache.load()) {
+            return cached;
+        }
+
+        std::size_t seed = detail::combine_hash(7, this->size());
+        std::visit([&](const auto& storage) {
+            using element_type = typename std::remove_cvref_t<decltype(storage)>::value_type;
+            for (const auto& element : storage) {
+                if constexpr (std::same_as<element_type, boolean_type>) {
+                    seed = detail::combine_hash(seed, detail::hash_boolean(element != 0));
+                }
+                else if constexpr (std::same_as<element_type, value_type>) {
+                    seed = detail::combine_hash(seed, element.hash());
+                }
+                else {
+                    seed = detail::combine_hash(seed, detail::hash_number(element));
+                }
+            }
+        }, _Value);
+        return _Cache.store(seed);
+    }
+
+    // The hash if it has been computed and nothing changed since, 0 otherwise.
+    std::size_t cached_hash(void) const noexcept {
+        return _Cache.load();
+    }
+
+    // Drops the cached hash and marks the cached text dirty, as non-const access does.
+    void invalidate(void) noexcept {
+        _Cache.reset();
+    }
+
+    const detail::node_cache& cache(void) const noexcept {
+        return _Cache;
+    }
+
+    // Packs the elements if they are all booleans or all numbers that fit int64_t or double_t exactly
+    // enough to round trip. Returns whether the array is packed afterwards.
+    bool pack(void) {
+        if (this->packed()) {
+            return true;
+        }
+
+        const array_type& array = std::get<array_type>(_Value);
+        if (array.empty()) {
+            return false;
+        }
+
+        bool booleans = true;
+        bool integers = true;
+        bool numbers  = true;
+        bool exact    = true;
+        for (const value_type& element : array) {
+            booleans = booleans && element.is_boolean();
+            numbers  = numbers && element.is_number() && !element.number().is_unsigned_integer();
+            integers = integers && numbers && element.number().is_integer();
+            exact    = exact && (!numbers || !element.number().is_integer() || fits_float(element.number().template as<integer_type>()));
+        }
+
+        if (booleans) {
+            packed_type<boolean_type> _Temp{};
+            _Temp.reserve(array.size());
+            for (const value_type& element : array) {
+                _Temp.push_back(element.boolean() ? 1 : 0);
+            }
+            _Value = std::move(_Temp);
+        }
+        else if (integers) {
+            packed_type<integer_type> _Temp{};
+            _Temp.reserve(array.size());
+            for (const value_type& element : array) {
+                _Temp.push_back(element.number().template as<integer_type>());
+            }
+            _Value = std::move(_Temp);
+        }
+        else if (numbers && exact) {
+            packed_type<float_type> _Temp{};
+            _Temp.reserve(array.size());
+            for (const value_type& element : array) {
+                _Temp.push_back(element.number().template as<float_type>());
+            }
+            _Value = std::move(_Temp);
+        }
+        return this->packed();
+    }
+
+    void unpack(void) {
+        if (!this->packed()) {
+            return;
+        }
+
+        array_type _Temp{};
+        _Temp.reserve(this->size());
+        _Temp.insert(_Temp.end(), this->cbegin(), this->cend());
+        _Value = std::move(_Temp);
+    }
+
+    // Reads a json array, packing it while the elements allow it and falling back to
+    // plain values at the first element that does not fit.
+    template<typename Char, typename Traits>
+    basic_reader<Char, Traits>& read_packed(basic_reader<Char, Traits>& r) {
+        if (!r.expect(Char('['))) {
+            return r;
+        }
+
+        _Cache.reset();
+        switch (r.type()) {
+        case type_id::number:  this->restart<integer_type>(); break;
+        case type_id::boolean: this->restart<boolean_type>(); break;
+        default:               this->restart<value_type>();   break;
+        }
+
+        if (r.consume(Char(']'))) {
+            return r;
+        }
+
+        do {
+            this->read_element(r);
+        } while (r && r.consume(Char(',')));
+        r.expect(Char(']'));
+        return r;
+    }
+
+protected:
+    using storage_type = std::variant<array_type, packed_type<float_type>, packed_type<integer_type>, packed_type<boolean_type>>;
+    using number_type  = basic_number<integer_type, std::uint64_t, float_type>;
+
+    // Switches to the storage for T, keeping the capacity when it is already in use.
+    template<typename T>
+    void restart(void) {
+        if constexpr (std::same_as<T, value_type>) {
+            if (!this->packed()) {
+                std::get<array_type>(_Value).clear();
+                return;
+            }
+            _Value = array_type{};
+        }
+        else {
+            this->template to_packed<T>().clear();
+        }
+    }
+
+    // Whether the integer survives a round trip through float_type, integers above 2^53 mostly do not.
+    static bool fits_float(integer_type number) noexcept {
+        const float_type real = static_cast<float_type>(number);
+        return real < -static_cast<float_type>(std::numeric_limits<integer_type>::min()) && static_cast<integer_type>(real) == number;
+    }
+
+    void append(const number_type& number) {
+        value_type& element = std::get<array_type>(_Value).emplace_back();
+        switch (number.kind()) {
+        case number_kind::integer:          element << number.template as<integer_type>();  break;
+        case number_kind::unsigned_integer: element << number.template as<std::uint64_t>(); break;
+        default:                            element << number.template as<float_type>();    break;
+        }
+    }
+
+    // Integers are promoted to floats at the first floating point element only if every one of them
+    // round trips through float_type, otherwise the array falls back to plain values.
+    template<typename Char, typename Traits>
+    void read_element(basic_reader<Char, Traits>& r) {
+        type_id type = r.type();
+
+        if (auto* integers = std::get_if<packed_type<integer_type>>(&_Value); integers && type == type_id::number) {
+            number_type number{};
+            r >> number;
+            if (number.is_integer()) {
+                integers->push_back(number.template as<integer_type>());
+                return;
+            }
+            if (number.is_floating() && std::ranges::all_of(*integers, &basic_array::fits_float)) {
+                packed_type<float_type> _Temp(integers->begin(), integers->end());
+                _Temp.push_back(number.template as<float_type>());
+                _Value = std::move(_Temp);
+                return;
+            }
+            this->unpack();
+            this->append(number);
+            return;
+        }
+
+        if (auto* floats = std::get_if<packed_type<float_type>>(&_Value); floats && type == type_id::number) {
+            number_type number{};
+            r >> number;
+            if (number.is_floating() || (number.is_integer() && fits_float(number.template as<integer_type>()))) {
+                floats->push_back(number.template as<float_type>());
+                return;
+            }
+            this->unpack();
+            this->append(number);
+            return;
+        }
+
+        if (auto* booleans = std::get_if<packed_type<boolean_type>>(&_Value); booleans && type == type_id::boolean) {
+            bool boolean{};
+            r >> boolean;
+            booleans->push_back(boolean ? 1 : 0);
+            return;
+        }
+
+        this->unpack();
+        r >> std::get<array_type>(_Value).emplace_back();
+    }
+
+    storage_type       _Value{};
+    detail::node_cache _Cache{};
+};
+
+template<typename T, typename JValue, typename Allocator> requires is_default_array<T, basic_array<JValue, Allocator>>
+inline basic_array<JValue, Allocator>& operator<<(basic_array<JValue, Allocator>& jarray, const T& container) {
+    using array_type   = basic_array<JValue, Allocator>;
+    using element_type = typename T::value_type;
+
+    if constexpr (std::same_as<element_type, bool>) {
+        auto& packed = jarray.template to_packed<typename array_type::boolean_type>();
+        packed.assign(container.begin(), container.end());
+    }
+    else if constexpr (std::is_floating_point_v<element_type>) {
+        auto& packed = jarray.template to_packed<typename array_type::float_type>();
+        packed.assign(container.begin(), container.end());
+    }
+    else if constexpr (std::is_integral_v<element_type> && (std::is_signed_v<element_type> || sizeof(element_type) < sizeof(typename array_type::integer_type))) {
+        auto& packed = jarray.template to_packed<typename array_type::integer_type>();
+        packed.assign(container.begin(), container.end());
+    }
+    else {
+        typename array_type::array_type _Temp{};
+        detail::reserve_for(_Temp, container);
+        for (const auto& value : container) {
+            _Temp.emplace_back() << value;
+        }
+        jarray.get() = std::move(_Temp);
+    }
+    return jarray;
+}
+
+template<typename T, typename JValue, typename Allocator> requires is_default_array<T, basic_array<JValue, Allocator>>
+inline basic_array<JValue, Allocator>& operator<<(basic_array<JValue, Allocator>& jarray, T&& container) {
+    using array_type   = basic_array<JValue, Allocator>;
+    using element_type = typename T::value_type;
+
+    if constexpr (std::is_arithmetic_v<element_type>) {
+        return (jarray << std::as_const(container));
+    }
+    else {
+        typename array_type::array_type _Temp{};
+        detail::reserve_for(_Temp, container);
+        for (auto& value : container) {
+            _Temp.emplace_back() << std::move(value);
+        }
+        jarray.get() = std::move(_Temp);
+        return jarray;
+    }
+}
+
+template<typename T, typename JValue, typename Allocator> requires is_default_array<T, basic_array<JValue, Allocator>>
+inline const basic_array<JValue, Allocator>& operator>>(const basic_array<JValue, Allocator>& jarray, T& container) {
+    using array_type      = basic_array<JValue, Allocator>;
+    using container_value = typename T::value_type;
+
+    T _Temp{};
+    detail::reserve_for(_Temp, jarray);
+
+    auto copy = [&](auto span, auto projection) {
+        for (const auto& value : span) {
+            _Temp.insert(_Temp.end(), projection(value));
+        }
+        container = std::move(_Temp);
+    };
+    auto cast = [](const auto& value) { return static_cast<container_value>(value); };
+
+    if constexpr (std::same_as<container_value, bool>) {
+        if (jarray.template packed<typename array_type::boolean_type>()) {
+            copy(jarray.template span<typename array_type::boolean_type>(), [](typename array_type::boolean_type b) { return b != 0; });
+            return jarray;
+        }
+    }
+    else if constexpr (std::is_arithmetic_v<container_value>) {
+        if (jarray.template packed<typename array_type::integer_type>()) {
+            copy(jarray.template span<typename array_type::integer_type>(), cast);
+            return jarray;
+        }
+        if (jarray.template packed<typename array_type::float_type>()) {
+            copy(jarray.template span<typename array_type::float_type>(), cast);
+            return jarray;
+        }
+    }
+
+    for (const auto& value : jarray) {
+        container_value _TempValue{};
+        value >> _TempValue;
+        _Temp.insert(_Temp.end(), std::move(_TempValue));
+    }
+    container = std::move(_Temp);
+    return jarray;
+}
+
+// Moves the elements out of the array instead of copying them, leaving the array with moved-from values.
+template<typename T, typename JValue, typename Allocator> requires is_default_array<T, basic_array<JValue, Allocator>>
+inline basic_array<JValue, Allocator>&& operator>>(basic_array<JValue, Allocator>&& jarray, T& container) {
+    using container_value = typename T::value_type;
+
+    if (jarray.packed()) {
+        std::as_const(jarray) >> container;
+        return std::move(jarray);
+    }
+
+    T _Temp{};
+    detail::reserve_for(_Temp, jarray);
+    for (auto& value : jarray.get()) {
+        container_value _TempValue{};
+        std::move(value) >> _TempValue;
+        _Temp.insert(_Temp.end(), std::move(_TempValue));
+    }
+    container = std::move(_Temp);
+    return std::move(jarray);
+}
+
+template<typename JValue, typename Allocator>
+inline bool operator==(const basic_array<JValue, Allocator>& lhs, const basic_array<JValue, Allocator>& rhs) {
+    using array_type = basic_array<JValue, Allocator>;
+
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    if (&lhs == &rhs) {
+        return true;
+    }
+    if (lhs.cached_hash() != 0 && rhs.cached_hash() != 0 && lhs.cached_hash() != rhs.cached_hash()) {
+        return false;
+    }
+    if (lhs.template packed<typename array_type::float_type>() && rhs.template packed<typename array_type::float_type>()) {
+        return std::ranges::equal(lhs.template span<typename array_type::float_type>(), rhs.template span<typename array_type::float_type>());
+    }
+    if (lhs.template packed<typename array_type::integer_type>() && rhs.template packed<typename array_type::integer_type>()) {
+        return std::ranges::equal(lhs.template span<typename array_type::integer_type>(), rhs.template span<typename array_type::integer_type>());
+    }
+    if (lhs.template packed<typename array_type::boolean_type>() && rhs.template packed<typename array_type::boolean_type>()) {
+        return std::ranges::equal(lhs.template span<typename array_type::boolean_type>(), rhs.template span<typename array_type::boolean_type>());
+    }
+    return std::ranges::equal(lhs, rhs);
+}
+
+template<typename Char, typename Traits, typename JValue, typename Allocator>
+inline basic_writer<Char, Traits>& operator<<(basic_writer<Char, Traits>& w, const basic_array<JValue, Allocator>& jarray) {
+    using array_type = basic_array<JValue, Allocator>;
+
+    return w.cached(jarray.cache(), [&](basic_writer<Char, Traits>& out) -> basic_writer<Char, Traits>& {
+        if (jarray.template packed<typename array_type::float_type>()) {
+            auto span = jarray.template span<typename array_type::float_type>();
+            return out.array(span.begin(), span.end());
+        }
+        if (jarray.template packed<typename array_type::integer_type>()) {
+            auto span = jarray.template span<typename array_type::integer_type>();
+            return out.array(span.begin(), span.end());
+        }
+        if (jarray.template packed<typename array_type::boolean_type>()) {
+            auto span = jarray.template span<typename array_type::boolean_type>();
+            return out.array(span.begin(), span.end(), [](typename array_type::boolean_type b) { return b != 0; });
+        }
+        return (out << jarray.get());
+    });
+}
+
+template<typename Char, typename Traits, typename JValue, typename Allocator>
+inline basic_reader<Char, Traits>& operator>>(basic_reader<Char, Traits>& r, basic_array<JValue, Allocator>& jarray) {
+    if ((r.flags() & read_flags::pack_arrays) != read_flags::none) {
+        return jarray.read_packed(r);
+    }
+    return (r >> jarray.get());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// FLAT MAP
+// ----------
+//  Insertion ordered key/value storage in a single contiguous vector. Small maps are searched linearly,
+//  a hash index is only built once the map grows past index_threshold entries. A hinted insert places the
+//  new entry at the hint, which costs a reindex unless the hint is end(), erase shifts the index in place.
+//  Keys are exposed as const like in std::map, since changing one would desync the index.
+//  Inserting may invalidate references and iterators, just like it does for vector.
+//
+
+template<typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>, typename Allocator = std::allocator<std::pair<const Key, Value>>>
+class basic_flat_map {
+protected:
+    // Entries are stored with a mutable key so that the vector can move them, and handed out as value_type.
+    using entry_type = std::pair<Key, Value>;
+
+    template<bool Const>
+    class basic_iterator;
+
+public:
+    using key_type        = Key;
+    using mapped_type     = Value;
+    using value_type      = std::pair<const Key, Value>;
+    using hasher          = Hash;
+    using key_equal       = KeyEqual;
+    using storage_type    = std::vector<entry_type, detail::rebind_alloc_t<entry_type, Allocator>>;
+    using allocator_type  = typename storage_type::allocator_type;
+    using size_type       = typename storage_type::size_type;
+    using difference_type = typename storage_type::difference_type;
+    using iterator        = basic_iterator<false>;
+    using const_iterator  = basic_iterator<true>;
+
+    static constexpr size_type index_threshold = 16;
+
+    iterator begin(void) noexcept {
+        return iterator(_Value.begin());
+    }
+
+    iterator end(void) noexcept {
+        return iterator(_Value.end());
+    }
+
+    const_iterator begin(void) const noexcept {
+        return const_iterator(_Value.begin());
+    }
+
+    const_iterator end(void) const noexcept {
+        return const_iterator(_Value.end());
+    }
+
+    const_iterator cbegin(void) const noexcept {
+        return const_iterator(_Value.cbegin());
+    }
+
+    const_iterator cend(void) const noexcept {
+        return const_iterator(_Value.cend());
+    }
+
+    size_type size(void) const noexcept {
+        return _Value.size();
+    }
+
+    bool empty(void) const noexcept {
+        return _Value.empty();
+    }
+
+    size_type capacity(void) const noexcept {
+        return _Value.capacity();
+    }
+
+    // Slots of the hash index, 0 while the map is searched linearly.
+    size_type bucket_count(void) const noexcept {
+        return _Index.size();
+    }
+
+    void reserve(size_type count) {
+        _Value.reserve(count);
+        if (!_Index.empty() && _Index.size() < count * 2) {
+            this->reindex();
+        }
+    }
+
+    void clear(void) noexcept {
+        _Value.clear();
+        _Index.clear();
+    }
+
+    iterator find(const key_type& key) {
+        return this->begin() + this->position(key);
+    }
+
+    const_iterator find(const key_type& key) const {
+        return this->begin() + this->position(key);
+    }
+
+    bool contains(const key_type& key) const {
+        return this->position(key) != size();
+    }
+
+    template<typename K> requires detail::is_transparent_lookup<basic_flat_map, K>
+    iterator find(const K& key) {
+        return this->begin() + this->position(key);
+    }
+
+    template<typename K> requires detail::is_transparent_lookup<basic_flat_map, K>
+    const_iterator find(const K& key) const {
+        return this->begin() + this->position(key);
+    }
+
+    template<typename K> requires detail::is_transparent_lookup<basic_flat_map, K>
+    bool contains(const K& key) const {
+        return this->position(key) != size();
+    }
+
+    mapped_type& at(const key_type& key) {
+        auto it = this->find(key);
+        if (it == end()) {
+            throw std::out_of_range("Key not found in flat map");
+        }
+        return it->second;
+    }
+
+    const mapped_type& at(const key_type& key) const {
+        auto it = this->find(key);
+        if (it == end()) {
+            throw std::out_of_range("Key not found in flat map");
+        }
+        return it->second;
+    }
+
+    template<typename K> requires detail::is_transparent_lookup<basic_flat_map, K>
+    mapped_type& at(const K& key) {
+        auto it = this->find(key);
+        if (it == end()) {
+            throw std::out_of_range("Key not found in flat map");
+        }
+        return it->second;
+    }
+
+    template<typename K> requires detail::is_transparent_lookup<basic_flat_map, K>
+    const mapped_type& at(const K& key) const {
+        auto it = this->find(key);
+        if (it == end()) {
+            throw std::out_of_range("Key not found in flat map");
+        }
+        return it->second;
+    }
+
+    mapped_type& operator[](const key_type& key) {
+        return this->try_emplace(key).first->second;
+    }
+
+    mapped_type& operator[](key_type&& key) {
+        return this->try_emplace(std::move(key)).first->second;
+    }
+
+    // Only constructs a key_type when the key is not present yet.
+    template<typename K> requires (detail::is_transparent_lookup<basic_flat_map, K> && std::constructible_from<key_type, const K&>)
+    mapped_type& operator[](const K& key) {
+        return this->try_emplace(key).first->second;
+    }
+
+    template<typename K, typename ... Args>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&& ... args) {
+        size_type pos = this->position(key);
+        if (pos != size()) {
+            return { this->begin() + pos, false };
+        }
+        _Value.emplace_back(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+        this->index_back();
+        return { this->end() - 1, true };
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return this->try_emplace(value.first, value.second);
+    }
+
+    // Moves the key too when given a pair with a non-const key, such as the ones read by a reader.
+    template<typename Pair> requires std::constructible_from<entry_type, Pair&&>
+    std::pair<iterator, bool> insert(Pair&& value) {
+        return this->try_emplace(std::forward<Pair>(value).first, std::forward<Pair>(value).second);
+    }
+
+    iterator insert(const_iterator hint, const value_type& value) {
+        return this->insert(hint, entry_type(value.first, value.second));
+    }
+
+    // Places a new entry at hint instead of the end, existing keys are left untouched.
+    template<typename Pair> requires std::constructible_from<entry_type, Pair&&>
+    iterator insert(const_iterator hint, Pair&& value) {
+        size_type pos = this->position(value.first);
+        if (pos != size()) {
+            return this->begin() + pos;
+        }
+        if (hint == this->cend()) {
+            return this->insert(std::forward<Pair>(value)).first;
+        }
+        auto it = _Value.insert(hint.base(), entry_type(std::forward<Pair>(value)));
+        this->reindex();
+        return iterator(it);
+    }
+
+    iterator erase(const_iterator pos) {
+        size_type index = static_cast<size_type>(pos - this->cbegin());
+        this->unindex(index);
+        return iterator(_Value.erase(pos.base()));
+    }
+
+    iterator erase(const_iterator first, const_iterator last) {
+        if (first == last) {
+            return this->begin() + (first - this->cbegin());
+        }
+        auto it = _Value.erase(first.base(), last.base());
+        this->reindex();
+        return iterator(it);
+    }
+
+    size_type erase(const key_type& key) {
+        size_type pos = this->position(key);
+        if (pos == size()) {
+            return 0;
+        }
+        this->erase(this->cbegin() + pos);
+        return 1;
+    }
+
+    template<typename K> requires detail::is_transparent_lookup<basic_flat_map, K>
+    size_type erase(const K& key) {
+        size_type pos = this->position(key);
+        if (pos == size()) {
+            return 0;
+        }
+        this->erase(this->cbegin() + pos);
+        return 1;
+    }
+
+    // The entries in insertion order. Read only, changing a key in place would desync the index.
+    const storage_type& get(void) const noexcept {
+        return _Value;
+    }
+
+protected:
+    template<bool Const>
+    class basic_iterator {
+    public:
+        using base_type         = std::conditional_t<Const, typename storage_type::const_iterator, typename storage_type::iterator>;
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type        = typename basic_flat_map::value_type;
+        using difference_type   = typename basic_flat_map::difference_type;
+        using pointer           = std::conditional_t<Const, const value_type*, value_type*>;
+        using reference         = std::conditional_t<Const, const value_type&, value_type&>;
+
+        basic_iterator(void) = default;
+
+        explicit basic_iterator(base_type it) noexcept
+            : _It(it)
+        {
+        }
+
+        template<bool Other> requires (Const && !Other)
+        basic_iterator(const basic_iterator<Other>& other) noexcept
+            : _It(other.base())
+        {
+        }
+
+        // pair<Key, Value> and pair<const Key, Value> only differ in the constness of first, the same
+        // reinterpretation node based maps use to hand out their mutable entries as value_type.
+        reference operator*(void) const noexcept {
+            static_assert(sizeof(entry_type) == sizeof(value_type) && alignof(entry_type) == alignof(value_type));
+            return *std::launder(reinterpret_cast<pointer>(std::addressof(*_It)));
+        }
+
+        pointer operator->(void) const noexcept {
+            return std::addressof(**this);
+        }
+
+        reference operator[](difference_type n) const noexcept {
+            return *(*this + n);
+        }
+
+        basic_iterator& operator++(void) noexcept {
+            ++_It;
+            return *this;
+        }
+
+        basic_iterator operator++(int) noexcept {
+            return basic_iterator(_It++);
+        }
+
+        basic_iterator& operator--(void) noexcept {
+            --_It;
+            return *this;
+        }
+
+        basic_iterator operator--(int) noexcept {
+            return basic_iterator(_It--);
+        }
+
+        basic_iterator& operator+=(difference_type n) noexcept {
+            _It += n;
+            return *this;
+        }
+
+        basic_iterator& operator-=(difference_type n) noexcept {
+            _It -= n;
+            return *this;
+        }
+
+        friend basic_iterator operator+(basic_iterator it, difference_type n) noexcept {
+            return it += n;
+        }
+
+        friend basic_iterator operator+(difference_type n, basic_iterator it) noexcept {
+            return it += n;
+        }
+
+        friend basic_iterator operator-(basic_iterator it, difference_type n) noexcept {
+            return it -= n;
+        }
+
+        friend difference_type operator-(const basic_iterator& lhs, const basic_iterator& rhs) noexcept {
+            return lhs._It - rhs._It;
+        }
+
+        friend bool operator==(const basic_iterator& lhs, const basic_iterator& rhs) noexcept {
+            return lhs._It == rhs._It;
+        }
+
+        friend auto operator<=>(const basic_iterator& lhs, const basic_iterator& rhs) noexcept {
+            return lhs._It <=> rhs._It;
+        }
+
+        base_type base(void) const noexcept {
+            return _It;
+        }
+
+    private:
+        base_type _It{};
+    };
+
+    template<typename K>
+    size_type position(const K& key) const {
+        if (_Index.empty()) {
+            for (size_type i = 0; i < _Value.size(); ++i) {
+                if (_Equal(_Value[i].first, key)) {
+                    return i;
+                }
+            }
+            return _Value.size();
+        }
+
+        size_type mask = _Index.size() - 1;
+        for (size_type slot = _Hash(key) & mask; _Index[slot] != 0; slot = (slot + 1) & mask) {
+            if (_Equal(_Value[_Index[slot] - 1].first, key)) {
+                return _Index[slot] - 1;
+            }
+        }
+        return _Value.size();
+    }
+
+    void index_back(void) {
+        if (_Value.size() <= index_threshold) {
+            return;
+        }
+        if (_Value.size() * 2 > _Index.size()) {
+            this->reindex();
+            return;
+        }
+
+        size_type mask = _Index.size() - 1;
+        size_type slot = _Hash(_Value.back().first) & mask;
+        while (_Index[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        _Index[slot] = _Value.size();
+    }
+
+    // Removes the entry at pos from the index before it is erased. The probe chain is closed by shifting
+    // the following entries back instead of rehashing every key, then the positions behind pos move down.
+    void unindex(size_type pos) {
+        if (_Index.empty()) {
+            return;
+        }
+        if (_Value.size() - 1 <= index_threshold) {
+            _Index.clear();
+            return;
+        }
+
+        size_type mask = _Index.size() - 1;
+        size_type hole = _Hash(_Value[pos].first) & mask;
+        while (_Index[hole] != pos + 1) {
+            hole = (hole + 1) & mask;
+        }
+        for (size_type slot = (hole + 1) & mask; _Index[slot] != 0; slot = (slot + 1) & mask) {
+            size_type home = _Hash(_Value[_Index[slot] - 1].first) & mask;
+            // The entry may fill the hole if its home does not lie cyclically in (hole, slot].
+            if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+                _Index[hole] = _Index[slot];
+                hole         = slot;
+            }
+        }
+        _Index[hole] = 0;
+
+        if (pos + 1 != _Value.size()) {
+            for (size_type& index : _Index) {
+                index -= index > pos + 1 ? 1 : 0;
+            }
+        }
+    }
+
+    void reindex(void) {
+        _Index.clear();
+        if (_Value.size() <= index_threshold) {
+            return;
+        }
+
+        size_type slots = 1;
+        while (slots < _Value.capacity() * 2) {
+            slots <<= 1;
+        }
+        _Index.resize(slots);
+
+        size_type mask = slots - 1;
+        for (size_type i = 0; i < _Value.size(); ++i) {
+            size_type slot = _Hash(_Value[i].first) & mask;
+            while (_Index[slot] != 0) {
+                slot = (slot + 1) & mask;
+            }
+            _Index[slot] = i + 1;
+        }
+    }
+
+    storage_type                                                         _Value{};
+    std::vector<size_type, detail::rebind_alloc_t<size_type, Allocator>> _Index{};
+    [[no_unique_address]] hasher                                         _Hash{};
+    [[no_unique_address]] key_equal                                      _Equal{};
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// OBJECT
+//
+
+template<typename JKey, typename JValue, typename Allocator = std::allocator<std::pair<const JKey, JValue>>, typename Storage = basic_flat_map<JKey, JValue, detail::transparent_hash, std::equal_to<>, Allocator>>
+class basic_object {
+public:
+    using object_type     = Storage;
+    using key_type        = typename object_type::key_type;
+    using mapped_type     = typename object_type::mapped_type;
+    using allocator_type  = typename object_type::allocator_type;
+    using size_type       = typename object_type::size_type;
+    using difference_type = typename object_type::difference_type;
+    using iterator        = typename object_type::iterator;
+    using const_iterator  = typename object_type::const_iterator;
+
+    iterator begin(void) noexcept {
+        _Cache.reset();
+        return _Value.begin();
+    }
+
+    iterator end(void) noexcept {
+        _Cache.reset();
+        return _Value.end();
+    }
+
+    const_iterator begin(void) const noexcept {
+        return _Value.begin();
+    }
+
+    const_iterator end(void) const noexcept {
+        return _Value.end();
+    }
+
+    const_iterator cbegin(void) const noexcept {
+        return _Value.cbegin();
+    }
+
+    const_iterator cend(void) const noexcept {
+        return _Value.cend();
+    }
+
+    size_type size(void) const noexcept {
+        return _Value.size();
+    }
+
+    void reserve(size_type count) {
+        if constexpr (detail::is_reservable<object_type>) {
+            _Value.reserve(count);
+        }
+    }
+
+    iterator find(const key_type& key) {
+        _Cache.reset();
+        return _Value.find(key);
+    }
+
+    const_iterator find(const key_type& key) const {
+        return _Value.find(key);
+    }
+
+    bool contains(const key_type& key) const noexcept {
+        return _Value.contains(key);
+    }
+
+    mapped_type& at(const key_type& key) {
+        _Cache.reset();
+        return _Value.at(key);
+    }
+
+    const mapped_type& at(const key_type& key) const {
+        return _Value.at(key);
+    }
+
+    mapped_type& operator[](const key_type& key) {
+        _Cache.reset();
+        return _Value[key];
+    }
+
+    mapped_type& operator[](key_type&& key) {
+        _Cache.reset();
+        return _Value[std::move(key)];
+    }
+
+    const mapped_type& operator[](const key_type& key) const {
+        return _Value.at(key);
+    }
+
+    //
+    // Lookups by string view, character pointer or basic_key_view, none of which construct a key_type.
+    // Only available when the storage hashes and compares transparently, which the default storage does.
+    //
+
+    template<typename K> requires detail::is_transparent_lookup<object_type, K>
+    iterator find(const K& key) {
+        _Cache.reset();
+        return _Value.find(key);
+    }
+
+    template<typename K> requires detail::is_transparent_lookup<object_type, K>
+    const_iterator find(const K& key) const {
+        return _Value.find(key);
+    }
+
+    template<typename K> requires detail::is_transparent_lookup<object_type, K>
+    bool contains(const K& key) const {
+        return _Value.contains(key);
+    }
+
+    template<typename K> requires detail::is_transparent_lookup<object_type, K>
+    mapped_type& at(const K& key) {
+        _Cache.reset();
+        return _Value.at(key);
+    }
+
+    template<typename K> requires detail::is_transparent_lookup<object_type, K>
+    const mapped_type& at(const K& key) const {
+        return _Value.at(key);
+    }
+
+    template<typename K> requires (detail::is_transparent_lookup<object_type, K> && std::constructible_from<key_type, const K&>)
+    mapped_type& operator[](const K& key) {
+        _Cache.reset();
+        return _Value[key];
+    }
+
+    template<typename K> requires detail::is_transparent_lookup<object_type, K>
+    const mapped_type& operator[](const K& key) const {
+        return _Value.at(key);
+    }
+
+    object_type& get(void) noexcept {
+        _Cache.reset();
+        return _Value;
+    }
+
+    const object_type& get(void) const noexcept {
+        return _Value;
+    }
+
+    // Merkle style hash over the members, independent of their order like operator==. Cached until the
+    // object is accessed through a non-const member or invalidated.
+    std::size_t hash(void) const {
+        if (std::size_t cached = _Cache.load()) {
+            return cached;
+        }
+
+        std::size_t members = 0;
+        for (const auto& [key, value] : _Value) {
+            members += detail::mix_hash(detail::combine_hash(detail::transparent_hash{}(key), value.hash()));
+        }
+        return _Cache.store(detail::combine_hash(detail::combine_hash(11, this->size()), members));
+    }
+
+    // The hash if it has been computed and nothing changed since, 0 otherwise.
+    std::size_t cached_hash(void) const noexcept {
+        return _Cache.load();
+    }
+
+    // Drops the cached hash and marks the cached text dirty, as non-const access does.
+    void invalidate(void) noexcept {
+        _Cache.reset();
+    }
+
+    const detail::node_cache& cache(void) const noexcept {
+        return _Cache;
+    }
+
+private:
+    object_type        _Value{};
+    detail::node_cache _Cache{};
+};
+
+template<typename T, typename JKey, typename JValue, typename Allocator, typename Storage> requires is_default_object<T, basic_object<JKey, JValue, Allocator, Storage>>
+inline basic_object<JKey, JValue, Allocator, Storage>& operator<<(basic_object<JKey, JValue, Allocator, Storage>& jobject, const T& container) {
+    typename basic_object<JKey, JValue, Allocator, Storage>::object_type _Temp{};
+    detail::reserve_for(_Temp, container);
+    for (const auto& [key, value] : container) {
+        _Temp[typename basic_object<JKey, JValue, Allocator, Storage>::key_type(key)] << value;
+    }
+    jobject.get() = std::move(_Temp);
+    return jobject;
+}
+
+template<typename T, typename JKey, typename JValue, typename Allocator, typename Storage> requires is_default_object<T, basic_object<JKey, JValue, Allocator, Storage>>
+inline basic_object<JKey, JValue, Allocator, Storage>& operator<<(basic_object<JKey, JValue, Allocator, Storage>& jobject, T&& container) {
+    using key_type = typename basic_object<JKey, JValue, Allocator, Storage>::key_type;
+
+    typename basic_object<JKey, JValue, Allocator, Storage>::object_type _Temp{};
+    detail::reserve_for(_Temp, container);
+    if constexpr (requires { container.extract(container.begin()); }) {
+        // Keys of node based maps are const, extracting the nodes is the only way to move them out.
+        while (!container.empty()) {
+            auto node = container.extract(container.begin());
+            _Temp[key_type(std::move(node.key()))] << std::move(node.mapped());
+        }
+    }
+    else {
+        for (auto& [key, value] : container) {
+            _Temp[key_type(std::move(key))] << std::move(value);
+        }
+    }
+    jobject.get() = std::move(_Temp);
+    return jobject;
+}
+
+template<typename T, typename JKey, typename JValue, typename Allocator, typename Storage> requires is_default_object<T, basic_object<JKey, JValue, Allocator, Storage>>
+inline const basic_object<JKey, JValue, Allocator, Storage>& operator>>(const basic_object<JKey, JValue, Allocator, Storage>& jobject, T& container) {
+    using container_key   = std::remove_const_t<typename T::value_type::first_type>;
+    using container_value = typename T::value_type::second_type;
+
+    T _Temp{};
+    detail::reserve_for(_Temp, jobject.get());
+    for (const auto& [key, value] : jobject.get()) {
+        container_value _TempValue{};
+        value >> _TempValue;
+        _Temp.emplace(container_key(key), std::move(_TempValue));
+    }
+    container = std::move(_Temp);
+    return jobject;
+}
+
+// Moves keys and values out of the object instead of copying them, leaving the object with moved-from entries.
+template<typename T, typename JKey, typename JValue, typename Allocator, typename Storage> requires is_default_object<T, basic_object<JKey, JValue, Allocator, Storage>>
+inline basic_object<JKey, JValue, Allocator, Storage>&& operator>>(basic_object<JKey, JValue, Allocator, Storage>&& jobject, T& container) {
+    using container_key   = std::remove_const_t<typename T::value_type::first_type>;
+    using container_value = typename T::value_type::second_type;
+
+    T _Temp{};
+    detail::reserve_for(_Temp, jobject.get());
+    for (auto& [key, value] : jobject.get()) {
+        container_value _TempValue{};
+        std::move(value) >> _TempValue;
+        if constexpr (requires { container_key(std::move(key).str()); }) {
+            _Temp.emplace(container_key(std::move(key).str()), std::move(_TempValue));
+        }
+        else {
+            _Temp.emplace(container_key(key), std::move(_TempValue));
+        }
+    }
+    container = std::move(_Temp);
+    return std::move(jobject);
+}
+
+// Member order does not take part in the comparison.
+template<typename JKey, typename JValue, typename Allocator, typename Storage>
+inline bool operator==(const basic_object<JKey, JValue, Allocator, Storage>& lhs, const basic_object<JKey, JValue, Allocator, Storage>& rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    if (&lhs == &rhs) {
+        return true;
+    }
+    if (lhs.cached_hash() != 0 && rhs.cached_hash() != 0 && lhs.cached_hash() != rhs.cached_hash()) {
+        return false;
+    }
+    for (const auto& [key, value] : lhs) {
+        auto it = rhs.find(key);
+        if (it == rhs.end() || !(it->second == value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename Char, typename Traits, typename JKey, typename JValue, typename Allocator, typename Storage>
+inline basic_writer<Char, Traits>& operator<<(basic_writer<Char, Traits>& w, const basic_object<JKey, JValue, Allocator, Storage>& jobject) {
+    return w.cached(jobject.cache(), [&](basic_writer<Char, Traits>& out) -> basic_writer<Char, Traits>& {
+        return (out << jobject.get());
+    });
+}
+
+template<typename Char, typename Traits, typename JKey, typename JValue, typename Allocator, typename Storage>
+inline basic_reader<Char, Traits>& operator>>(basic_reader<Char, Traits>& r, basic_object<JKey, JValue, Allocator, Storage>& jobject) {
+    return (r >> jobject.get());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// VALUE
+//
+
+template<typename Char, typename Traits = std::char_traits<Char>, typename Allocator = std::allocator<Char>>
+class basic_value {
+public:
+    using char_type      = Char;
+    using traits_type    = Traits;
+    using allocator_type = Allocator;
+    using null_type      = std::nullptr_t;
+    using string_type    = std::basic_string<Char, Traits, Allocator>;
+    using key_type       = basic_key<Char, Traits, Allocator>;
+    using number_type    = basic_number<>;
+    using array_type     = basic_array<basic_value<Char, Traits, Allocator>, typename detail::rebind_alloc_t<basic_value<Char, Traits, Allocator>, Allocator>>;
+    using object_type    = basic_object<key_type, basic_value<Char, Traits, Allocator>, typename detail::rebind_alloc_t<std::pair<const key_type, basic_value<Char, Traits, Allocator>>, Allocator>>;
+    using boolean_type   = bool;
+    using value_type     = std::variant<null_type, string_type, number_type, array_type, object_type, boolean_type>;
+
+    basic_value(void) = default;
+    basic_value(const basic_value&) = default;
+    basic_value(basic_value&&) = default;
+    basic_value& operator=(const basic_value&) = default;
+    basic_value& operator=(basic_value&&) = default;
+
+    ~basic_value() {
+        if (is_container(*this)) {
+            this->release();
+        }
+    }
+
+    bool is_null(void) const noexcept {
+        return _Value.index() == 0;
+    }
+
+    null_type& to_null(void) {
+        if (!this->is_null()) {
+            _Value = null_type{};
+        }
+        return std::get<null_type>(_Value);
+    }
+
+    null_type& null(void) {
+        return std::get<null_type>(_Value);
+    }
+
+    null_type& null(null_type& ref) noexcept {
+        if (!this->is_null()) {
+            return ref;
+        }
+        return std::get<null_type>(_Value);
+    }
+
+    const null_type& null(void) const {
+        return std::get<null_type>(_Value);
+    }
+
+    const null_type& null(const null_type& ref) const noexcept {
+        if (!this->is_null()) {
+            return ref;
+        }
+        return std::get<null_type>(_Value);
+    }
+
+    bool is_string(void) const noexcept {
+        return _Value.index() == 1;
+    }
+
+    string_type& to_string(void) {
+        if (!this->is_string()) {
+            _Value = string_type{};
+        }
+        return std::get<string_type>(_Value);
+    }
+
+    string_type& string(void) {
+        return std::get<string_type>(_Value);
+    }
+
+    string_type& string(string_type& ref) noexcept {
+        if (!this->is_string()) {
+            return ref;
+        }
+        return std::get<string_type>(_Value);
+    }
+
+    const string_type& string(void) const {
+        return std::get<string_type>(_Value);
+    }
+
+    const string_type& string(const string_type& ref) const noexcept {
+        if (!this->is_string()) {
+            return ref;
+        }
+        return std::get<string_type>(_Value);
+    }
+
+    bool is_number(void) const noexcept {
+        return _Value.index() == 2;
+    }
+
+    number_type& to_number(void) {
+        if (!this->is_number()) {
+            _Value = number_type{};
+        }
+        return std::get<number_type>(_Value);
+    }
+
+    number_type& number(void) {
+        return std::get<number_type>(_Value);
+    }
+
+    number_type& number(number_type& ref) noexcept {
+        if (!this->is_number()) {
+            return ref;
+        }
+        return std::get<number_type>(_Value);
+    }
+
+    const number_type& number(void) const {
+        return std::get<number_type>(_Value);
+    }
+
+    const number_type& number(const number_type& ref) const noexcept {
+        if (!this->is_number()) {
+            return ref;
+        }
+        return std::get<number_type>(_Value);
+    }
+
+    bool is_boolean(void) const noexcept {
+        return _Value.index() == 5;
+    }
+
+    boolean_type& to_boolean(void) {
+        if (!this->is_boolean()) {
+            _Value = boolean_type{};
+        }
+        return std::get<boolean_type>(_Value);
+    }
+
+    boolean_type& boolean(void) {
+        return std::get<boolean_type>(_Value);
+    }
+
+    boolean_type& boolean(boolean_type& ref) noexcept {
+        if (!this->is_boolean()) {
+            return ref;
+        }
+        return std::get<boolean_type>(_Value);
+    }
+
+    const boolean_type& boolean(void) const {
+        return std::get<boolean_type>(_Value);
+    }
+
+    const boolean_type& boolean(const boolean_type& ref) const noexcept {
+        if (!this->is_boolean()) {
+            return ref;
+        }
+        return std::get<boolean_type>(_Value);
+    }
+
+    bool is_array(void) const noexcept {
+        return _Value.index() == 3;
+    }
+
+    array_type& to_array(void) {
+        if (!this->is_array()) {
+            _Value = array_type{};
+        }
+        return std::get<array_type>(_Value);
+    }
+
+    array_type& array(void) {
+        return std::get<array_type>(_Value);
+    }
+
+    array_type& array(array_type& ref) noexcept {
+        if (!this->is_array()) {
+            return ref;
+        }
+        return std::get<array_type>(_Value);
+    }
+
+    const array_type& array(void) const {
+        return std::get<array_type>(_Value);
+    }
+
+    const array_type& array(const array_type& ref) const noexcept {
+        if (!this->is_array()) {
+            return ref;
+        }
+        return std::get<array_type>(_Value);
+    }
+
+    bool is_object(void) const noexcept {
+        return _Value.index() == 4;
+    }
+
+    object_type& to_object(void) {
+        if (!this->is_object()) {
+            _Value = object_type{};
+        }
+        return std::get<object_type>(_Value);
+    }
+
+    object_type& object(void) {
+        return std::get<object_type>(_Value);
+    }
+
+    object_type& object(object_type& ref) noexcept {
+        if (!this->is_object()) {
+            return ref;
+        }
+        return std::get<object_type>(_Value);
+    }
+
+    const object_type& object(void) const {
+        return std::get<object_type>(_Value);
+    }
+
+    const object_type& object(const object_type& ref) const noexcept {
+        if (!this->is_object()) {
+            return ref;
+        }
+        return std::get<object_type>(_Value);
+    }
+
+    value_type& get(void) noexcept {
+        return _Value;
+    }
+
+    const value_type& get(void) const noexcept {
+        return _Value;
+    }
+
+    friend bool operator==(const basic_value& lhs, const basic_value& rhs) {
+        return lhs._Value == rhs._Value;
+    }
+
+    // Drops the cached hashes and texts of this value and of everything in it. Needed after modifying a nested
+    // value through a reference kept from before a hash() or caching write, which does not reach the caches
+    // of its ancestors. Changes made through the non-const accessors of the ancestors need no invalidate().
+    void invalidate(void) {
+        std::vector<basic_value*> pending{ this };
+        while (!pending.empty()) {
+            basic_value* current = pending.back();
+            pending.pop_back();
+            if (array_type* array = std::get_if<array_type>(&current->_Value)) {
+                array->invalidate();
+                if (!array->packed()) {
+                    for (basic_value& element : array->get()) {
+                        pending.push_back(&element);
+                    }
+                }
+            }
+            else if (object_type* object = std::get_if<object_type>(&current->_Value)) {
+                object->invalidate();
+                for (auto& [key, element] : object->get()) {
+                    pending.push_back(&element);
+                }
+            }
+        }
+    }
+
+    // Deep hash consistent with operator==. Arrays and objects cache theirs, so hashing again after a change
+    // only recomputes the containers on the path to it, as long as the change went through non-const
+    // accessors starting at this value. Mutating through a reference kept from earlier does not reach the
+    // ancestors of the changed value, call invalidate() on the hashed value afterwards.
+    std::size_t hash(void) const {
+        return std::visit([](const auto& value) -> std::size_t {
+            using type = std::remove_cvref_t<decltype(value)>;
+            if constexpr (std::same_as<type, null_type>) {
+                return detail::combine_hash(1, 0);
+            }
+            else if constexpr (std::same_as<type, string_type>) {
+                return detail::combine_hash(2, detail::hash_chars(std::basic_string_view<Char, Traits>(value)));
+            }
+            else if constexpr (std::same_as<type, number_type>) {
+                switch (value.kind()) {
+                case number_kind::integer:          return detail::hash_number(value.template as<std::int64_t>());
+                case number_kind::unsigned_integer: return detail::hash_number(value.template as<std::uint64_t>());
+                default:
+                    break;
+                }
+                return detail::hash_number(value.template as<double>());
+            }
+            else if constexpr (std::same_as<type, boolean_type>) {
+                return detail::hash_boolean(value);
+            }
+            else {
+                return value.hash();
+            }
+        }, _Value);
+    }
+
+private:
+    //
+    // Nested documents are torn down iteratively: child containers are moved onto a heap allocated stack
+    // and emptied one by one, so destruction depth stays constant no matter how deep the document is.
+    // Every container is scanned for children once, empty ones and scalars are destroyed in place.
+    //
+
+    static bool is_container(const basic_value& jvalue) noexcept {
+        if (const array_type* array = std::get_if<array_type>(&jvalue._Value)) {
+            return array->size() > 0 && !array->packed();
+        }
+        if (const object_type* object = std::get_if<object_type>(&jvalue._Value)) {
+            return object->get().size() > 0;
+        }
+        return false;
+    }
+
+    using pending_type = std::vector<basic_value, detail::rebind_alloc_t<basic_value, Allocator>>;
+
+    void detach(pending_type& pending) {
+        if (array_type* array = std::get_if<array_type>(&_Value); array && !array->packed()) {
+            for (basic_value& element : array->get()) {
+                if (is_container(element)) {
+                    pending.push_back(std::move(element));
+                }
+            }
+        }
+        if (object_type* object = std::get_if<object_type>(&_Value)) {
+            for (auto& [key, element] : object->get()) {
+                if (is_container(element)) {
+                    pending.push_back(std::move(element));
+                }
+            }
+        }
+    }
+
+    void release(void) noexcept {
+        try {
+            pending_type pending{};
+            this->detach(pending);
+            while (!pending.empty()) {
+                basic_value node = std::move(pending.back());
+                pending.pop_back();
+                node.detach(pending);
+                // Only scalars and moved from containers are left, destroy them before ~basic_value scans them again.
+                node._Value.template emplace<null_type>();
+            }
+        }
+        catch (...) {
+            // Out of memory for the stack, the remaining members are destroyed recursively.
+        }
+    }
+
+    value_type _Value{ null_type{} };
+};
+
+template<typename Char, typename Traits, typename Allocator>
+inline basic_writer<Char, Traits>& operator<<(basic_writer<Char, Traits>& w, const basic_value<Char, Traits, Allocator>& jvalue) {
+    w.count(static_cast<type_id>(jvalue.get().index()));
+    return std::visit([&](const auto& value) -> basic_writer<Char, Traits>&{
+        return (w << value);
+    }, jvalue.get());
+}
+
+template<typename Char, typename Traits, typename Allocator>
+inline basic_reader<Char, Traits>& operator>>(basic_reader<Char, Traits>& r, basic_value<Char, Traits, Allocator>& jvalue) {
+    const type_id id = r.type();
+    r.count(id);
+    switch (id) {
+    case type_id::null:    return (r >> jvalue.to_null());
+    case type_id::string:  return (r >> jvalue.to_string());
+    case type_id::number:  return (r >> jvalue.to_number());
+    case type_id::array:   return (r >> jvalue.to_array());
+    case type_id::object:  return (r >> jvalue.to_object());
+    case type_id::boolean: return (r >> jvalue.to_boolean());
+    default:
+        throw std::bad_typeid();
+    }
+}
+
+RW_JSON_NAMESPACE_END
+RW_NAMESPACE_END
+
+namespace std {
+    template<typename Char, typename Traits, typename Allocator>
+    struct hash<RW_NAMESPACE::RW_JSON_NAMESPACE::basic_value<Char, Traits, Allocator>> {
+        std::size_t operator()(const RW_NAMESPACE::RW_JSON_NAMESPACE::basic_value<Char, Traits, Allocator>& jvalue) const {
+            return jvalue.hash();
+        }
+    };
+}
+
+RW_NAMESPACE_BEGIN
+RW_JSON_NAMESPACE_BEGIN
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// NULL
+//
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_null<T, typename basic_value<Char, Traits, Allocator>::null_type>
+basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
+    jvalue.get() = typename basic_value<Char, Traits, Allocator>::null_type(value);
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_null<T, typename basic_value<Char, Traits, Allocator>::null_type>
+basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
+    jvalue.get() = typename basic_value<Char, Traits, Allocator>::null_type(std::forward<T>(value));
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_null<T, typename basic_value<Char, Traits, Allocator>::null_type>
+const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
+    value = T(std::get<typename basic_value<Char, Traits, Allocator>::null_type>(jvalue.get()));
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::null_type>
+basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
+    typename basic_value<Char, Traits, Allocator>::null_type v{};
+    jvalue.get() = std::move(v << value);
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::null_type>
+basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
+    typename basic_value<Char, Traits, Allocator>::null_type v{};
+    jvalue.get() = std::move(v << value);
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::null_type>
+const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
+    std::get<typename basic_value<Char, Traits, Allocator>::null_type>(jvalue.get()) >> value;
+    return jvalue;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// STRING
+//
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_string<T, typename basic_value<Char, Traits, Allocator>::string_type>
+basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
+    jvalue.get() = typename basic_value<Char, Traits, Allocator>::string_type(value);
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_string<T, typename basic_value<Char, Traits, Allocator>::string_type>
+basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
+    jvalue.get() = typename basic_value<Char, Traits, Allocator>::string_type(std::forward<T>(value));
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_string<T, typename basic_value<Char, Traits, Allocator>::string_type>
 const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
     value = T(std::get<typename basic_value<Char, Traits, Allocator>::string_type>(jvalue.get()));
     return jvalue;
 }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::string_type>
-basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
-    typename basic_value<Char, Traits, Allocator>::string_type v{};
-    jvalue.get() = std::move(v << value);
-    return jvalue;
-}
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_string<T, typename basic_value<Char, Traits, Allocator>::string_type>
+basic_value<Char, Traits, Allocator>&& operator>>(basic_value<Char, Traits, Allocator>&& jvalue, T& value) {
+    value = T(std::move(std::get<typename basic_value<Char, Traits, Allocator>::string_type>(jvalue.get())));
+    return std::move(jvalue);
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::string_type>
+basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
+    typename basic_value<Char, Traits, Allocator>::string_type v{};
+    jvalue.get() = std::move(v << value);
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::string_type>
+basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
+    typename basic_value<Char, Traits, Allocator>::string_type v{};
+    jvalue.get() = std::move(v << value);
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::string_type>
+const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
+    std::get<typename basic_value<Char, Traits, Allocator>::string_type>(jvalue.get()) >> value;
+    return jvalue;
+}
+
+template<typename Char, typename Traits, typename Allocator, std::size_t N>
+basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const Char(&value)[N]) {
+    jvalue.get() = typename basic_value<Char, Traits, Allocator>::string_type(value);
+    return jvalue;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// NUMBER
+//
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_number<T, typename basic_value<Char, Traits, Allocator>::number_type>
+basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
+    jvalue.get() = typename basic_value<Char, Traits, Allocator>::number_type(value);
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_number<T, typename basic_value<Char, Traits, Allocator>::number_type>
+basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
+    jvalue.get() = typename basic_value<Char, Traits, Allocator>::number_type(std::forward<T>(value));
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_number<T, typename basic_value<Char, Traits, Allocator>::number_type>
+const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
+    value = std::get<typename basic_value<Char, Traits, Allocator>::number_type>(jvalue.get()).template as<T>();
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::number_type>
+basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
+    typename basic_value<Char, Traits, Allocator>::number_type v{};
+    jvalue.get() = std::move(v << value);
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::number_type>
+basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
+    typename basic_value<Char, Traits, Allocator>::number_type v{};
+    jvalue.get() = std::move(v << value);
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::number_type>
+const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
+    std::get<typename basic_value<Char, Traits, Allocator>::number_type>(jvalue.get()) >> value;
+    return jvalue;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// BOOLEN
+//
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_boolean<T, typename basic_value<Char, Traits, Allocator>::boolean_type>
+basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
+    jvalue.get() = typename basic_value<Char, Traits, Allocator>::boolean_type(value);
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_boolean<T, typename basic_value<Char, Traits, Allocator>::boolean_type>
+basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
+    jvalue.get() = typename basic_value<Char, Traits, Allocator>::boolean_type(std::forward<T>(value));
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_boolean<T, typename basic_value<Char, Traits, Allocator>::boolean_type>
+const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
+    value = T(std::get<typename basic_value<Char, Traits, Allocator>::boolean_type>(jvalue.get()));
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::boolean_type>
+basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
+    typename basic_value<Char, Traits, Allocator>::boolean_type v{};
+    jvalue.get() = std::move(v << value);
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::boolean_type>
+basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
+    typename basic_value<Char, Traits, Allocator>::boolean_type v{};
+    jvalue.get() = std::move(v << value);
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::boolean_type>
+const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
+    std::get<typename basic_value<Char, Traits, Allocator>::boolean_type>(jvalue.get()) >> value;
+    return jvalue;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// ARRAY VALUE
+//
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::array_type>
+inline basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
+    typename basic_value<Char, Traits, Allocator>::array_type v{};
+    jvalue.get() = std::move(v << value);
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::array_type>
+inline basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
+    typename basic_value<Char, Traits, Allocator>::array_type v{};
+    jvalue.get() = std::move(v << std::forward<T>(value));
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::array_type>
+inline const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
+    std::get<typename basic_value<Char, Traits, Allocator>::array_type>(jvalue.get()) >> value;
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::array_type>
+inline basic_value<Char, Traits, Allocator>&& operator>>(basic_value<Char, Traits, Allocator>&& jvalue, T& value) {
+    std::move(std::get<typename basic_value<Char, Traits, Allocator>::array_type>(jvalue.get())) >> value;
+    return std::move(jvalue);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// OBJECT VALUE
+//
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::object_type>
+inline basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
+    typename basic_value<Char, Traits, Allocator>::object_type v{};
+    jvalue.get() = std::move(v << value);
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::object_type>
+inline basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
+    typename basic_value<Char, Traits, Allocator>::object_type v{};
+    jvalue.get() = std::move(v << std::forward<T>(value));
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::object_type>
+inline const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
+    std::get<typename basic_value<Char, Traits, Allocator>::object_type>(jvalue.get()) >> value;
+    return jvalue;
+}
+
+template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::object_type>
+inline basic_value<Char, Traits, Allocator>&& operator>>(basic_value<Char, Traits, Allocator>&& jvalue, T& value) {
+    std::move(std::get<typename basic_value<Char, Traits, Allocator>::object_type>(jvalue.get())) >> value;
+    return std::move(jvalue);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// MEMORY
+// --------
+//  memory_usage() walks a value and adds up the heap bytes it owns, by category, from sizes and capacities.
+//  The root value itself is not on the heap and not counted. Strings short enough for the small string
+//  buffer own no heap, neither do interned keys, their characters belong to the pool. Allocator overhead is
+//  not visible this way, plug a counting_allocator into the value to measure what is really allocated.
+//
+
+struct memory_report {
+    std::size_t nodes{ 0 };     // Element and member slots in use, including packed array buffers
+    std::size_t slack{ 0 };     // Reserved but unused slots of arrays and objects
+    std::size_t strings{ 0 };   // Heap buffers of string values
+    std::size_t keys{ 0 };      // Heap buffers of object keys
+    std::size_t buckets{ 0 };   // Hash indices of objects past basic_flat_map::index_threshold
+    std::size_t caches{ 0 };    // Text kept by caching writers, see basic_writer::caching(), not from the allocator
+
+    std::size_t total(void) const noexcept {
+        return nodes + slack + strings + keys + buckets + caches;
+    }
+
+    memory_report& operator+=(const memory_report& other) noexcept {
+        nodes += other.nodes;
+        slack += other.slack;
+        strings += other.strings;
+        keys += other.keys;
+        buckets += other.buckets;
+        caches += other.caches;
+        return *this;
+    }
+};
+
+template<typename Char, typename Traits, typename Allocator>
+inline memory_report memory_usage(const basic_value<Char, Traits, Allocator>& jvalue) {
+    using value_type  = basic_value<Char, Traits, Allocator>;
+    using array_type  = typename value_type::array_type;
+    using object_type = typename value_type::object_type;
+    using entry_type  = typename object_type::object_type::value_type;
+
+    const std::size_t small = typename value_type::string_type{}.capacity();
+    auto heap = [small](std::size_t capacity) -> std::size_t {
+        return capacity > small ? (capacity + 1) * sizeof(Char) : 0;
+    };
+    auto packed = [](const array_type& jarray, memory_report& report, auto tag) -> bool {
+        using T = decltype(tag);
+        if (!jarray.template packed<T>()) {
+            return false;
+        }
+        report.nodes += jarray.size() * sizeof(T);
+        report.slack += (jarray.capacity() - jarray.size()) * sizeof(T);
+        return true;
+    };
+
+    memory_report report{};
+    std::vector<const value_type*> pending{ &jvalue };
+    while (!pending.empty()) {
+        const value_type& current = *pending.back();
+        pending.pop_back();
+
+        if (current.is_string()) {
+            report.strings += heap(current.string().capacity());
+        }
+        else if (current.is_array()) {
+            const array_type& jarray = current.array();
+            report.caches += jarray.cache().bytes();
+            if (packed(jarray, report, typename array_type::float_type{}) ||
+                packed(jarray, report, typename array_type::integer_type{}) ||
+                packed(jarray, report, typename array_type::boolean_type{})) {
+                continue;
+            }
+            report.nodes += jarray.size() * sizeof(value_type);
+            report.slack += (jarray.capacity() - jarray.size()) * sizeof(value_type);
+            for (const value_type& element : jarray.get()) {
+                pending.push_back(&element);
+            }
+        }
+        else if (current.is_object()) {
+            const typename object_type::object_type& map = current.object().get();
+            report.caches += current.object().cache().bytes();
+            report.nodes += map.size() * sizeof(entry_type);
+            report.slack += (map.capacity() - map.size()) * sizeof(entry_type);
+            report.buckets += map.bucket_count() * sizeof(typename object_type::size_type);
+            for (const entry_type& entry : map) {
+                report.keys += heap(entry.first.capacity());
+                pending.push_back(&entry.second);
+            }
+        }
+    }
+    return report;
+}
+
+// Heap bytes of every counting_allocator with the same Tag, shared by all copies and rebinds.
+struct allocation_counter {
+    std::atomic<std::size_t> bytes{ 0 };
+    std::atomic<std::size_t> peak{ 0 };
+    std::atomic<std::size_t> allocations{ 0 };
+    std::atomic<std::size_t> deallocations{ 0 };
+};
+
+namespace detail {
+    template<typename Tag>
+    allocation_counter& counter_for(void) noexcept {
+        static allocation_counter counter{};
+        return counter;
+    }
+}
+
+// Forwards to Allocator and counts every byte in the counter of Tag. The library default constructs allocators,
+// so the counter cannot be carried by the instance, give every DOM to be measured separately its own Tag.
+template<typename T, typename Tag = void, typename Allocator = std::allocator<T>>
+class counting_allocator {
+public:
+    using value_type      = T;
+    using upstream_type   = Allocator;
+    using size_type       = std::size_t;
+    using is_always_equal = typename std::allocator_traits<Allocator>::is_always_equal;
+
+    template<typename U>
+    struct rebind {
+        using other = counting_allocator<U, Tag, typename std::allocator_traits<Allocator>::template rebind_alloc<U>>;
+    };
+
+    counting_allocator(void) = default;
+
+    counting_allocator(const Allocator& upstream) noexcept
+        : _Upstream(upstream)
+    {
+    }
+
+    template<typename U, typename Other>
+    counting_allocator(const counting_allocator<U, Tag, Other>& other) noexcept
+        : _Upstream(other.upstream())
+    {
+    }
+
+    T* allocate(size_type count) {
+        T* ptr = std::allocator_traits<Allocator>::allocate(_Upstream, count);
+        allocation_counter& c = counting_allocator::counter();
+        const std::size_t bytes = count * sizeof(T);
+        const std::size_t now = c.bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        std::size_t peak = c.peak.load(std::memory_order_relaxed);
+        while (now > peak && !c.peak.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+        }
+        c.allocations.fetch_add(1, std::memory_order_relaxed);
+        return ptr;
+    }
+
+    void deallocate(T* ptr, size_type count) noexcept {
+        std::allocator_traits<Allocator>::deallocate(_Upstream, ptr, count);
+        allocation_counter& c = counting_allocator::counter();
+        c.bytes.fetch_sub(count * sizeof(T), std::memory_order_relaxed);
+        c.deallocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const Allocator& upstream(void) const noexcept {
+        return _Upstream;
+    }
+
+    static allocation_counter& counter(void) noexcept {
+        return detail::counter_for<Tag>();
+    }
+
+    template<typename U, typename Other>
+    friend bool operator==(const counting_allocator& lhs, const counting_allocator<U, Tag, Other>& rhs) noexcept {
+        return lhs.upstream() == rhs.upstream();
+    }
+
+private:
+    [[no_unique_address]] Allocator _Upstream{};
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// TAPE
+// ------
+//  Read only document stored as a single tape of 64 bit words plus one character arena.
+//  Every word carries its tag in the upper 8 bits and a 56 bit payload. Container words store the index
+//  past their matching end word, which stores the element count, so skipping an array or object and
+//  counting its elements are O(1). Strings store their arena offset, and strings and numbers take a
+//  second word holding the length or the raw bits.
+//
+
+template<typename Char, typename Traits = std::char_traits<Char>, typename Allocator = std::allocator<Char>>
+class basic_tape;
+
+template<typename Char, typename Traits = std::char_traits<Char>, typename Allocator = std::allocator<Char>>
+class basic_tape_ref {
+public:
+    using tape_type   = basic_tape<Char, Traits, Allocator>;
+    using value_type  = basic_value<Char, Traits, Allocator>;
+    using view_type   = std::basic_string_view<Char, Traits>;
+    using number_type = typename value_type::number_type;
+    using size_type   = std::size_t;
+
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = basic_tape_ref;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = basic_tape_ref;
+
+        iterator(void) = default;
+
+        iterator(const tape_type* tape, size_type index, bool object) noexcept
+            : _Tape(tape)
+            , _Index(index)
+            , _Object(object)
+        {
+        }
+
+        basic_tape_ref operator*(void) const noexcept {
+            return basic_tape_ref(*_Tape, _Object ? _Index + 2 : _Index);
+        }
+
+        view_type key(void) const {
+            return basic_tape_ref(*_Tape, _Index).string();
+        }
+
+        iterator& operator++(void) noexcept {
+            _Index = _Tape->next(_Object ? _Index + 2 : _Index);
+            return *this;
+        }
+
+        iterator operator++(int) noexcept {
+            iterator it = *this;
+            ++(*this);
+            return it;
+        }
+
+        friend bool operator==(const iterator& lhs, const iterator& rhs) noexcept {
+            return lhs._Index == rhs._Index;
+        }
+
+    private:
+        const tape_type* _Tape{ nullptr };
+        size_type        _Index{ 0 };
+        bool             _Object{ false };
+    };
+
+    basic_tape_ref(const tape_type& tape, size_type index = 0) noexcept
+        : _Tape(&tape)
+        , _Index(index)
+    {
+    }
+
+    type_id type(void) const noexcept {
+        if (_Index >= _Tape->_Words.size()) {
+            return type_id::invalid;
+        }
+        switch (tape_type::tag(_Tape->_Words[_Index])) {
+        case tape_type::null_tag:   return type_id::null;
+        case tape_type::string_tag: return type_id::string;
+        case tape_type::number_tag: return type_id::number;
+        case tape_type::int_tag:    return type_id::number;
+        case tape_type::uint_tag:   return type_id::number;
+        case tape_type::array_tag:  return type_id::array;
+        case tape_type::object_tag: return type_id::object;
+        case tape_type::true_tag:   return type_id::boolean;
+        case tape_type::false_tag:  return type_id::boolean;
+        default:
+            break;
+        }
+        return type_id::invalid;
+    }
+
+    bool is_null(void) const noexcept {
+        return this->type() == type_id::null;
+    }
+
+    bool is_string(void) const noexcept {
+        return this->type() == type_id::string;
+    }
+
+    bool is_number(void) const noexcept {
+        return this->type() == type_id::number;
+    }
+
+    bool is_array(void) const noexcept {
+        return this->type() == type_id::array;
+    }
+
+    bool is_object(void) const noexcept {
+        return this->type() == type_id::object;
+    }
+
+    bool is_boolean(void) const noexcept {
+        return this->type() == type_id::boolean;
+    }
+
+    view_type string(void) const {
+        this->require(type_id::string);
+        return _Tape->string_at(_Index);
+    }
+
+    number_type number(void) const {
+        this->require(type_id::number);
+        const typename tape_type::word_type bits = _Tape->_Words[_Index + 1];
+        switch (tape_type::tag(_Tape->_Words[_Index])) {
+        case tape_type::int_tag:  return number_type(std::bit_cast<typename number_type::int_type>(bits));
+        case tape_type::uint_tag: return number_type(std::bit_cast<typename number_type::uint_type>(bits));
+        default:
+            break;
+        }
+        return number_type(std::bit_cast<typename number_type::float_type>(bits));
+    }
+
+    bool boolean(void) const {
+        this->require(type_id::boolean);
+        return tape_type::tag(_Tape->_Words[_Index]) == tape_type::true_tag;
+    }
+
+    size_type size(void) const {
+        if (!this->is_array() && !this->is_object()) {
+            throw std::bad_variant_access();
+        }
+        return static_cast<size_type>(tape_type::payload(_Tape->_Words[_Tape->next(_Index) - 1]));
+    }
+
+    bool contains(view_type key) const {
+        return this->find(key) != this->end();
+    }
+
+    iterator find(view_type key) const {
+        this->require(type_id::object);
+        for (iterator it = this->begin(); it != this->end(); ++it) {
+            if (it.key() == key) {
+                return it;
+            }
+        }
+        return this->end();
+    }
+
+    basic_tape_ref at_key(view_type key) const {
+        iterator it = this->find(key);
+        if (it == this->end()) {
+            throw std::out_of_range("Key not found in tape object");
+        }
+        return *it;
+    }
+
+    basic_tape_ref at_index(size_type idx) const {
+        this->require(type_id::array);
+        iterator it = this->begin();
+        for (; it != this->end() && idx > 0; ++it, --idx) {
+        }
+        if (it == this->end()) {
+            throw std::out_of_range("Index out of tape array range");
+        }
+        return *it;
+    }
+
+    iterator begin(void) const {
+        if (!this->is_array() && !this->is_object()) {
+            throw std::bad_variant_access();
+        }
+        return iterator(_Tape, _Index + 1, this->is_object());
+    }
+
+    iterator end(void) const {
+        return iterator(_Tape, _Tape->next(_Index) - 1, this->is_object());
+    }
+
+    value_type value(void) const {
+        value_type jvalue{};
+        switch (this->type()) {
+        case type_id::null:
+            break;
+        case type_id::string:
+            jvalue.to_string() = this->string();
+            break;
+        case type_id::number:
+            jvalue.to_number() = this->number();
+            break;
+        case type_id::array:
+            jvalue.to_array().get().reserve(this->size());
+            for (basic_tape_ref element : *this) {
+                jvalue.array().get().emplace_back(element.value());
+            }
+            break;
+        case type_id::object:
+            jvalue.to_object();
+            for (iterator it = this->begin(); it != this->end(); ++it) {
+                jvalue.object()[typename value_type::key_type(it.key())] = (*it).value();
+            }
+            break;
+        case type_id::boolean:
+            jvalue.to_boolean() = this->boolean();
+            break;
+        default:
+            throw std::bad_typeid();
+        }
+        return jvalue;
+    }
+
+    size_type index(void) const noexcept {
+        return _Index;
+    }
+
+private:
+    void require(type_id id) const {
+        if (this->type() != id) {
+            throw std::bad_variant_access();
+        }
+    }
+
+    const tape_type* _Tape{ nullptr };
+    size_type        _Index{ 0 };
+};
+
+template<typename Char, typename Traits, typename Allocator>
+class basic_tape {
+public:
+    using char_type      = Char;
+    using traits_type    = Traits;
+    using allocator_type = Allocator;
+    using word_type      = std::uint64_t;
+    using tape_type      = std::vector<word_type, detail::rebind_alloc_t<word_type, Allocator>>;
+    using arena_type     = std::basic_string<Char, Traits, Allocator>;
+    using view_type      = std::basic_string_view<Char, Traits>;
+    using ref_type       = basic_tape_ref<Char, Traits, Allocator>;
+    using value_type     = basic_value<Char, Traits, Allocator>;
+    using size_type      = std::size_t;
+
+    static constexpr word_type null_tag    = 'n';
+    static constexpr word_type string_tag  = '"';
+    static constexpr word_type number_tag  = 'd';
+    static constexpr word_type int_tag     = 'l';
+    static constexpr word_type uint_tag    = 'u';
+    static constexpr word_type array_tag   = '[';
+    static constexpr word_type array_end   = ']';
+    static constexpr word_type object_tag  = '{';
+    static constexpr word_type object_end  = '}';
+    static constexpr word_type true_tag    = 't';
+    static constexpr word_type false_tag   = 'f';
+    static constexpr word_type payload_mask = (word_type(1) << 56) - 1;
+
+    ref_type root(void) const noexcept {
+        return ref_type(*this, 0);
+    }
+
+    bool empty(void) const noexcept {
+        return _Words.empty();
+    }
+
+    void clear(void) noexcept {
+        _Words.clear();
+        _Strings.clear();
+    }
+
+    const tape_type& words(void) const noexcept {
+        return _Words;
+    }
+
+    const arena_type& strings(void) const noexcept {
+        return _Strings;
+    }
+
+    value_type value(void) const {
+        return this->root().value();
+    }
+
+    template<typename ... Ts>
+    basic_reader<Char, Ts...>& read(basic_reader<Char, Ts...>& r) {
+        this->clear();
+        this->read_value(r);
+        return r;
+    }
+
+private:
+    friend ref_type;
+
+    static word_type tag(word_type word) noexcept {
+        return word >> 56;
+    }
+
+    static word_type payload(word_type word) noexcept {
+        return word & payload_mask;
+    }
+
+    static word_type make(word_type tag, word_type payload) {
+        if (payload > payload_mask) {
+            throw std::length_error("Tape payload exceeds 56 bits");
+        }
+        return (tag << 56) | payload;
+    }
+
+    size_type next(size_type index) const noexcept {
+        switch (tag(_Words[index])) {
+        case string_tag:
+        case number_tag:
+        case int_tag:
+        case uint_tag:
+            return index + 2;
+        case array_tag:
+        case object_tag:
+            return static_cast<size_type>(payload(_Words[index]));
+        default:
+            break;
+        }
+        return index + 1;
+    }
+
+    view_type string_at(size_type index) const noexcept {
+        return view_type(_Strings).substr(static_cast<size_type>(payload(_Words[index])), static_cast<size_type>(_Words[index + 1]));
+    }
+
+    template<typename ... Ts>
+    void read_value(basic_reader<Char, Ts...>& r) {
+        switch (r.type()) {
+        case type_id::null:
+            r >> nullptr;
+            _Words.push_back(make(null_tag, 0));
+            break;
+        case type_id::string:
+            this->read_string(r);
+            break;
+        case type_id::number: {
+            typename value_type::number_type number{};
+            r >> number;
+            switch (number.kind()) {
+            case number_kind::integer:
+                _Words.push_back(make(int_tag, 0));
+                _Words.push_back(std::bit_cast<word_type>(number.template as<typename value_type::number_type::int_type>()));
+                break;
+            case number_kind::unsigned_integer:
+                _Words.push_back(make(uint_tag, 0));
+                _Words.push_back(std::bit_cast<word_type>(number.template as<typename value_type::number_type::uint_type>()));
+                break;
+            default:
+                _Words.push_back(make(number_tag, 0));
+                _Words.push_back(std::bit_cast<word_type>(number.template as<typename value_type::number_type::float_type>()));
+                break;
+            }
+            break;
+        }
+        case type_id::array:
+            this->read_container(r, array_tag, array_end, false);
+            break;
+        case type_id::object:
+            this->read_container(r, object_tag, object_end, true);
+            break;
+        case type_id::boolean: {
+            bool boolean{};
+            r >> boolean;
+            _Words.push_back(make(boolean ? true_tag : false_tag, 0));
+            break;
+        }
+        default:
+            throw std::bad_typeid();
+        }
+    }
+
+    template<typename ... Ts>
+    void read_string(basic_reader<Char, Ts...>& r) {
+        r >> _Scratch;
+        _Words.push_back(make(string_tag, _Strings.size()));
+        _Words.push_back(_Scratch.size());
+        _Strings.append(_Scratch);
+    }
+
+    template<typename ... Ts>
+    void read_container(basic_reader<Char, Ts...>& r, word_type open, word_type close, bool object) {
+        size_type start = _Words.size();
+        word_type elements = 0;
+        _Words.push_back(make(open, 0));
+
+        r.expect(Char(open));
+        if (!r.consume(Char(close))) {
+            do {
+                if (object) {
+                    this->read_string(r);
+                    r.expect(Char(':'));
+                }
+                this->read_value(r);
+                ++elements;
+            } while (r && r.consume(Char(',')));
+            r.expect(Char(close));
+        }
+
+        _Words.push_back(make(close, elements));
+        _Words[start] = make(open, _Words.size());
+    }
+
+    tape_type                       _Words{};
+    arena_type                      _Strings{};
+    std::basic_string<Char, Traits> _Scratch{};
+};
+
+template<typename Char, typename Traits, typename Allocator>
+inline basic_reader<Char, Traits>& operator>>(basic_reader<Char, Traits>& r, basic_tape<Char, Traits, Allocator>& tape) {
+    return tape.read(r);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// SNAPSHOT
+// ----------
+//  Relocatable binary image of a document that is navigated in place, without parsing or allocating, e.g.
+//  straight from a memory mapped file. Every node starts at an 8 byte aligned offset with a header word
+//  holding its kind in the low 8 bits and its length in the upper 56 bits, containers refer to their
+//  elements by offset from the start of the image. Strings are length prefixed and zero terminated, arrays
+//  of only integers, only floats or only booleans are stored packed and object members are sorted by key,
+//  so member lookup is a binary search and iteration visits members in key order.
+//  The image uses the byte order of the machine that wrote it and has to be 8 byte aligned in memory.
+//
+
+template<typename Char, typename Traits = std::char_traits<Char>, typename Allocator = std::allocator<Char>>
+class basic_snapshot;
+
+template<typename Char, typename Traits = std::char_traits<Char>, typename Allocator = std::allocator<Char>>
+class basic_snapshot_ref {
+public:
+    using snapshot_type = basic_snapshot<Char, Traits, Allocator>;
+    using value_type    = basic_value<Char, Traits, Allocator>;
+    using view_type     = std::basic_string_view<Char, Traits>;
+    using number_type   = typename value_type::number_type;
+    using size_type     = std::size_t;
+
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+    class iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type        = basic_snapshot_ref;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = basic_snapshot_ref;
+
+        iterator(void) = default;
+
+        iterator(const basic_snapshot_ref& container, size_type position) noexcept
+            : _Container(container)
+            , _Position(position)
+        {
+        }
+
+        basic_snapshot_ref operator*(void) const {
+            return _Container.element(_Position);
+        }
+
+        view_type key(void) const {
+            return _Container.key(_Position);
+        }
+
+        iterator& operator++(void) noexcept {
+            ++_Position;
+            return *this;
+        }
+
+        iterator operator++(int) noexcept {
+            iterator it = *this;
+            ++_Position;
+            return it;
+        }
+
+        iterator& operator--(void) noexcept {
+            --_Position;
+            return *this;
+        }
+
+        iterator operator--(int) noexcept {
+            iterator it = *this;
+            --_Position;
+            return it;
+        }
+
+        iterator& operator+=(difference_type n) noexcept {
+            _Position = static_cast<size_type>(static_cast<difference_type>(_Position) + n);
+            return *this;
+        }
+
+        iterator& operator-=(difference_type n) noexcept {
+            return (*this) += -n;
+        }
+
+        friend iterator operator+(iterator it, difference_type n) noexcept {
+            return it += n;
+        }
+
+        friend iterator operator-(iterator it, difference_type n) noexcept {
+            return it -= n;
+        }
+
+        friend difference_type operator-(const iterator& lhs, const iterator& rhs) noexcept {
+            return static_cast<difference_type>(lhs._Position) - static_cast<difference_type>(rhs._Position);
+        }
+
+        basic_snapshot_ref operator[](difference_type n) const {
+            return *((*this) + n);
+        }
+
+        friend bool operator==(const iterator& lhs, const iterator& rhs) noexcept {
+            return lhs._Position == rhs._Position;
+        }
+
+        friend auto operator<=>(const iterator& lhs, const iterator& rhs) noexcept {
+            return lhs._Position <=> rhs._Position;
+        }
+
+    private:
+        basic_snapshot_ref _Container{};
+        size_type          _Position{ 0 };
+    };
+
+    basic_snapshot_ref(void) = default;
+
+    basic_snapshot_ref(std::span<const std::byte> image, size_type offset, size_type element = npos) noexcept
+        : _Image(image)
+        , _Offset(offset)
+        , _Element(element)
+    {
+    }
+
+    type_id type(void) const {
+        switch (this->kind()) {
+        case snapshot_type::null_kind:          return type_id::null;
+        case snapshot_type::false_kind:         return type_id::boolean;
+        case snapshot_type::true_kind:          return type_id::boolean;
+        case snapshot_type::int_kind:           return type_id::number;
+        case snapshot_type::uint_kind:          return type_id::number;
+        case snapshot_type::float_kind:         return type_id::number;
+        case snapshot_type::string_kind:        return type_id::string;
+        case snapshot_type::array_kind:         return type_id::array;
+        case snapshot_type::packed_int_kind:    return type_id::array;
+        case snapshot_type::packed_float_kind:  return type_id::array;
+        case snapshot_type::packed_bool_kind:   return type_id::array;
+        case snapshot_type::object_kind:        return type_id::object;
+        default:
+            break;
+        }
+        return type_id::invalid;
+    }
+
+    bool is_null(void) const {
+        return this->type() == type_id::null;
+    }
+
+    bool is_string(void) const {
+        return this->type() == type_id::string;
+    }
+
+    bool is_number(void) const {
+        return this->type() == type_id::number;
+    }
+
+    bool is_array(void) const {
+        return this->type() == type_id::array;
+    }
+
+    bool is_object(void) const {
+        return this->type() == type_id::object;
+    }
+
+    bool is_boolean(void) const {
+        return this->type() == type_id::boolean;
+    }
+
+    view_type string(void) const {
+        this->require(type_id::string);
+        return this->string_at(_Offset);
+    }
+
+    number_type number(void) const {
+        this->require(type_id::number);
+        switch (this->kind()) {
+        case snapshot_type::int_kind:  return number_type(this->template load<typename number_type::int_type>(this->slot()));
+        case snapshot_type::uint_kind: return number_type(this->template load<typename number_type::uint_type>(this->slot()));
+        default:
+            break;
+        }
+        return number_type(this->template load<typename number_type::float_type>(this->slot()));
+    }
+
+    bool boolean(void) const {
+        this->require(type_id::boolean);
+        return this->kind() == snapshot_type::true_kind;
+    }
+
+    size_type size(void) const {
+        if (!this->is_array() && !this->is_object()) {
+            throw std::bad_variant_access();
+        }
+        return this->length();
+    }
+
+    // Elements of a packed array, T has to match its kind: std::int64_t, std::double_t or std::uint8_t.
+    template<typename T> requires (std::same_as<T, std::int64_t> || std::same_as<T, std::double_t> || std::same_as<T, std::uint8_t>)
+    std::span<const T> span(void) const {
+        std::uint8_t expected = snapshot_type::packed_bool_kind;
+        if constexpr (std::same_as<T, std::int64_t>) {
+            expected = snapshot_type::packed_int_kind;
+        }
+        if constexpr (std::same_as<T, std::double_t>) {
+            expected = snapshot_type::packed_float_kind;
+        }
+        if (_Element != npos || this->kind() != expected) {
+            throw std::bad_variant_access();
+        }
+        return std::span<const T>(this->template elements<T>(_Offset + snapshot_type::word_size, this->length()), this->length());
+    }
+
+    bool contains(view_type key) const {
+        return this->find(key) != this->end();
+    }
+
+    iterator find(view_type key) const {
+        this->require(type_id::object);
+        size_type first = 0;
+        size_type last  = this->length();
+        while (first < last) {
+            size_type middle = first + (last - first) / 2;
+            int compare = this->key(middle).compare(key);
+            if (compare == 0) {
+                return iterator(*this, middle);
+            }
+            if (compare < 0) {
+                first = middle + 1;
+            }
+            else {
+                last = middle;
+            }
+        }
+        return this->end();
+    }
+
+    basic_snapshot_ref at_key(view_type key) const {
+        iterator it = this->find(key);
+        if (it == this->end()) {
+            throw std::out_of_range("Key not found in snapshot object");
+        }
+        return *it;
+    }
+
+    basic_snapshot_ref at_index(size_type idx) const {
+        this->require(type_id::array);
+        if (idx >= this->length()) {
+            throw std::out_of_range("Index out of snapshot array range");
+        }
+        return this->element(idx);
+    }
+
+    iterator begin(void) const {
+        if (!this->is_array() && !this->is_object()) {
+            throw std::bad_variant_access();
+        }
+        return iterator(*this, 0);
+    }
+
+    iterator end(void) const {
+        return iterator(*this, this->length());
+    }
+
+    value_type value(void) const {
+        value_type jvalue{};
+        switch (this->type()) {
+        case type_id::null:
+            break;
+        case type_id::string:
+            jvalue.to_string() = this->string();
+            break;
+        case type_id::number:
+            jvalue.to_number() = this->number();
+            break;
+        case type_id::array:
+            switch (this->kind()) {
+            case snapshot_type::packed_int_kind:   this->unpack<std::int64_t>(jvalue.to_array());  break;
+            case snapshot_type::packed_float_kind: this->unpack<std::double_t>(jvalue.to_array()); break;
+            case snapshot_type::packed_bool_kind:  this->unpack<std::uint8_t>(jvalue.to_array());  break;
+            default:
+                jvalue.to_array().get().reserve(this->length());
+                for (basic_snapshot_ref element : *this) {
+                    jvalue.array().get().emplace_back(element.value());
+                }
+                break;
+            }
+            break;
+        case type_id::object:
+            jvalue.to_object().get().reserve(this->length());
+            for (iterator it = this->begin(); it != this->end(); ++it) {
+                jvalue.object()[typename value_type::key_type(it.key())] = (*it).value();
+            }
+            break;
+        case type_id::boolean:
+            jvalue.to_boolean() = this->boolean();
+            break;
+        default:
+            throw std::bad_typeid();
+        }
+        return jvalue;
+    }
+
+    size_type offset(void) const noexcept {
+        return _Offset;
+    }
+
+private:
+    template<typename T>
+    void unpack(typename value_type::array_type& array) const {
+        auto elements = this->template span<T>();
+        array.template to_packed<T>().assign(elements.begin(), elements.end());
+    }
+
+    // Kind of this node, elements of packed arrays report the kind of a single element.
+    std::uint8_t kind(void) const {
+        if (_Image.empty()) {
+            return snapshot_type::invalid_kind;
+        }
+        std::uint8_t container = static_cast<std::uint8_t>(this->template load<std::uint64_t>(_Offset) & 0xff);
+        if (_Element == npos) {
+            return container;
+        }
+        switch (container) {
+        case snapshot_type::packed_int_kind:   return snapshot_type::int_kind;
+        case snapshot_type::packed_float_kind: return snapshot_type::float_kind;
+        default:
+            break;
+        }
+        return this->template load<std::uint8_t>(this->slot()) != 0 ? snapshot_type::true_kind : snapshot_type::false_kind;
+    }
+
+    size_type length(void) const {
+        return static_cast<size_type>(this->template load<std::uint64_t>(_Offset) >> 8);
+    }
+
+    // Offset of the payload of a scalar, for elements of packed arrays the offset of the element.
+    size_type slot(void) const {
+        if (_Element == npos) {
+            return _Offset + snapshot_type::word_size;
+        }
+        size_type width = (this->template load<std::uint64_t>(_Offset) & 0xff) == snapshot_type::packed_bool_kind ? 1 : snapshot_type::word_size;
+        return _Offset + snapshot_type::word_size + _Element * width;
+    }
+
+    basic_snapshot_ref element(size_type position) const {
+        switch (this->kind()) {
+        case snapshot_type::packed_int_kind:
+        case snapshot_type::packed_float_kind:
+        case snapshot_type::packed_bool_kind:
+            return basic_snapshot_ref(_Image, _Offset, position);
+        case snapshot_type::object_kind:
+            return basic_snapshot_ref(_Image, this->template load<std::uint64_t>(_Offset + snapshot_type::word_size * (2 + 2 * position)));
+        default:
+            break;
+        }
+        return basic_snapshot_ref(_Image, this->template load<std::uint64_t>(_Offset + snapshot_type::word_size * (1 + position)));
+    }
+
+    view_type key(size_type position) const {
+        return this->string_at(this->template load<std::uint64_t>(_Offset + snapshot_type::word_size * (1 + 2 * position)));
+    }
+
+    view_type string_at(size_type offset) const {
+        size_type length = static_cast<size_type>(this->template load<std::uint64_t>(offset) >> 8);
+        return view_type(this->template elements<Char>(offset + snapshot_type::word_size, length), length);
+    }
+
+    void check(size_type offset, size_type count) const {
+        if (offset > _Image.size() || count > _Image.size() - offset) {
+            throw std::out_of_range("Offset outside of snapshot image");
+        }
+    }
+
+    // The count objects of type T at offset, referenced in place. Throws std::out_of_range unless they lie
+    // inside the image and offset is aligned for T, the image itself is 8 byte aligned.
+    template<typename T>
+    const T* elements(size_type offset, size_type count) const {
+        if (offset > _Image.size() || count > (_Image.size() - offset) / sizeof(T)) {
+            throw std::out_of_range("Offset outside of snapshot image");
+        }
+        if (offset % alignof(T) != 0) {
+            throw std::out_of_range("Misaligned offset in snapshot image");
+        }
+        return reinterpret_cast<const T*>(_Image.data() + offset);
+    }
+
+    template<typename T>
+    T load(size_type offset) const {
+        this->check(offset, sizeof(T));
+        T value{};
+        std::memcpy(&value, _Image.data() + offset, sizeof(T));
+        return value;
+    }
+
+    void require(type_id id) const {
+        if (this->type() != id) {
+            throw std::bad_variant_access();
+        }
+    }
+
+    std::span<const std::byte> _Image{};
+    size_type                  _Offset{ 0 };
+    size_type                  _Element{ npos };
+};
+
+template<typename Char, typename Traits, typename Allocator>
+class basic_snapshot {
+public:
+    using char_type      = Char;
+    using traits_type    = Traits;
+    using allocator_type = Allocator;
+    using image_type     = std::span<const std::byte>;
+    using buffer_type    = std::vector<std::byte, detail::rebind_alloc_t<std::byte, Allocator>>;
+    using view_type      = std::basic_string_view<Char, Traits>;
+    using ref_type       = basic_snapshot_ref<Char, Traits, Allocator>;
+    using value_type     = basic_value<Char, Traits, Allocator>;
+    using size_type      = std::size_t;
+
+    static constexpr std::uint32_t magic   = 0x534a5752;
+    static constexpr std::uint32_t version = 1;
+
+    basic_snapshot(void) = default;
+
+    // Builds the image of jvalue in an owned buffer.
+    explicit basic_snapshot(const value_type& jvalue) {
+        this->build(jvalue);
+    }
+
+    // Navigates an image owned by someone else, e.g. a mapped file, which has to outlive the snapshot.
+    // Throws std::invalid_argument if the image was not written by this snapshot type on a machine like this one.
+    explicit basic_snapshot(image_type image)
+        : _Image(image)
+    {
+        this->validate();
+    }
+
+    basic_snapshot(const basic_snapshot& other)
+        : _Buffer(other._Buffer)
+        , _Image(other.owning() ? image_type(_Buffer) : other._Image)
+    {
+    }
+
+    basic_snapshot(basic_snapshot&& other) noexcept
+        : _Buffer(std::move(other._Buffer))
+        , _Image(std::exchange(other._Image, image_type{}))
+    {
+    }
+
+    basic_snapshot& operator=(basic_snapshot other) noexcept {
+        _Buffer = std::move(other._Buffer);
+        _Image  = std::exchange(other._Image, image_type{});
+        return *this;
+    }
+
+    // Writes the image of jvalue to os, e.g. to be mapped later.
+    static void write(std::ostream& os, const value_type& jvalue) {
+        basic_snapshot snapshot(jvalue);
+        os.write(reinterpret_cast<const char*>(snapshot._Image.data()), static_cast<std::streamsize>(snapshot._Image.size()));
+    }
+
+    ref_type root(void) const noexcept {
+        if (_Image.empty()) {
+            return ref_type{};
+        }
+        std::uint64_t offset{};
+        std::memcpy(&offset, _Image.data() + 2 * sizeof(std::uint32_t), sizeof(offset));
+        return ref_type(_Image, static_cast<size_type>(offset));
+    }
+
+    image_type image(void) const noexcept {
+        return _Image;
+    }
+
+    bool empty(void) const noexcept {
+        return _Image.empty();
+    }
+
+    bool owning(void) const noexcept {
+        return !_Buffer.empty();
+    }
+
+    value_type value(void) const {
+        return this->root().value();
+    }
+
+private:
+    friend ref_type;
+
+    static constexpr size_type    word_size         = 8;
+    static constexpr size_type    header_size       = 24;
+    static constexpr std::uint8_t invalid_kind      = 0;
+    static constexpr std::uint8_t null_kind         = 1;
+    static constexpr std::uint8_t false_kind        = 2;
+    static constexpr std::uint8_t true_kind         = 3;
+    static constexpr std::uint8_t int_kind          = 4;
+    static constexpr std::uint8_t uint_kind         = 5;
+    static constexpr std::uint8_t float_kind        = 6;
+    static constexpr std::uint8_t string_kind       = 7;
+    static constexpr std::uint8_t array_kind        = 8;
+    static constexpr std::uint8_t packed_int_kind   = 9;
+    static constexpr std::uint8_t packed_float_kind = 10;
+    static constexpr std::uint8_t packed_bool_kind  = 11;
+    static constexpr std::uint8_t object_kind       = 12;
+
+    // Header: magic, version and character size, root offset, image size.
+    void validate(void) const {
+        if (reinterpret_cast<std::uintptr_t>(_Image.data()) % word_size != 0) {
+            throw std::invalid_argument("Snapshot image is not 8 byte aligned");
+        }
+        if (_Image.size() < header_size) {
+            throw std::invalid_argument("Snapshot image is too small");
+        }
+
+        std::uint32_t head[2]{};
+        std::uint64_t size{};
+        std::memcpy(head, _Image.data(), sizeof(head));
+        std::memcpy(&size, _Image.data() + 2 * word_size, sizeof(size));
+        if (head[0] != magic || head[1] != (version | (sizeof(Char) << 16))) {
+            throw std::invalid_argument("Not a snapshot image of this character type and byte order");
+        }
+        if (size != _Image.size()) {
+            throw std::invalid_argument("Snapshot image size does not match its header");
+        }
+    }
+
+    void build(const value_type& jvalue) {
+        _Buffer.assign(header_size, std::byte{ 0 });
+        std::uint32_t head[2]{ magic, static_cast<std::uint32_t>(version | (sizeof(Char) << 16)) };
+        std::memcpy(_Buffer.data(), head, sizeof(head));
+
+        std::uint64_t root = this->emit(jvalue);
+        std::uint64_t size = _Buffer.size();
+        this->store(word_size, root);
+        this->store(2 * word_size, size);
+        _Image = image_type(_Buffer);
+    }
+
+    template<typename T>
+    void store(size_type offset, const T& value) {
+        std::memcpy(_Buffer.data() + offset, &value, sizeof(T));
+    }
+
+    // Appends a node with room for payload bytes, padded to the next word, and returns its offset.
+    size_type allocate(std::uint8_t kind, std::uint64_t length, size_type payload) {
+        size_type offset = _Buffer.size();
+        _Buffer.resize(offset + word_size + (payload + word_size - 1) / word_size * word_size, std::byte{ 0 });
+        this->store(offset, static_cast<std::uint64_t>((length << 8) | kind));
+        return offset;
+    }
+
+    template<typename T>
+    size_type emit_scalar(std::uint8_t kind, T value) {
+        size_type offset = this->allocate(kind, 0, sizeof(T));
+        this->store(offset + word_size, value);
+        return offset;
+    }
+
+    size_type emit_string(view_type str) {
+        size_type offset = this->allocate(string_kind, str.size(), (str.size() + 1) * sizeof(Char));
+        std::memcpy(_Buffer.data() + offset + word_size, str.data(), str.size() * sizeof(Char));
+        return offset;
+    }
+
+    template<typename T>
+    size_type emit_packed(std::uint8_t kind, std::span<const T> elements) {
+        size_type offset = this->allocate(kind, elements.size(), elements.size() * sizeof(T));
+        if (!elements.empty()) {
+            std::memcpy(_Buffer.data() + offset + word_size, elements.data(), elements.size() * sizeof(T));
+        }
+        return offset;
+    }
+
+    size_type emit(const value_type& jvalue) {
+        if (jvalue.is_null()) {
+            return this->allocate(null_kind, 0, 0);
+        }
+        if (jvalue.is_boolean()) {
+            return this->allocate(jvalue.boolean() ? true_kind : false_kind, 0, 0);
+        }
+        if (jvalue.is_string()) {
+            return this->emit_string(view_type(jvalue.string()));
+        }
+        if (jvalue.is_array()) {
+            return this->emit_array(jvalue.array());
+        }
+        if (jvalue.is_object()) {
+            return this->emit_object(jvalue.object());
+        }
+
+        const auto& number = jvalue.number();
+        switch (number.kind()) {
+        case number_kind::integer:          return this->emit_scalar(int_kind, number.template as<typename value_type::number_type::int_type>());
+        case number_kind::unsigned_integer: return this->emit_scalar(uint_kind, number.template as<typename value_type::number_type::uint_type>());
+        default:
+            break;
+        }
+        return this->emit_scalar(float_kind, number.template as<typename value_type::number_type::float_type>());
+    }
+
+    size_type emit_array(const typename value_type::array_type& array) {
+        using array_type = typename value_type::array_type;
+
+        if (array.template packed<typename array_type::integer_type>()) {
+            return this->emit_packed(packed_int_kind, array.template span<typename array_type::integer_type>());
+        }
+        if (array.template packed<typename array_type::float_type>()) {
+            return this->emit_packed(packed_float_kind, array.template span<typename array_type::float_type>());
+        }
+        if (array.template packed<typename array_type::boolean_type>()) {
+            return this->emit_packed(packed_bool_kind, array.template span<typename array_type::boolean_type>());
+        }
+
+        const auto& elements = array.get();
+        if (!elements.empty()) {
+            auto all = [&](auto predicate) { return std::all_of(elements.begin(), elements.end(), predicate); };
+            if (all([](const value_type& v) { return v.is_number() && v.number().is_integer(); })) {
+                return this->emit_converted<typename array_type::integer_type>(packed_int_kind, elements, [](const value_type& v) { return v.number().template as<typename array_type::integer_type>(); });
+            }
+            if (all([](const value_type& v) { return v.is_number() && v.number().is_floating(); })) {
+                return this->emit_converted<typename array_type::float_type>(packed_float_kind, elements, [](const value_type& v) { return v.number().template as<typename array_type::float_type>(); });
+            }
+            if (all([](const value_type& v) { return v.is_boolean(); })) {
+                return this->emit_converted<typename array_type::boolean_type>(packed_bool_kind, elements, [](const value_type& v) { return static_cast<typename array_type::boolean_type>(v.boolean() ? 1 : 0); });
+            }
+        }
+
+        size_type offset = this->allocate(array_kind, elements.size(), elements.size() * word_size);
+        for (size_type i = 0; i < elements.size(); ++i) {
+            std::uint64_t child = this->emit(elements[i]);
+            this->store(offset + word_size * (1 + i), child);
+        }
+        return offset;
+    }
+
+    template<typename T, typename Elements, typename Projection>
+    size_type emit_converted(std::uint8_t kind, const Elements& elements, Projection projection) {
+        size_type offset = this->allocate(kind, elements.size(), elements.size() * sizeof(T));
+        for (size_type i = 0; i < elements.size(); ++i) {
+            this->store(offset + word_size + i * sizeof(T), static_cast<T>(projection(elements[i])));
+        }
+        return offset;
+    }
+
+    size_type emit_object(const typename value_type::object_type& object) {
+        std::vector<std::pair<view_type, const value_type*>> members{};
+        members.reserve(object.size());
+        for (const auto& [key, value] : object) {
+            members.emplace_back(view_type(key), &value);
+        }
+        std::sort(members.begin(), members.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+        size_type offset = this->allocate(object_kind, members.size(), members.size() * 2 * word_size);
+        for (size_type i = 0; i < members.size(); ++i) {
+            std::uint64_t key   = this->emit_string(members[i].first);
+            std::uint64_t value = this->emit(*members[i].second);
+            this->store(offset + word_size * (1 + 2 * i), key);
+            this->store(offset + word_size * (2 + 2 * i), value);
+        }
+        return offset;
+    }
+
+    buffer_type _Buffer{};
+    image_type  _Image{};
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// SHARED VALUE
+// --------------
+//  Immutable value whose strings, arrays and objects are reference counted and shared between copies.
+//  Copying is O(1) and safe across threads. Updates return a new value that only copies the containers
+//  on the path from the root to the changed node, everything else stays shared with the original.
+//
+
+template<typename Char, typename Traits = std::char_traits<Char>, typename Allocator = std::allocator<Char>>
+class basic_shared_value {
+public:
+    using char_type      = Char;
+    using traits_type    = Traits;
+    using allocator_type = Allocator;
+    using value_type     = basic_value<Char, Traits, Allocator>;
+    using null_type      = typename value_type::null_type;
+    using string_type    = typename value_type::string_type;
+    using key_type       = typename value_type::key_type;
+    using number_type    = typename value_type::number_type;
+    using boolean_type   = typename value_type::boolean_type;
+    using view_type      = std::basic_string_view<Char, Traits>;
+    using array_type     = std::vector<basic_shared_value, detail::rebind_alloc_t<basic_shared_value, Allocator>>;
+    using object_type    = basic_flat_map<key_type, basic_shared_value, detail::transparent_hash, std::equal_to<>, Allocator>;
+    using size_type      = std::size_t;
+    using step_type      = std::variant<size_type, view_type>;
+    using storage_type   = std::variant<null_type, std::shared_ptr<const string_type>, number_type, std::shared_ptr<const array_type>, std::shared_ptr<const object_type>, boolean_type>;
+
+    basic_shared_value(void) = default;
+
+    basic_shared_value(null_type) noexcept
+    {
+    }
+
+    basic_shared_value(string_type str)
+        : _Value(make<string_type>(std::move(str)))
+    {
+    }
+
+    basic_shared_value(const Char* str)
+        : _Value(make<string_type>(str))
+    {
+    }
+
+    template<typename T> requires is_default_number<T, number_type>
+    basic_shared_value(T number) noexcept
+        : _Value(number_type(number))
+    {
+    }
+
+    basic_shared_value(boolean_type boolean) noexcept
+        : _Value(boolean)
+    {
+    }
+
+    basic_shared_value(array_type array)
+        : _Value(make<array_type>(std::move(array)))
+    {
+    }
+
+    basic_shared_value(object_type object)
+        : _Value(make<object_type>(std::move(object)))
+    {
+    }
+
+    explicit basic_shared_value(const value_type& jvalue) {
+        switch (static_cast<type_id>(jvalue.get().index())) {
+        case type_id::string:
+            _Value = make<string_type>(jvalue.string());
+            break;
+        case type_id::number:
+            _Value = jvalue.number();
+            break;
+        case type_id::array: {
+            array_type array{};
+            array.reserve(jvalue.array().size());
+            for (const value_type& element : jvalue.array()) {
+                array.emplace_back(element);
+            }
+            _Value = make<array_type>(std::move(array));
+            break;
+        }
+        case type_id::object: {
+            object_type object{};
+            for (const auto& [key, element] : jvalue.object()) {
+                object.try_emplace(key, element);
+            }
+            _Value = make<object_type>(std::move(object));
+            break;
+        }
+        case type_id::boolean:
+            _Value = jvalue.boolean();
+            break;
+        default:
+            break;
+        }
+    }
+
+    type_id type(void) const noexcept {
+        return static_cast<type_id>(_Value.index());
+    }
+
+    bool is_null(void) const noexcept {
+        return _Value.index() == 0;
+    }
+
+    bool is_string(void) const noexcept {
+        return _Value.index() == 1;
+    }
+
+    bool is_number(void) const noexcept {
+        return _Value.index() == 2;
+    }
+
+    bool is_array(void) const noexcept {
+        return _Value.index() == 3;
+    }
+
+    bool is_object(void) const noexcept {
+        return _Value.index() == 4;
+    }
+
+    bool is_boolean(void) const noexcept {
+        return _Value.index() == 5;
+    }
+
+    const string_type& string(void) const {
+        return *std::get<1>(_Value);
+    }
+
+    number_type number(void) const {
+        return std::get<2>(_Value);
+    }
+
+    const array_type& array(void) const {
+        return *std::get<3>(_Value);
+    }
+
+    const object_type& object(void) const {
+        return *std::get<4>(_Value);
+    }
+
+    boolean_type boolean(void) const {
+        return std::get<5>(_Value);
+    }
+
+    size_type size(void) const {
+        if (this->is_object()) {
+            return this->object().size();
+        }
+        return this->array().size();
+    }
+
+    bool contains(size_type idx) const {
+        return this->is_array() && idx < this->array().size();
+    }
+
+    bool contains(const key_type& key) const {
+        return this->is_object() && this->object().contains(key);
+    }
+
+    const basic_shared_value& operator[](size_type idx) const {
+        return this->array().at(idx);
+    }
+
+    const basic_shared_value& operator[](const key_type& key) const {
+        return this->object().at(key);
+    }
+
+    basic_shared_value set(size_type idx, basic_shared_value value) const {
+        array_type array = this->is_array() ? this->array() : array_type{};
+        if (idx >= array.size()) {
+            array.resize(idx + 1);
+        }
+        array[idx] = std::move(value);
+        return basic_shared_value(std::move(array));
+    }
+
+    basic_shared_value set(const key_type& key, basic_shared_value value) const {
+        object_type object = this->is_object() ? this->object() : object_type{};
+        object[key] = std::move(value);
+        return basic_shared_value(std::move(object));
+    }
+
+    basic_shared_value push_back(basic_shared_value value) const {
+        array_type array = this->is_array() ? this->array() : array_type{};
+        array.push_back(std::move(value));
+        return basic_shared_value(std::move(array));
+    }
+
+    basic_shared_value erase(size_type idx) const {
+        if (idx >= this->array().size()) {
+            throw std::out_of_range("Index out of shared array range");
+        }
+        array_type array = this->array();
+        array.erase(array.begin() + idx);
+        return basic_shared_value(std::move(array));
+    }
+
+    basic_shared_value erase(const key_type& key) const {
+        object_type object = this->object();
+        object.erase(key);
+        return basic_shared_value(std::move(object));
+    }
+
+    basic_shared_value set_in(std::initializer_list<step_type> path, basic_shared_value value) const {
+        return this->set_in(path.begin(), path.end(), std::move(value));
+    }
+
+    template<typename It>
+    basic_shared_value set_in(It first, It last, basic_shared_value value) const {
+        if (first == last) {
+            return value;
+        }
+
+        const step_type& step = *first;
+        if (const size_type* idx = std::get_if<size_type>(&step)) {
+            basic_shared_value child = this->contains(*idx) ? (*this)[*idx] : basic_shared_value{};
+            return this->set(*idx, child.set_in(std::next(first), last, std::move(value)));
+        }
+
+        key_type key(std::get<view_type>(step));
+        basic_shared_value child = this->contains(key) ? (*this)[key] : basic_shared_value{};
+        return this->set(key, child.set_in(std::next(first), last, std::move(value)));
+    }
+
+    value_type value(void) const {
+        value_type jvalue{};
+        switch (this->type()) {
+        case type_id::string:
+            jvalue.to_string() = this->string();
+            break;
+        case type_id::number:
+            jvalue.to_number() = this->number();
+            break;
+        case type_id::array:
+            jvalue.to_array().get().reserve(this->size());
+            for (const basic_shared_value& element : this->array()) {
+                jvalue.array().get().emplace_back(element.value());
+            }
+            break;
+        case type_id::object:
+            jvalue.to_object();
+            for (const auto& [key, element] : this->object()) {
+                jvalue.object()[key] = element.value();
+            }
+            break;
+        case type_id::boolean:
+            jvalue.to_boolean() = this->boolean();
+            break;
+        default:
+            break;
+        }
+        return jvalue;
+    }
+
+    const storage_type& get(void) const noexcept {
+        return _Value;
+    }
+
+private:
+    template<typename T, typename ... Args>
+    static std::shared_ptr<const T> make(Args&& ... args) {
+        return std::allocate_shared<T>(detail::rebind_alloc_t<T, Allocator>{}, std::forward<Args>(args)...);
+    }
+
+    storage_type _Value{ null_type{} };
+};
+
+template<typename Char, typename Traits, typename Allocator>
+inline basic_writer<Char, Traits>& operator<<(basic_writer<Char, Traits>& w, const basic_shared_value<Char, Traits, Allocator>& jvalue) {
+    switch (jvalue.type()) {
+    case type_id::null:    return (w << nullptr);
+    case type_id::string:  return (w << jvalue.string());
+    case type_id::number:  return (w << jvalue.number());
+    case type_id::array:   return (w << jvalue.array());
+    case type_id::object:  return (w << jvalue.object());
+    case type_id::boolean: return (w << jvalue.boolean());
+    default:
+        throw std::bad_typeid();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// PATH
+// ------
+//  Compiled JSON Pointer (RFC 6901) and JSONPath queries. A path is parsed once into a list of steps whose
+//  keys carry their hash, and can then be evaluated against any number of documents.
+//  Supported JSONPath subset: $ .name ['name'] [n] [*] .* and filters [?(@.a.b)] / [?(@.a.b op literal)] with
+//  op one of == != < <= > >= and literal a number, 'string', "string", true, false or null.
+//  match() yields the matches lazily as references into the document, find() returns the first one or nullptr.
+//  Both stay valid only as long as the document is not modified. Matching a const document does not unpack
+//  packed arrays: their elements are yielded as copies held by the iterator until it is advanced, and find()
+//  throws std::logic_error if its match is one of them. Matching a non-const document unpacks a packed array
+//  only when one of its elements is a match, filtering elements or passing over the array leaves it packed.
+//
+
+enum class path_step : unsigned char {
+    member   = 0,
+    index    = 1,
+    wildcard = 2,
+    filter   = 3
+};
+
+enum class path_compare : unsigned char {
+    exists        = 0,
+    equal         = 1,
+    not_equal     = 2,
+    less          = 3,
+    less_equal    = 4,
+    greater       = 5,
+    greater_equal = 6
+};
+
+template<typename JValue>
+class basic_path {
+public:
+    using json_type     = JValue;
+    using char_type     = typename JValue::char_type;
+    using traits_type   = typename JValue::traits_type;
+    using string_type   = std::basic_string<char_type, traits_type>;
+    using view_type     = std::basic_string_view<char_type, traits_type>;
+    using key_view_type = basic_key_view<char_type, traits_type>;
+    using size_type     = std::size_t;
+
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+    struct step {
+        path_step   kind{ path_step::member };
+        string_type name{};
+        std::size_t hash{ 0 };
+        size_type   index{ npos };
+        size_type   filter{ npos };
+    };
+
+    struct filter {
+        std::vector<step> path{};
+        path_compare      compare{ path_compare::exists };
+        JValue            literal{};
+    };
+
+    template<typename Value>
+    class match_iterator {
+    public:
+        using value_type        = std::remove_const_t<Value>;
+        using reference         = Value&;
+        using pointer           = Value*;
+        using difference_type   = std::ptrdiff_t;
+        using iterator_category = std::input_iterator_tag;
+
+        match_iterator(void) = default;
+
+        match_iterator(const basic_path& path, Value& root)
+            : _Path(&path)
+        {
+            _Stack.push_back({ &root, 0, 0 });
+            this->advance();
+        }
+
+        match_iterator(const match_iterator& other)
+            : _Path(other._Path)
+            , _Stack(other._Stack)
+            , _Current(other._Current)
+            , _Element(other._Element)
+        {
+            this->rebase(other);
+        }
+
+        match_iterator(match_iterator&& other)
+            : _Path(other._Path)
+            , _Stack(std::move(other._Stack))
+            , _Current(other._Current)
+            , _Element(std::move(other._Element))
+        {
+            this->rebase(other);
+        }
+
+        match_iterator& operator=(match_iterator other) {
+            _Path    = other._Path;
+            _Stack   = std::move(other._Stack);
+            _Current = other._Current;
+            _Element = std::move(other._Element);
+            this->rebase(other);
+            return *this;
+        }
+
+        reference operator*(void) const noexcept {
+            return *_Current;
+        }
+
+        pointer operator->(void) const noexcept {
+            return _Current;
+        }
+
+        match_iterator& operator++(void) {
+            this->advance();
+            return *this;
+        }
+
+        void operator++(int) {
+            this->advance();
+        }
+
+        friend bool operator==(const match_iterator& it, std::default_sentinel_t) noexcept {
+            return it._Current == nullptr;
+        }
+
+    private:
+        struct frame {
+            Value*    node{ nullptr };
+            size_type step{ 0 };
+            size_type child{ 0 };
+        };
+
+        void advance(void) {
+            _Current = nullptr;
+            while (!_Stack.empty()) {
+                frame& top = _Stack.back();
+                if (top.step == _Path->_Steps.size()) {
+                    _Current = top.node;
+                    _Stack.pop_back();
+                    return;
+                }
+
+                const step& current = _Path->_Steps[top.step];
+                size_type   next    = top.step + 1;
+
+                if (current.kind == path_step::member || current.kind == path_step::index) {
+                    Value* child = top.child == 0 ? basic_path::child(*top.node, current, &_Element) : nullptr;
+                    child = basic_path::settle(*top.node, child, current.index, &_Element, next == _Path->_Steps.size());
+                    top.child = 1;
+                    if (child == nullptr) {
+                        _Stack.pop_back();
+                        continue;
+                    }
+                    _Stack.push_back({ child, next, 0 });
+                    continue;
+                }
+
+                Value* child = nullptr;
+                size_type position = top.child;
+                while (child == nullptr && position < basic_path::children(*top.node)) {
+                    Value& candidate = basic_path::child_at(*top.node, position++, &_Element);
+                    if (current.kind == path_step::wildcard || _Path->accept(_Path->_Filters[current.filter], candidate)) {
+                        child = basic_path::settle(*top.node, &candidate, position - 1, &_Element, next == _Path->_Steps.size());
+                    }
+                }
+                top.child = position;
+
+                if (child == nullptr) {
+                    _Stack.pop_back();
+                    continue;
+                }
+                _Stack.push_back({ child, next, 0 });
+            }
+        }
+
+        friend class basic_path;
+
+        // Points what pointed to the element copy of other at the one of this iterator.
+        void rebase(const match_iterator& other) noexcept {
+            for (frame& f : _Stack) {
+                f.node = f.node == &other._Element ? &_Element : f.node;
+            }
+            _Current = _Current == &other._Element ? &_Element : _Current;
+        }
+
+        const basic_path*  _Path{ nullptr };
+        std::vector<frame> _Stack{};
+        Value*             _Current{ nullptr };
+        JValue             _Element{};
+    };
+
+    template<typename Value>
+    class match_range {
+    public:
+        match_range(const basic_path& path, Value& root)
+            : _Path(&path)
+            , _Root(&root)
+        {
+        }
+
+        match_iterator<Value> begin(void) const {
+            return match_iterator<Value>(*_Path, *_Root);
+        }
+
+        std::default_sentinel_t end(void) const noexcept {
+            return {};
+        }
+
+    private:
+        const basic_path* _Path{ nullptr };
+        Value*            _Root{ nullptr };
+    };
+
+    basic_path(void) = default;
+
+    // Compiles a JSON Pointer such as "/a/0/b~1c". Throws std::invalid_argument if it is malformed.
+    static basic_path pointer(view_type str) {
+        basic_path path{};
+        if (str.empty()) {
+            return path;
+        }
+        if (str.front() != char_type('/')) {
+            throw std::invalid_argument("JSON pointer must start with '/'");
+        }
+
+        size_type pos = 1;
+        while (true) {
+            size_type end = str.find(char_type('/'), pos);
+            view_type token = str.substr(pos, end == view_type::npos ? view_type::npos : end - pos);
+
+            string_type name{};
+            name.reserve(token.size());
+            for (size_type i = 0; i < token.size(); ++i) {
+                if (token[i] != char_type('~')) {
+                    name.push_back(token[i]);
+                    continue;
+                }
+                if (i + 1 == token.size() || (token[i + 1] != char_type('0') && token[i + 1] != char_type('1'))) {
+                    throw std::invalid_argument("Invalid escape in JSON pointer");
+                }
+                name.push_back(token[++i] == char_type('0') ? char_type('~') : char_type('/'));
+            }
+
+            path.push_member(std::move(name));
+            if (end == view_type::npos) {
+                break;
+            }
+            pos = end + 1;
+        }
+        return path;
+    }
+
+    // Compiles a JSONPath expression such as "$.items[*].name". Throws std::invalid_argument if it is malformed
+    // or uses anything outside the supported subset.
+    static basic_path parse(view_type str) {
+        basic_path path{};
+        size_type  pos = 0;
+
+        if (str.empty() || str.front() != char_type('$')) {
+            throw std::invalid_argument("JSONPath must start with '$'");
+        }
+        ++pos;
+
+        while (pos < str.size()) {
+            if (str[pos] == char_type('.')) {
+                ++pos;
+                if (pos < str.size() && str[pos] == char_type('*')) {
+                    path._Steps.push_back({ path_step::wildcard });
+                    ++pos;
+                    continue;
+                }
+                path._Steps.push_back(make_member(parse_name(str, pos), false));
+                continue;
+            }
+
+            if (str[pos] != char_type('[')) {
+                throw std::invalid_argument("Unexpected character in JSONPath");
+            }
+            ++pos;
+
+            if (pos < str.size() && str[pos] == char_type('*')) {
+                path._Steps.push_back({ path_step::wildcard });
+                ++pos;
+            }
+            else if (pos < str.size() && (str[pos] == char_type('\'') || str[pos] == char_type('"'))) {
+                path._Steps.push_back(make_member(parse_quoted(str, pos), false));
+            }
+            else if (pos < str.size() && str[pos] == char_type('?')) {
+                path._Steps.push_back({ path_step::filter, {}, 0, npos, path._Filters.size() });
+                path._Filters.push_back(parse_filter(str, ++pos));
+            }
+            else {
+                step index{ path_step::index };
+                index.index = parse_index(str, pos);
+                path._Steps.push_back(std::move(index));
+            }
+
+            expect(str, pos, char_type(']'));
+        }
+        return path;
+    }
+
+    match_range<JValue> match(JValue& root) const& {
+        return match_range<JValue>(*this, root);
+    }
+
+    match_range<const JValue> match(const JValue& root) const& {
+        return match_range<const JValue>(*this, root);
+    }
+
+    // The range refers to the path, matching through a temporary path would leave it dangling.
+    void match(const JValue& root) && = delete;
+
+    JValue* find(JValue& root) const {
+        auto it = match_iterator<JValue>(*this, root);
+        return it == std::default_sentinel ? nullptr : &(*it);
+    }
+
+    const JValue* find(const JValue& root) const {
+        auto it = match_iterator<const JValue>(*this, root);
+        if (it == std::default_sentinel) {
+            return nullptr;
+        }
+        if (&(*it) == &it._Element) {
+            throw std::logic_error("JSONPath match is an element of a packed array, use match()");
+        }
+        return &(*it);
+    }
+
+    // True if the path has no wildcard or filter steps and so matches at most one value.
+    bool singular(void) const noexcept {
+        for (const step& s : _Steps) {
+            if (s.kind == path_step::wildcard || s.kind == path_step::filter) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const std::vector<step>& steps(void) const noexcept {
+        return _Steps;
+    }
+
+    const std::vector<filter>& filters(void) const noexcept {
+        return _Filters;
+    }
+
+    // Resolves a single member or index step against node, nullptr if it does not exist. An element of a packed
+    // array reached through a const node is copied into element, see at().
+    template<typename Value>
+    static Value* child(Value& node, const step& s, JValue* element = nullptr) {
+        if (s.kind == path_step::member && node.is_object()) {
+            auto& object = node.object();
+            auto  it     = object.find(key_view_type(view_type(s.name), s.hash));
+            return it == object.end() ? nullptr : &it->second;
+        }
+        if (s.index != npos && node.is_array()) {
+            auto& array = node.array();
+            return s.index < array.size() ? basic_path::at(array, s.index, element) : nullptr;
+        }
+        return nullptr;
+    }
+
+    // Compares target with literal, a missing target only satisfies not_equal.
+    static bool test(const JValue* target, path_compare compare, const JValue& literal) {
+        if (target == nullptr) {
+            return compare == path_compare::not_equal;
+        }
+        if (compare == path_compare::exists) {
+            return true;
+        }
+
+        std::partial_ordering order = std::partial_ordering::unordered;
+        if (target->is_number() && literal.is_number()) {
+            order = target->number() <=> literal.number();
+        }
+        else if (target->is_string() && literal.is_string()) {
+            order = view_type(target->string()) <=> view_type(literal.string());
+        }
+        else if (target->is_boolean() && literal.is_boolean()) {
+            order = target->boolean() == literal.boolean() ? std::partial_ordering::equivalent : std::partial_ordering::unordered;
+        }
+        else if (target->is_null() && literal.is_null()) {
+            order = std::partial_ordering::equivalent;
+        }
+
+        switch (compare) {
+        case path_compare::equal:         return order == 0;
+        case path_compare::not_equal:     return order != 0;
+        case path_compare::less:          return order < 0;
+        case path_compare::less_equal:    return order <= 0;
+        case path_compare::greater:       return order > 0;
+        case path_compare::greater_equal: return order >= 0;
+        default:
+            break;
+        }
+        return false;
+    }
+
+protected:
+    template<typename Value>
+    static size_type children(Value& node) {
+        if (node.is_array()) {
+            return node.array().size();
+        }
+        if (node.is_object()) {
+            return node.object().size();
+        }
+        return 0;
+    }
+
+    template<typename Value>
+    static Value& child_at(Value& node, size_type position, JValue* element) {
+        if (node.is_array()) {
+            return *basic_path::at(node.array(), position, element);
+        }
+        return std::next(node.object().begin(), static_cast<std::ptrdiff_t>(position))->second;
+    }
+
+    // Elements of packed arrays are copied into element, the array stays packed. Without an element the
+    // array is referenced in place, which unpacks it if it is not const and throws std::logic_error if it is.
+    template<typename Array>
+    static auto* at(Array& array, size_type position, JValue* element) {
+        using pointer = std::conditional_t<std::is_const_v<Array>, const JValue*, JValue*>;
+        if (array.packed() && element != nullptr) {
+            *element = array.element(position);
+            return static_cast<pointer>(element);
+        }
+        return static_cast<pointer>(&array[position]);
+    }
+
+    // A non-const match has to be a reference into the document, so an element copied out of a packed array
+    // is resolved again in place, unpacking the array, once it turns out to be a match. Copies passed on to
+    // later steps are scalars that those cannot match anything in, const matches stay copies.
+    template<typename Value>
+    static Value* settle(Value& node, Value* child, size_type position, const JValue* element, bool last) {
+        if constexpr (!std::is_const_v<Value>) {
+            if (child == element && child != nullptr) {
+                return last ? &node.array()[position] : nullptr;
+            }
+        }
+        return child;
+    }
+
+    template<typename Value>
+    bool accept(const filter& f, Value& candidate) const {
+        const JValue* target = &candidate;
+        JValue        element{};
+        for (const step& s : f.path) {
+            target = basic_path::child(*target, s, &element);
+            if (target == nullptr) {
+                break;
+            }
+        }
+        return basic_path::test(target, f.compare, f.literal);
+    }
+
+    void push_member(string_type&& name) {
+        _Steps.push_back(make_member(std::move(name), true));
+    }
+
+    // Pointer tokens address array elements as well when they are a plain decimal index.
+    static step make_member(string_type&& name, bool numeric) {
+        step s{ path_step::member };
+        s.hash = detail::hash_chars(view_type(name));
+        if (numeric && !name.empty() && (name.size() == 1 || name.front() != char_type('0'))) {
+            size_type index = 0;
+            bool      valid = true;
+            for (char_type ch : name) {
+                valid = valid && ch >= char_type('0') && ch <= char_type('9');
+                index = index * 10 + static_cast<size_type>(ch - char_type('0'));
+            }
+            s.index = valid ? index : npos;
+        }
+        s.name = std::move(name);
+        return s;
+    }
+
+    static bool is_name_char(char_type ch) noexcept {
+        return ch != char_type('.') && ch != char_type('[') && ch != char_type(']') && ch != char_type(' ') &&
+               ch != char_type('=') && ch != char_type('!') && ch != char_type('<') && ch != char_type('>') && ch != char_type(')');
+    }
+
+    static string_type parse_name(view_type str, size_type& pos) {
+        size_type first = pos;
+        while (pos < str.size() && is_name_char(str[pos])) {
+            ++pos;
+        }
+        if (first == pos) {
+            throw std::invalid_argument("Empty member name in JSONPath");
+        }
+        return string_type(str.substr(first, pos - first));
+    }
+
+    static string_type parse_quoted(view_type str, size_type& pos) {
+        char_type   quote = str[pos++];
+        string_type name{};
+        while (pos < str.size() && str[pos] != quote) {
+            if (str[pos] == char_type('\\') && pos + 1 < str.size()) {
+                ++pos;
+            }
+            name.push_back(str[pos++]);
+        }
+        expect(str, pos, quote);
+        return name;
+    }
+
+    static size_type parse_index(view_type str, size_type& pos) {
+        size_type first = pos;
+        size_type index = 0;
+        while (pos < str.size() && str[pos] >= char_type('0') && str[pos] <= char_type('9')) {
+            index = index * 10 + static_cast<size_type>(str[pos++] - char_type('0'));
+        }
+        if (first == pos) {
+            throw std::invalid_argument("Expected an array index in JSONPath");
+        }
+        return index;
+    }
+
+    static void skip_space(view_type str, size_type& pos) {
+        while (pos < str.size() && str[pos] == char_type(' ')) {
+            ++pos;
+        }
+    }
+
+    static void expect(view_type str, size_type& pos, char_type ch) {
+        if (pos >= str.size() || str[pos] != ch) {
+            throw std::invalid_argument("Malformed JSONPath");
+        }
+        ++pos;
+    }
+
+    static filter parse_filter(view_type str, size_type& pos) {
+        filter f{};
+        expect(str, pos, char_type('('));
+        skip_space(str, pos);
+        expect(str, pos, char_type('@'));
+
+        while (pos < str.size() && (str[pos] == char_type('.') || str[pos] == char_type('['))) {
+            if (str[pos++] == char_type('.')) {
+                f.path.push_back(make_member(parse_name(str, pos), false));
+                continue;
+            }
+            f.path.push_back(make_member(parse_quoted(str, pos), false));
+            expect(str, pos, char_type(']'));
+        }
+
+        skip_space(str, pos);
+        if (pos < str.size() && str[pos] != char_type(')')) {
+            f.compare = parse_compare(str, pos);
+            skip_space(str, pos);
+            f.literal = parse_literal(str, pos);
+            skip_space(str, pos);
+        }
+        expect(str, pos, char_type(')'));
+        return f;
+    }
+
+    static path_compare parse_compare(view_type str, size_type& pos) {
+        auto next_is = [&](char_type ch) {
+            if (pos < str.size() && str[pos] == ch) {
+                ++pos;
+                return true;
+            }
+            return false;
+        };
+
+        if (next_is(char_type('='))) {
+            expect(str, pos, char_type('='));
+            return path_compare::equal;
+        }
+        if (next_is(char_type('!'))) {
+            expect(str, pos, char_type('='));
+            return path_compare::not_equal;
+        }
+        if (next_is(char_type('<'))) {
+            return next_is(char_type('=')) ? path_compare::less_equal : path_compare::less;
+        }
+        if (next_is(char_type('>'))) {
+            return next_is(char_type('=')) ? path_compare::greater_equal : path_compare::greater;
+        }
+        throw std::invalid_argument("Unknown comparison in JSONPath filter");
+    }
+
+    static JValue parse_literal(view_type str, size_type& pos) {
+        JValue literal{};
+        if (pos < str.size() && (str[pos] == char_type('\'') || str[pos] == char_type('"'))) {
+            literal << parse_quoted(str, pos);
+            return literal;
+        }
+
+        size_type first = pos;
+        while (pos < str.size() && str[pos] != char_type(' ') && str[pos] != char_type(')')) {
+            ++pos;
+        }
+
+        std::string token{};
+        for (char_type ch : str.substr(first, pos - first)) {
+            token.push_back(static_cast<char>(ch));
+        }
+
+        if (token == "true" || token == "false") {
+            literal << (token == "true");
+            return literal;
+        }
+        if (token == "null") {
+            return literal;
+        }
+
+        // Integers are kept exact, so that literals above 2^53 compare like the numbers read by a reader.
+        const char* last = token.data() + token.size();
+        std::int64_t integer{};
+        if (auto [end, ec] = std::from_chars(token.data(), last, integer); !token.empty() && ec == std::errc{} && end == last) {
+            literal << integer;
+            return literal;
+        }
+        std::uint64_t unsigned_integer{};
+        if (auto [end, ec] = std::from_chars(token.data(), last, unsigned_integer); !token.empty() && ec == std::errc{} && end == last) {
+            literal << unsigned_integer;
+            return literal;
+        }
+        double number{};
+        auto [end, ec] = std::from_chars(token.data(), last, number);
+        if (token.empty() || ec != std::errc{} || end != last) {
+            throw std::invalid_argument("Invalid literal in JSONPath filter");
+        }
+        literal << number;
+        return literal;
+    }
+
+    std::vector<step>   _Steps{};
+    std::vector<filter> _Filters{};
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// PATCH
+// -------
+//  RFC 6902 JSON Patch and RFC 7396 JSON Merge Patch applied in place. Values are moved into and out of the
+//  document, untouched subtrees are never copied.
+//  A transaction records an undo entry for every operation it applies and rolls all of them back if it is
+//  destroyed without commit(), so any number of patches can be applied atomically.
+//
+
+enum class patch_op : unsigned char {
+    add     = 0,
+    remove  = 1,
+    replace = 2,
+    move    = 3,
+    copy    = 4,
+    test    = 5
+};
+
+template<typename JValue>
+class basic_patch {
+public:
+    using json_type     = JValue;
+    using path_type     = basic_path<JValue>;
+    using step_type     = typename path_type::step;
+    using char_type     = typename path_type::char_type;
+    using string_type   = typename path_type::string_type;
+    using view_type     = typename path_type::view_type;
+    using key_view_type = typename path_type::key_view_type;
+    using size_type     = typename path_type::size_type;
+
+    struct operation {
+        patch_op    op{ patch_op::add };
+        string_type path{};
+        string_type from{};
+        JValue      value{};
+        path_type   target{};
+        path_type   source{};
+    };
+
+    class transaction {
+    public:
+        explicit transaction(JValue& document) noexcept
+            : _Document(document)
+        {
+        }
+
+        transaction(const transaction&) = delete;
+        transaction& operator=(const transaction&) = delete;
+
+        ~transaction() {
+            try {
+                this->rollback();
+            }
+            catch (...) {
+                // Rolling back only moves values back into place, it can only fail when out of memory.
+            }
+        }
+
+        // Applies patch, throws std::out_of_range for a missing path, std::invalid_argument for an invalid
+        // operation and std::domain_error for a failed test. Already applied operations stay recorded.
+        transaction& apply(const basic_patch& patch) {
+            for (const operation& op : patch._Operations) {
+                this->execute(op, op.op == patch_op::add || op.op == patch_op::replace ? JValue(op.value) : JValue{});
+            }
+            return *this;
+        }
+
+        transaction& apply(basic_patch&& patch) {
+            for (operation& op : patch._Operations) {
+                this->execute(op, std::move(op.value));
+            }
+            return *this;
+        }
+
+        void commit(void) noexcept {
+            _Undo.clear();
+        }
+
+        void rollback(void) {
+            JValue carry{};
+            while (!_Undo.empty()) {
+                undo_entry& entry = _Undo.back();
+                switch (entry.kind) {
+                case undo_kind::restore:
+                    carry = std::exchange(basic_patch::resolve(_Document, entry.steps, entry.steps.size()), std::move(entry.value));
+                    break;
+                case undo_kind::erase:
+                    carry = basic_patch::take(_Document, entry.steps).first;
+                    break;
+                case undo_kind::insert:
+                    basic_patch::place(_Document, entry.steps, entry.carry ? std::move(carry) : std::move(entry.value), entry.position);
+                    break;
+                }
+                _Undo.pop_back();
+            }
+        }
+
+    private:
+        enum class undo_kind : unsigned char {
+            restore,
+            erase,
+            insert
+        };
+
+        // insert entries with carry set put back the value the previous undo step took out.
+        struct undo_entry {
+            undo_kind              kind{ undo_kind::restore };
+            std::vector<step_type> steps{};
+            size_type              position{ 0 };
+            bool                   carry{ false };
+            JValue                 value{};
+        };
+
+        void execute(const operation& op, JValue&& value) {
+            const auto& path = op.target.steps();
+            const auto& from = op.source.steps();
+
+            switch (op.op) {
+            case patch_op::add:
+                this->add(path, std::move(value));
+                break;
+            case patch_op::remove: {
+                auto [removed, position] = basic_patch::take(_Document, path);
+                _Undo.push_back({ undo_kind::insert, path, position, false, std::move(removed) });
+                break;
+            }
+            case patch_op::replace: {
+                JValue& target = basic_patch::resolve(_Document, path, path.size());
+                _Undo.push_back({ undo_kind::restore, path, 0, false, std::exchange(target, std::move(value)) });
+                break;
+            }
+            case patch_op::move: {
+                if (from.size() < path.size() && std::equal(from.begin(), from.end(), path.begin(), [](const step_type& lhs, const step_type& rhs) { return lhs.name == rhs.name; })) {
+                    throw std::invalid_argument("JSON patch cannot move a value into itself");
+                }
+                // The undo entry holds the value until add() succeeds, so a failing add() still puts it back.
+                auto [moved, position] = basic_patch::take(_Document, from);
+                _Undo.push_back({ undo_kind::insert, from, position, false, std::move(moved) });
+                size_type entry = _Undo.size() - 1;
+                this->add(path, std::move(_Undo[entry].value));
+                _Undo[entry].carry = true;
+                _Undo[entry].value = JValue{};
+                break;
+            }
+            case patch_op::copy:
+                this->add(path, JValue(basic_patch::resolve(_Document, from, from.size())));
+                break;
+            case patch_op::test:
+                if (!(basic_patch::resolve(_Document, path, path.size()) == op.value)) {
+                    throw std::domain_error("JSON patch test failed");
+                }
+                break;
+            }
+        }
+
+        void add(const std::vector<step_type>& path, JValue&& value) {
+            if (path.empty()) {
+                _Undo.push_back({ undo_kind::restore, path, 0, false, std::exchange(_Document, std::move(value)) });
+                return;
+            }
+
+            JValue&          parent = basic_patch::resolve(_Document, path, path.size() - 1);
+            const step_type& last   = path.back();
+
+            if (parent.is_object()) {
+                auto& object = parent.object();
+                auto  it     = object.find(key_view_type(view_type(last.name), last.hash));
+                if (it != object.end()) {
+                    _Undo.push_back({ undo_kind::restore, path, 0, false, std::exchange(it->second, std::move(value)) });
+                    return;
+                }
+                object[key_view_type(view_type(last.name), last.hash)] = std::move(value);
+                _Undo.push_back({ undo_kind::erase, path });
+                return;
+            }
+
+            if (parent.is_array()) {
+                auto&     array = parent.array().get();
+                size_type index = basic_patch::is_append(last) ? array.size() : last.index;
+                if (index == path_type::npos || index > array.size()) {
+                    throw std::out_of_range("JSON patch index out of range");
+                }
+                array.insert(array.begin() + static_cast<std::ptrdiff_t>(index), std::move(value));
+
+                _Undo.push_back({ undo_kind::erase, path });
+                _Undo.back().steps.back().index = index;
+                return;
+            }
+
+            throw std::out_of_range("JSON patch path not found");
+        }
+
+        JValue&                 _Document;
+        std::vector<undo_entry> _Undo{};
+    };
+
+    basic_patch(void) = default;
+
+    basic_patch& add(view_type path, JValue value) {
+        return this->push(patch_op::add, path, {}, std::move(value));
+    }
+
+    basic_patch& remove(view_type path) {
+        return this->push(patch_op::remove, path, {}, {});
+    }
+
+    basic_patch& replace(view_type path, JValue value) {
+        return this->push(patch_op::replace, path, {}, std::move(value));
+    }
+
+    basic_patch& move(view_type from, view_type path) {
+        return this->push(patch_op::move, path, from, {});
+    }
+
+    basic_patch& copy(view_type from, view_type path) {
+        return this->push(patch_op::copy, path, from, {});
+    }
+
+    basic_patch& test(view_type path, JValue value) {
+        return this->push(patch_op::test, path, {}, std::move(value));
+    }
+
+    // Applies all operations or none of them, see transaction::apply for the exceptions thrown.
+    void apply(JValue& document) const& {
+        transaction t(document);
+        t.apply(*this);
+        t.commit();
+    }
+
+    // Moves the operation values into the document instead of copying them.
+    void apply(JValue& document) && {
+        transaction t(document);
+        t.apply(std::move(*this));
+        t.commit();
+    }
+
+    const std::vector<operation>& operations(void) const noexcept {
+        return _Operations;
+    }
+
+    size_type size(void) const noexcept {
+        return _Operations.size();
+    }
+
+    bool empty(void) const noexcept {
+        return _Operations.empty();
+    }
+
+    // Reads a patch document, an array of operation objects. Throws std::invalid_argument if it is malformed.
+    static basic_patch parse(const JValue& document) {
+        if (!document.is_array()) {
+            throw std::invalid_argument("JSON patch must be an array");
+        }
+
+        basic_patch patch{};
+        for (const JValue& entry : document.array()) {
+            if (!entry.is_object()) {
+                throw std::invalid_argument("JSON patch operation must be an object");
+            }
+
+            const auto& object = entry.object();
+            auto member = [&](const char* name) -> const JValue* {
+                auto it = object.find(view_type(widen(name)));
+                return it == object.end() ? nullptr : &it->second;
+            };
+            auto text = [&](const char* name) -> string_type {
+                const JValue* found = member(name);
+                if (found == nullptr || !found->is_string()) {
+                    throw std::invalid_argument("JSON patch operation is missing a member");
+                }
+                return string_type(found->string());
+            };
+
+            string_type op   = text("op");
+            string_type path = text("path");
+
+            if (op == widen("add") || op == widen("replace") || op == widen("test")) {
+                const JValue* value = member("value");
+                if (value == nullptr) {
+                    throw std::invalid_argument("JSON patch operation is missing a member");
+                }
+                patch_op kind = op == widen("add") ? patch_op::add : op == widen("replace") ? patch_op::replace : patch_op::test;
+                patch.push(kind, path, {}, *value);
+            }
+            else if (op == widen("remove")) {
+                patch.push(patch_op::remove, path, {}, {});
+            }
+            else if (op == widen("move") || op == widen("copy")) {
+                patch.push(op == widen("move") ? patch_op::move : patch_op::copy, path, text("from"), {});
+            }
+            else {
+                throw std::invalid_argument("Unknown JSON patch operation");
+            }
+        }
+        return patch;
+    }
+
+    JValue to_value(void) const {
+        static constexpr const char* names[] = { "add", "remove", "replace", "move", "copy", "test" };
+
+        JValue document{};
+        auto&  array = document.to_array().get();
+        array.reserve(_Operations.size());
+        for (const operation& op : _Operations) {
+            auto& object = array.emplace_back().to_object();
+            object[widen("op")] << widen(names[static_cast<std::size_t>(op.op)]);
+            object[widen("path")] << op.path;
+            if (op.op == patch_op::move || op.op == patch_op::copy) {
+                object[widen("from")] << op.from;
+            }
+            if (op.op == patch_op::add || op.op == patch_op::replace || op.op == patch_op::test) {
+                object[widen("value")] = op.value;
+            }
+        }
+        return document;
+    }
+
+    // Generates a patch that turns from into to. Changed scalars and values of different types are replaced,
+    // arrays are patched element by element and trimmed or extended at the end. Arrays and objects with different
+    // hashes are descended into without comparing them, equal hashes are confirmed with operator== before the
+    // subtree is skipped. The hashes are cached so each subtree is hashed once.
+    static basic_patch diff(const JValue& from, const JValue& to) {
+        basic_patch patch{};
+        string_type path{};
+        patch.diff(from, to, path);
+        return patch;
+    }
+
+protected:
+    basic_patch& push(patch_op op, view_type path, view_type from, JValue value) {
+        operation entry{ op, string_type(path), string_type(from), std::move(value) };
+        entry.target = path_type::pointer(entry.path);
+        entry.source = path_type::pointer(entry.from);
+        _Operations.push_back(std::move(entry));
+        return *this;
+    }
+
+    void diff(const JValue& from, const JValue& to, string_type& path) {
+        bool containers = (from.is_array() && to.is_array()) || (from.is_object() && to.is_object());
+        if ((!containers || from.hash() == to.hash()) && from == to) {
+            return;
+        }
+
+        if (from.is_object() && to.is_object()) {
+            const auto& lhs = from.object();
+            const auto& rhs = to.object();
+            for (const auto& [key, value] : lhs) {
+                if (rhs.find(key) == rhs.end()) {
+                    this->remove(extend(path, key));
+                }
+            }
+            for (const auto& [key, value] : rhs) {
+                auto it = lhs.find(key);
+                if (it == lhs.end()) {
+                    this->add(extend(path, key), value);
+                    continue;
+                }
+                string_type child = extend(path, key);
+                this->diff(it->second, value, child);
+            }
+            return;
+        }
+
+        if (from.is_array() && to.is_array()) {
+            const auto& lhs    = from.array();
+            const auto& rhs    = to.array();
+            size_type   common = std::min(lhs.size(), rhs.size());
+            for (size_type i = 0; i < common; ++i) {
+                string_type child = extend(path, index_name(i));
+                if (lhs.packed() || rhs.packed()) {
+                    // Packed elements are scalars, copying them out is cheap.
+                    this->diff(lhs.element(i), rhs.element(i), child);
+                }
+                else {
+                    this->diff(lhs.get()[i], rhs.get()[i], child);
+                }
+            }
+            for (size_type i = lhs.size(); i > common; --i) {
+                this->remove(extend(path, index_name(i - 1)));
+            }
+            for (size_type i = common; i < rhs.size(); ++i) {
+                this->add(extend(path, widen("-")), rhs.element(i));
+            }
+            return;
+        }
+
+        this->replace(path, to);
+    }
+
+    static string_type widen(const char* str) {
+        string_type result{};
+        for (; *str != '\0'; ++str) {
+            result.push_back(static_cast<char_type>(*str));
+        }
+        return result;
+    }
+
+    static string_type index_name(size_type index) {
+        return widen(std::to_string(index).c_str());
+    }
+
+    static string_type extend(const string_type& path, view_type token) {
+        string_type result = path;
+        result.push_back(char_type('/'));
+        for (char_type ch : token) {
+            if (ch == char_type('~')) {
+                result.push_back(char_type('~'));
+                result.push_back(char_type('0'));
+            }
+            else if (ch == char_type('/')) {
+                result.push_back(char_type('~'));
+                result.push_back(char_type('1'));
+            }
+            else {
+                result.push_back(ch);
+            }
+        }
+        return result;
+    }
+
+    static bool is_append(const step_type& s) noexcept {
+        return s.name.size() == 1 && s.name.front() == char_type('-');
+    }
+
+    static JValue& resolve(JValue& document, const std::vector<step_type>& steps, size_type count) {
+        JValue* node = &document;
+        for (size_type i = 0; i < count; ++i) {
+            node = path_type::child(*node, steps[i]);
+            if (node == nullptr) {
+                throw std::out_of_range("JSON patch path not found");
+            }
+        }
+        return *node;
+    }
+
+    // Removes the value at steps, returning it together with its position in the parent.
+    static std::pair<JValue, size_type> take(JValue& document, const std::vector<step_type>& steps) {
+        if (steps.empty()) {
+            throw std::invalid_argument("JSON patch cannot remove the document root");
+        }
+
+        JValue&          parent = resolve(document, steps, steps.size() - 1);
+        const step_type& last   = steps.back();
+
+        if (parent.is_object()) {
+            auto& object = parent.object().get();
+            auto  it     = object.find(key_view_type(view_type(last.name), last.hash));
+            if (it == object.end()) {
+                throw std::out_of_range("JSON patch path not found");
+            }
+            std::pair<JValue, size_type> result{ std::move(it->second), static_cast<size_type>(it - object.begin()) };
+            object.erase(it);
+            return result;
+        }
+
+        if (parent.is_array() && last.index < parent.array().size()) {
+            auto& array = parent.array().get();
+            auto  it    = array.begin() + static_cast<std::ptrdiff_t>(last.index);
+            std::pair<JValue, size_type> result{ std::move(*it), last.index };
+            array.erase(it);
+            return result;
+        }
+
+        throw std::out_of_range("JSON patch path not found");
+    }
+
+    // Puts value back at position of the parent of steps, the inverse of take.
+    static void place(JValue& document, const std::vector<step_type>& steps, JValue&& value, size_type position) {
+        JValue&          parent = resolve(document, steps, steps.size() - 1);
+        const step_type& last   = steps.back();
+
+        if (parent.is_object()) {
+            auto& object = parent.object().get();
+            object.insert(object.begin() + static_cast<std::ptrdiff_t>(position), { typename JValue::key_type(key_view_type(view_type(last.name), last.hash)), std::move(value) });
+            return;
+        }
+        auto& array = parent.array().get();
+        array.insert(array.begin() + static_cast<std::ptrdiff_t>(position), std::move(value));
+    }
+
+    std::vector<operation> _Operations{};
+};
+
+// Applies the patches in [first, last) as one unit, the document is left untouched if any of them fails.
+template<typename JValue, typename Iterator>
+inline void apply_patches(JValue& document, Iterator first, Iterator last) {
+    typename basic_patch<JValue>::transaction t(document);
+    for (; first != last; ++first) {
+        t.apply(*first);
+    }
+    t.commit();
+}
+
+// RFC 7396: members of patch replace those of target, null members remove them.
+template<typename JValue>
+inline void merge_patch(JValue& target, const JValue& patch) {
+    if (!patch.is_object()) {
+        target = patch;
+        return;
+    }
+
+    auto& object = target.to_object();
+    for (const auto& [key, value] : patch.object()) {
+        if (value.is_null()) {
+            object.get().erase(key);
+            continue;
+        }
+        merge_patch(object[key], value);
+    }
+}
+
+// Moves the members of patch into target instead of copying them.
+template<typename JValue>
+inline void merge_patch(JValue& target, JValue&& patch) {
+    if (!patch.is_object()) {
+        target = std::move(patch);
+        return;
+    }
+
+    auto& object = target.to_object();
+    for (auto& [key, value] : patch.object()) {
+        if (value.is_null()) {
+            object.get().erase(key);
+            continue;
+        }
+        merge_patch(object[key], std::move(value));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// PROJECTION
+// ------------
+//  Streaming select/filter stage over JSON Lines. Selections and predicates are JSON Pointers, merged into a
+//  trie of member names. Every record is read token by token: members outside the trie are skipped without
+//  being built, only values at the end of a selected path (or under an array on the way there) are read into
+//  json values. Records passing all predicates are written as objects holding the selected members, missing
+//  ones as null, one record per line.
+//
+
+template<typename JValue>
+class basic_projection {
+public:
+    using json_type   = JValue;
+    using path_type   = basic_path<JValue>;
+    using step_type   = typename path_type::step;
+    using char_type   = typename path_type::char_type;
+    using traits_type = typename path_type::traits_type;
+    using string_type = typename path_type::string_type;
+    using view_type   = typename path_type::view_type;
+    using reader_type = basic_reader<char_type, traits_type>;
+    using writer_type = basic_writer<char_type, traits_type>;
+    using size_type   = std::size_t;
+
+    basic_projection(void) {
+        _Nodes.emplace_back();
+    }
+
+    // Selects the value at pointer, written under the last token of pointer.
+    basic_projection& select(view_type pointer) {
+        path_type path = path_type::pointer(pointer);
+        string_type name = path.steps().empty() ? string_type{} : path.steps().back().name;
+        return this->select(name, pointer);
+    }
+
+    // Selects the value at pointer, written under name.
+    basic_projection& select(view_type name, view_type pointer) {
+        _Selections.push_back({ string_type(name), this->insert(path_type::pointer(pointer)) });
+        return *this;
+    }
+
+    // Keeps only the records whose value at pointer compares to literal as given, see basic_path::test.
+    basic_projection& where(view_type pointer, path_compare compare, JValue literal = {}) {
+        _Predicates.push_back({ this->insert(path_type::pointer(pointer)), compare, std::move(literal) });
+        return *this;
+    }
+
+    // Reads one record and writes its projection if it passes the predicates, returns whether it was written.
+    bool project(reader_type& r, writer_type& w) {
+        _Present.assign(_Nodes.size(), false);
+        if (!this->stream(r, 0)) {
+            return false;
+        }
+
+        for (const predicate& p : _Predicates) {
+            if (!path_type::test(this->resolve(_Paths[p.path]), p.compare, p.literal)) {
+                return false;
+            }
+        }
+
+        w.object(_Selections.begin(), _Selections.end(), [this](const selection& s) {
+            const JValue* value = this->resolve(_Paths[s.path]);
+            return std::pair<view_type, const JValue&>(view_type(s.name), value ? *value : _Null);
+        });
+        w.newline();
+        return static_cast<bool>(w);
+    }
+
+    // Projects records until the input ends or is malformed, returns the number of records written.
+    size_type run(reader_type& r, writer_type& w) {
+        size_type written = 0;
+        while (r && r.type() != type_id::invalid) {
+            if (this->project(r, w)) {
+                ++written;
+            }
+        }
+        return written;
+    }
+
+protected:
+    struct node {
+        string_type            name{};
+        std::vector<size_type> children{};
+        bool                   terminal{ false };
+    };
+
+    struct route {
+        std::vector<step_type> steps{};
+        std::vector<size_type> nodes{};
+    };
+
+    struct selection {
+        string_type name{};
+        size_type   path{ 0 };
+    };
+
+    struct predicate {
+        size_type    path{ 0 };
+        path_compare compare{ path_compare::exists };
+        JValue       literal{};
+    };
+
+    size_type insert(const path_type& path) {
+        route r{ path.steps(), { 0 } };
+        size_type current = 0;
+        for (const step_type& s : r.steps) {
+            size_type next = this->find(current, view_type(s.name));
+            if (next == _Nodes.size()) {
+                _Nodes.push_back({ s.name });
+                _Nodes[current].children.push_back(next);
+            }
+            current = next;
+            r.nodes.push_back(current);
+        }
+        _Nodes[current].terminal = true;
+        _Paths.push_back(std::move(r));
+        _Values.resize(_Nodes.size());
+        return _Paths.size() - 1;
+    }
+
+    size_type find(size_type parent, view_type name) const noexcept {
+        for (size_type child : _Nodes[parent].children) {
+            if (view_type(_Nodes[child].name) == name) {
+                return child;
+            }
+        }
+        return _Nodes.size();
+    }
+
+    bool stream(reader_type& r, size_type n) {
+        type_id type = r.type();
+        if (_Nodes[n].terminal || (type == type_id::array && !_Nodes[n].children.empty())) {
+            JValue& value = _Values[n];
+            r >> value;
+            _Present[n] = true;
+            return static_cast<bool>(r);
+        }
+        if (type != type_id::object || _Nodes[n].children.empty()) {
+            return r.skip();
+        }
+
+        if (!r.expect(char_type('{'))) {
+            return false;
+        }
+        if (r.consume(char_type('}'))) {
+            return true;
+        }
+        do {
+            r >> _Key;
+            if (!r.expect(char_type(':'))) {
+                return false;
+            }
+            size_type child = this->find(n, view_type(_Key));
+            if (child == _Nodes.size() ? !r.skip() : !this->stream(r, child)) {
+                return false;
+            }
+        } while (r.consume(char_type(',')));
+        return r.expect(char_type('}'));
+    }
+
+    // The first materialized node along the path holds the value, the remaining steps are resolved inside it.
+    JValue* resolve(const route& path) {
+        for (size_type i = 0; i < path.nodes.size(); ++i) {
+            if (!_Present[path.nodes[i]]) {
+                continue;
+            }
+            JValue* value = &_Values[path.nodes[i]];
+            for (size_type j = i; j < path.steps.size() && value != nullptr; ++j) {
+                value = path_type::child(*value, path.steps[j]);
+            }
+            return value;
+        }
+        return nullptr;
+    }
+
+    std::vector<node>      _Nodes{};
+    std::vector<route>     _Paths{};
+    std::vector<selection> _Selections{};
+    std::vector<predicate> _Predicates{};
+    std::vector<JValue>    _Values{};
+    std::vector<bool>      _Present{};
+    string_type            _Key{};
+    JValue                 _Null{};
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// SCHEMA
+// --------
+//  JSON Schema (draft 2020-12) compiled into a flat list of nodes, one per (sub)schema, that refer to each
+//  other by index. Supported keywords: type, enum, const, properties, required, additionalProperties, items,
+//  minimum, maximum, exclusiveMinimum, exclusiveMaximum, minLength, maxLength, pattern, minItems, maxItems and
+//  boolean schemas. Annotations are ignored, other applicators such as $ref or allOf are rejected when compiling.
+//  Besides a value, a schema validates straight from a reader, stopping at the first violation. Members and
+//  elements that no keyword looks at are skipped without being built, unless the value is read as well.
+//  Malformed input fails the reader instead of reporting a violation.
+//
+
+template<typename JValue>
+class basic_schema {
+public:
+    using json_type   = JValue;
+    using char_type   = typename JValue::char_type;
+    using traits_type = typename JValue::traits_type;
+    using string_type = std::basic_string<char_type, traits_type>;
+    using view_type   = std::basic_string_view<char_type, traits_type>;
+    using number_type = typename JValue::number_type;
+    using reader_type = basic_reader<char_type, traits_type>;
+    using size_type   = std::size_t;
+
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+    struct violation {
+        string_type pointer{};
+        std::string keyword{};
+    };
+
+    // Accepts every value.
+    basic_schema(void) {
+        _Nodes.emplace_back();
+    }
+
+    // Throws std::invalid_argument if schema is malformed or uses unsupported keywords.
+    static basic_schema compile(const JValue& schema) {
+        basic_schema result{};
+        result._Nodes.clear();
+        result.compile_node(schema);
+        return result;
+    }
+
+    std::optional<violation> validate(const JValue& value) const {
+        string_type pointer{};
+        return this->check(0, value, pointer);
+    }
+
+    // Validates the next value of r without building it.
+    std::optional<violation> validate(reader_type& r) const {
+        string_type pointer{};
+        return this->stream(r, 0, nullptr, pointer);
+    }
+
+    // Reads the next value of r into value while validating it. On a violation the rest of the value is not read.
+    std::optional<violation> read(reader_type& r, JValue& value) const {
+        string_type pointer{};
+        return this->stream(r, 0, &value, pointer);
+    }
+
+    size_type size(void) const noexcept {
+        return _Nodes.size();
+    }
+
+protected:
+    static constexpr unsigned null_bit     = 1 << 0;
+    static constexpr unsigned boolean_bit  = 1 << 1;
+    static constexpr unsigned object_bit   = 1 << 2;
+    static constexpr unsigned array_bit    = 1 << 3;
+    static constexpr unsigned number_bit   = 1 << 4;
+    static constexpr unsigned string_bit   = 1 << 5;
+    static constexpr unsigned integer_bit  = 1 << 6;
+    static constexpr unsigned any_bits     = 0x7f;
+
+    static constexpr bool has_regex = std::same_as<char_type, char> || std::same_as<char_type, wchar_t>;
+    using regex_type = std::conditional_t<has_regex, std::basic_regex<std::conditional_t<has_regex, char_type, char>>, std::monostate>;
+
+    struct property {
+        string_type name{};
+        size_type   node{ npos };
+    };
+
+    struct node {
+        bool                       reject{ false };
+        unsigned                   types{ any_bits };
+        std::vector<property>      properties{};
+        size_type                  additional{ npos };
+        std::vector<string_type>   required{};
+        size_type                  items{ npos };
+        std::optional<JValue>      constant{};
+        std::optional<std::vector<JValue>> values{};
+        std::optional<number_type> minimum{};
+        std::optional<number_type> maximum{};
+        std::optional<number_type> exclusive_minimum{};
+        std::optional<number_type> exclusive_maximum{};
+        size_type                  min_length{ 0 };
+        size_type                  max_length{ npos };
+        size_type                  min_items{ 0 };
+        size_type                  max_items{ npos };
+        std::optional<regex_type>  pattern{};
+    };
+
+    //
+    // Compiling
+    //
+
+    static void require(bool condition, const char* message) {
+        if (!condition) {
+            throw std::invalid_argument(message);
+        }
+    }
+
+    static bool keyword(view_type key, const char* name) {
+        size_type i = 0;
+        for (; i < key.size() && name[i] != '\0'; ++i) {
+            if (key[i] != char_type(name[i])) {
+                return false;
+            }
+        }
+        return i == key.size() && name[i] == '\0';
+    }
+
+    static unsigned type_bit(view_type name) {
+        if (keyword(name, "null"))    return null_bit;
+        if (keyword(name, "boolean")) return boolean_bit;
+        if (keyword(name, "object"))  return object_bit;
+        if (keyword(name, "array"))   return array_bit;
+        if (keyword(name, "number"))  return number_bit | integer_bit;
+        if (keyword(name, "string"))  return string_bit;
+        if (keyword(name, "integer")) return integer_bit;
+        throw std::invalid_argument("Unknown type in schema");
+    }
+
+    static size_type count(const JValue& value) {
+        require(value.is_number(), "Schema length keywords expect a non-negative integer");
+        const number_type& number = value.number();
+        require(!(number < 0) && (!number.is_floating() || std::trunc(number.template as<double>()) == number.template as<double>()), "Schema length keywords expect a non-negative integer");
+        return number.template as<size_type>();
+    }
+
+    size_type compile_node(const JValue& schema) {
+        size_type index = _Nodes.size();
+        _Nodes.emplace_back();
+
+        if (schema.is_boolean()) {
+            _Nodes[index].reject = !schema.boolean();
+            return index;
+        }
+        require(schema.is_object(), "Schema must be an object or a boolean");
+
+        node n{};
+        for (const auto& [key, value] : schema.object()) {
+            view_type name(key);
+            if (keyword(name, "type")) {
+                n.types = 0;
+                if (value.is_string()) {
+                    n.types = type_bit(view_type(value.string()));
+                    continue;
+                }
+                require(value.is_array(), "Schema keyword type expects a string or an array");
+                for (const JValue& type : value.array()) {
+                    require(type.is_string(), "Schema keyword type expects a string or an array");
+                    n.types |= type_bit(view_type(type.string()));
+                }
+            }
+            else if (keyword(name, "enum")) {
+                require(value.is_array(), "Schema keyword enum expects an array");
+                n.values.emplace(value.array().begin(), value.array().end());
+            }
+            else if (keyword(name, "const")) {
+                n.constant = value;
+            }
+            else if (keyword(name, "properties")) {
+                require(value.is_object(), "Schema keyword properties expects an object");
+                for (const auto& [member, subschema] : value.object()) {
+                    n.properties.push_back({ string_type(view_type(member)), this->compile_node(subschema) });
+                }
+                std::sort(n.properties.begin(), n.properties.end(), [](const property& lhs, const property& rhs) { return lhs.name < rhs.name; });
+            }
+            else if (keyword(name, "additionalProperties")) {
+                n.additional = this->compile_node(value);
+            }
+            else if (keyword(name, "required")) {
+                require(value.is_array(), "Schema keyword required expects an array of strings");
+                for (const JValue& member : value.array()) {
+                    require(member.is_string(), "Schema keyword required expects an array of strings");
+                    n.required.push_back(member.string());
+                }
+                std::sort(n.required.begin(), n.required.end());
+                n.required.erase(std::unique(n.required.begin(), n.required.end()), n.required.end());
+            }
+            else if (keyword(name, "items")) {
+                n.items = this->compile_node(value);
+            }
+            else if (keyword(name, "minimum") || keyword(name, "maximum") || keyword(name, "exclusiveMinimum") || keyword(name, "exclusiveMaximum")) {
+                require(value.is_number(), "Schema range keywords expect a number");
+                auto& bound = keyword(name, "minimum") ? n.minimum : keyword(name, "maximum") ? n.maximum : keyword(name, "exclusiveMinimum") ? n.exclusive_minimum : n.exclusive_maximum;
+                bound = value.number();
+            }
+            else if (keyword(name, "minLength")) {
+                n.min_length = count(value);
+            }
+            else if (keyword(name, "maxLength")) {
+                n.max_length = count(value);
+            }
+            else if (keyword(name, "minItems")) {
+                n.min_items = count(value);
+            }
+            else if (keyword(name, "maxItems")) {
+                n.max_items = count(value);
+            }
+            else if (keyword(name, "pattern")) {
+                require(value.is_string(), "Schema keyword pattern expects a string");
+                if constexpr (has_regex) {
+                    try {
+                        n.pattern.emplace(value.string(), std::regex_constants::ECMAScript | std::regex_constants::optimize);
+                    }
+                    catch (const std::regex_error&) {
+                        throw std::invalid_argument("Schema keyword pattern is not a valid regular expression");
+                    }
+                }
+                else {
+                    throw std::invalid_argument("Schema keyword pattern is only supported for char and wchar_t");
+                }
+            }
+            else if (keyword(name, "$ref") || keyword(name, "$dynamicRef") || keyword(name, "allOf") || keyword(name, "anyOf") || keyword(name, "oneOf")
+                  || keyword(name, "not") || keyword(name, "if") || keyword(name, "then") || keyword(name, "else") || keyword(name, "prefixItems")
+                  || keyword(name, "contains") || keyword(name, "patternProperties") || keyword(name, "dependentSchemas") || keyword(name, "propertyNames")
+                  || keyword(name, "unevaluatedItems") || keyword(name, "unevaluatedProperties")) {
+                throw std::invalid_argument("Unsupported schema keyword");
+            }
+        }
+
+        _Nodes[index] = std::move(n);
+        return index;
+    }
+
+    //
+    // Validating
+    //
+
+    static unsigned type_of(const JValue& value) {
+        if (value.is_null())    return null_bit;
+        if (value.is_boolean()) return boolean_bit;
+        if (value.is_object())  return object_bit;
+        if (value.is_array())   return array_bit;
+        if (value.is_string())  return string_bit;
+
+        const number_type& number = value.number();
+        if (!number.is_floating()) {
+            return number_bit | integer_bit;
+        }
+        double d = number.template as<double>();
+        return std::isfinite(d) && std::trunc(d) == d ? (number_bit | integer_bit) : number_bit;
+    }
+
+    // Code points for UTF-8 and UTF-16, code units otherwise.
+    static size_type length(view_type str) noexcept {
+        if constexpr (sizeof(char_type) == 1) {
+            return static_cast<size_type>(std::count_if(str.begin(), str.end(), [](char_type c) { return (static_cast<unsigned char>(c) & 0xc0) != 0x80; }));
+        }
+        else if constexpr (sizeof(char_type) == 2) {
+            return static_cast<size_type>(std::count_if(str.begin(), str.end(), [](char_type c) { return (static_cast<std::uint16_t>(c) & 0xfc00) != 0xdc00; }));
+        }
+        else {
+            return str.size();
+        }
+    }
+
+    static void append(string_type& pointer, view_type token) {
+        pointer.push_back(char_type('/'));
+        for (char_type c : token) {
+            if (c == char_type('~')) {
+                pointer.push_back(char_type('~'));
+                pointer.push_back(char_type('0'));
+            }
+            else if (c == char_type('/')) {
+                pointer.push_back(char_type('~'));
+                pointer.push_back(char_type('1'));
+            }
+            else {
+                pointer.push_back(c);
+            }
+        }
+    }
+
+    static void append(string_type& pointer, size_type index) {
+        char buffer[32]{};
+        auto [end, ec] = std::to_chars(std::begin(buffer), std::end(buffer), index);
+        pointer.push_back(char_type('/'));
+        for (const char* it = buffer; it != end; ++it) {
+            pointer.push_back(char_type(*it));
+        }
+    }
+
+    static std::optional<violation> fail(const string_type& pointer, const char* keyword) {
+        return violation{ pointer, keyword };
+    }
+
+    size_type member(const node& n, view_type name) const {
+        auto it = std::lower_bound(n.properties.begin(), n.properties.end(), name, [](const property& p, view_type key) { return view_type(p.name) < key; });
+        if (it != n.properties.end() && view_type(it->name) == name) {
+            return it->node;
+        }
+        return n.additional;
+    }
+
+    size_type required_index(const node& n, view_type name) const {
+        auto it = std::lower_bound(n.required.begin(), n.required.end(), name, [](const string_type& r, view_type key) { return view_type(r) < key; });
+        if (it != n.required.end() && view_type(*it) == name) {
+            return static_cast<size_type>(it - n.required.begin());
+        }
+        return npos;
+    }
+
+    // Everything except the members and elements of containers.
+    std::optional<violation> check_shallow(const node& n, const JValue& value, const string_type& pointer) const {
+        if (n.reject) {
+            return fail(pointer, "false");
+        }
+        if ((type_of(value) & n.types) == 0) {
+            return fail(pointer, "type");
+        }
+        if (n.constant && !(*n.constant == value)) {
+            return fail(pointer, "const");
+        }
+        if (n.values && std::find(n.values->begin(), n.values->end(), value) == n.values->end()) {
+            return fail(pointer, "enum");
+        }
+
+        if (value.is_number()) {
+            const number_type& number = value.number();
+            if (n.minimum && number < *n.minimum)                    return fail(pointer, "minimum");
+            if (n.maximum && number > *n.maximum)                    return fail(pointer, "maximum");
+            if (n.exclusive_minimum && !(number > *n.exclusive_minimum)) return fail(pointer, "exclusiveMinimum");
+            if (n.exclusive_maximum && !(number < *n.exclusive_maximum)) return fail(pointer, "exclusiveMaximum");
+        }
+        else if (value.is_string()) {
+            size_type count = length(view_type(value.string()));
+            if (count < n.min_length) return fail(pointer, "minLength");
+            if (count > n.max_length) return fail(pointer, "maxLength");
+            if constexpr (has_regex) {
+                if (n.pattern && !std::regex_search(value.string().begin(), value.string().end(), *n.pattern)) {
+                    return fail(pointer, "pattern");
+                }
+            }
+        }
+        else if (value.is_array()) {
+            if (value.array().size() < n.min_items) return fail(pointer, "minItems");
+            if (value.array().size() > n.max_items) return fail(pointer, "maxItems");
+        }
+        else if (value.is_object()) {
+            for (const string_type& name : n.required) {
+                if (!value.object().contains(view_type(name))) {
+                    return fail(pointer, "required");
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::optional<violation> check(size_type index, const JValue& value, string_type& pointer) const {
+        const node& n = _Nodes[index];
+        if (auto v = this->check_shallow(n, value, pointer)) {
+            return v;
+        }
+
+        size_type mark = pointer.size();
+        if (value.is_array() && n.items != npos) {
+            size_type i = 0;
+            for (const JValue& element : value.array()) {
+                append(pointer, i++);
+                if (auto v = this->check(n.items, element, pointer)) {
+                    return v;
+                }
+                pointer.resize(mark);
+            }
+        }
+        else if (value.is_object() && (!n.properties.empty() || n.additional != npos)) {
+            for (const auto& [key, member] : value.object()) {
+                size_type child = this->member(n, view_type(key));
+                if (child == npos) {
+                    continue;
+                }
+                append(pointer, view_type(key));
+                if (auto v = this->check(child, member, pointer)) {
+                    return v;
+                }
+                pointer.resize(mark);
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Whether the value has to be complete before the node can check it.
+    static bool whole(const node& n) noexcept {
+        return n.reject || n.constant || n.values;
+    }
+
+    static bool trivial(const node& n) noexcept {
+        return !whole(n) && n.types == any_bits && n.properties.empty() && n.additional == npos && n.required.empty() && n.items == npos
+            && n.min_items == 0 && n.max_items == npos;
+    }
+
+    std::optional<violation> stream(reader_type& r, size_type index, JValue* out, string_type& pointer) const {
+        const node& n = _Nodes[index];
+        type_id type = r.type();
+
+        if (n.reject) {
+            return fail(pointer, "false");
+        }
+
+        unsigned expected = 0;
+        switch (type) {
+        case type_id::null:    expected = null_bit;                   break;
+        case type_id::boolean: expected = boolean_bit;                break;
+        case type_id::object:  expected = object_bit;                 break;
+        case type_id::array:   expected = array_bit;                  break;
+        case type_id::string:  expected = string_bit;                break;
+        case type_id::number:  expected = number_bit | integer_bit;  break;
+        default:
+            // Not a value, expecting one fails the reader.
+            r.expect(char_type('{'));
+            return std::nullopt;
+        }
+        if ((expected & n.types) == 0) {
+            return fail(pointer, "type");
+        }
+
+        bool container = type == type_id::object || type == type_id::array;
+        if (!container || whole(n) || trivial(n)) {
+            if (out == nullptr && container && trivial(n)) {
+                r.skip();
+                return std::nullopt;
+            }
+            JValue local{};
+            JValue& value = out ? *out : local;
+            r >> value;
+            if (!r) {
+                return std::nullopt;
+            }
+            return this->check(index, value, pointer);
+        }
+
+        size_type mark = pointer.size();
+        if (type == type_id::array) {
+            if (out) {
+                out->to_array().get().clear();
+            }
+            r.expect(char_type('['));
+            size_type count = 0;
+            if (!r.consume(char_type(']'))) {
+                do {
+                    if (count == n.max_items) {
+                        return fail(pointer, "maxItems");
+                    }
+                    append(pointer, count);
+                    JValue* slot = out ? &out->array().get().emplace_back() : nullptr;
+                    if (n.items == npos) {
+                        slot ? static_cast<void>(r >> *slot) : static_cast<void>(r.skip());
+                    }
+                    else if (auto v = this->stream(r, n.items, slot, pointer)) {
+                        return v;
+                    }
+                    pointer.resize(mark);
+                    ++count;
+                } while (r && r.consume(char_type(',')));
+                r.expect(char_type(']'));
+            }
+            if (r && count < n.min_items) {
+                return fail(pointer, "minItems");
+            }
+            return std::nullopt;
+        }
+
+        if (out) {
+            out->to_object().get().clear();
+        }
+        r.expect(char_type('{'));
+        std::vector<bool> seen(n.required.size(), false);
+        string_type       key{};
+        if (!r.consume(char_type('}'))) {
+            do {
+                r >> key;
+                if (!r.expect(char_type(':'))) {
+                    return std::nullopt;
+                }
+                if (size_type position = this->required_index(n, view_type(key)); position != npos) {
+                    seen[position] = true;
+                }
+                append(pointer, view_type(key));
+                JValue* slot = out ? &out->object()[view_type(key)] : nullptr;
+                size_type child = this->member(n, view_type(key));
+                if (child == npos) {
+                    slot ? static_cast<void>(r >> *slot) : static_cast<void>(r.skip());
+                }
+                else if (auto v = this->stream(r, child, slot, pointer)) {
+                    return v;
+                }
+                pointer.resize(mark);
+            } while (r && r.consume(char_type(',')));
+            r.expect(char_type('}'));
+        }
+        if (r && std::find(seen.begin(), seen.end(), false) != seen.end()) {
+            return fail(pointer, "required");
+        }
+        return std::nullopt;
+    }
+
+    std::vector<node> _Nodes{};
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// BINARY
+// --------
+//  CBOR (RFC 8949) and MessagePack encodings of the json data model. binary_writer and binary_reader offer the
+//  same operators as writer and reader, so the conversions written for those carry over, and user types go
+//  through their basic_value mapping. Both work on a byte stream item by item, documents can be streamed
+//  without building them first and a stream may hold any number of consecutive documents.
+//  Strings are stored as UTF-8, so only one byte character types are supported. Integers use the smallest
+//  encoding that holds them, floating point numbers are stored as single precision when that is lossless.
+//  The reader also accepts indefinite lengths, half precision floats and tags (which are ignored) in CBOR,
+//  and binary strings in both formats, which are read as strings.
+//
+
+enum class binary_format : unsigned char {
+    cbor    = 0,
+    msgpack = 1
+};
+
+template<typename Char, typename Traits = std::char_traits<Char>>
+class basic_binary_writer {
+    static_assert(sizeof(Char) == 1, "Binary formats store strings as UTF-8");
+
+public:
+    using char_type   = Char;
+    using traits_type = Traits;
+    using stream_type = std::ostream;
+    using size_type   = std::size_t;
+
+    basic_binary_writer(stream_type& os, binary_format format = binary_format::cbor)
+        : _Os(os)
+        , _Format(format)
+    {
+    }
+
+    basic_binary_writer& operator<<(std::nullptr_t) {
+        this->put(static_cast<std::uint8_t>(_Format == binary_format::cbor ? 0xf6 : 0xc0));
+        return *this;
+    }
+
+    template<std::size_t N>
+    basic_binary_writer& operator<<(const Char(&str)[N]) {
+        this->text(std::basic_string_view<Char, Traits>(str));
+        return *this;
+    }
+
+    template<typename ... Ts>
+    basic_binary_writer& operator<<(const std::basic_string<Char, Ts...>& str) {
+        this->text(std::basic_string_view<Char, Traits>(str.data(), str.size()));
+        return *this;
+    }
+
+    template<typename ... Ts>
+    basic_binary_writer& operator<<(std::basic_string_view<Char, Ts...> str) {
+        this->text(std::basic_string_view<Char, Traits>(str.data(), str.size()));
+        return *this;
+    }
+
+    template<typename T> requires (std::is_arithmetic_v<T> && !std::same_as<bool, T>)
+    basic_binary_writer& operator<<(const T& number) {
+        if constexpr (std::is_floating_point_v<T>) {
+            this->floating(static_cast<double>(number));
+        }
+        else if constexpr (std::is_signed_v<T>) {
+            this->integer(static_cast<std::int64_t>(number));
+        }
+        else {
+            this->unsigned_integer(static_cast<std::uint64_t>(number));
+        }
+        return *this;
+    }
+
+    template<typename Int, typename UInt, typename Float>
+    basic_binary_writer& operator<<(const basic_number<Int, UInt, Float>& number) {
+        switch (number.kind()) {
+        case number_kind::integer:          return (*this) << number.template as<Int>();
+        case number_kind::unsigned_integer: return (*this) << number.template as<UInt>();
+        default:
+            break;
+        }
+        return (*this) << number.template as<Float>();
+    }
+
+    template<typename T> requires std::same_as<bool, T>
+    basic_binary_writer& operator<<(const T& object) {
+        if (_Format == binary_format::cbor) {
+            this->put(static_cast<std::uint8_t>(object ? 0xf5 : 0xf4));
+        }
+        else {
+            this->put(static_cast<std::uint8_t>(object ? 0xc3 : 0xc2));
+        }
+        return *this;
+    }
+
+    template<typename Key, typename Value>
+    basic_binary_writer& operator<<(const std::pair<Key, Value>& pair) {
+        if constexpr (std::is_convertible_v<const Key&, std::basic_string_view<Char, Traits>>) {
+            this->text(std::basic_string_view<Char, Traits>(pair.first));
+        }
+        else {
+            (*this) << pair.first;
+        }
+        (*this) << pair.second;
+        return *this;
+    }
+
+    template<typename Container> requires detail::is_single_container<Container>
+    basic_binary_writer& operator<<(const Container& container) {
+        return this->sequence(container.begin(), container.end(), major_array);
+    }
+
+    template<typename Container> requires detail::is_pair_container<Container>
+    basic_binary_writer& operator<<(const Container& container) {
+        return this->sequence(container.begin(), container.end(), major_map);
+    }
+
+    // User types are written through their basic_value mapping.
+    template<typename T> requires (is_user_value<T, basic_value<Char, Traits>> && !detail::is_container<T> && !std::is_arithmetic_v<T> && !std::same_as<T, std::nullptr_t>)
+    basic_binary_writer& operator<<(const T& object) {
+        basic_value<Char, Traits> value{};
+        value << object;
+        return (*this) << value;
+    }
+
+    // Writes [first, last) as an array, passing every element through projection first.
+    template<typename Iterator, typename Projection = std::identity>
+    basic_binary_writer& array(Iterator first, Iterator last, Projection projection = {}) {
+        return this->sequence(first, last, major_array, projection);
+    }
+
+    // Writes [first, last) as a map, projection has to yield key/value pairs.
+    template<typename Iterator, typename Projection = std::identity>
+    basic_binary_writer& object(Iterator first, Iterator last, Projection projection = {}) {
+        return this->sequence(first, last, major_map, projection);
+    }
+
+    binary_format format(void) const noexcept {
+        return _Format;
+    }
+
+    operator bool() const noexcept {
+        return !(_Os.bad() || _Os.fail());
+    }
+
+protected:
+    static constexpr std::uint8_t major_unsigned = 0;
+    static constexpr std::uint8_t major_negative = 1;
+    static constexpr std::uint8_t major_text     = 3;
+    static constexpr std::uint8_t major_array    = 4;
+    static constexpr std::uint8_t major_map      = 5;
+
+    template<typename Iterator, typename Projection = std::identity>
+    basic_binary_writer& sequence(Iterator first, Iterator last, std::uint8_t major, Projection projection = {}) {
+        this->head(major, static_cast<std::uint64_t>(std::distance(first, last)));
+        for (Iterator it = first; it != last; ++it) {
+            (*this) << std::invoke(projection, *it);
+        }
+        return *this;
+    }
+
+    // Writes the type and length of a string, array or map, or the value of a non-negative integer.
+    void head(std::uint8_t major, std::uint64_t argument) {
+        if (_Format == binary_format::cbor) {
+            std::uint8_t type = static_cast<std::uint8_t>(major << 5);
+            if (argument < 24) {
+                this->put(static_cast<std::uint8_t>(type | argument));
+            }
+            else if (argument <= 0xff) {
+                this->put(static_cast<std::uint8_t>(type | 24));
+                this->put(static_cast<std::uint8_t>(argument));
+            }
+            else if (argument <= 0xffff) {
+                this->put(static_cast<std::uint8_t>(type | 25));
+                this->put(static_cast<std::uint16_t>(argument));
+            }
+            else if (argument <= 0xffffffff) {
+                this->put(static_cast<std::uint8_t>(type | 26));
+                this->put(static_cast<std::uint32_t>(argument));
+            }
+            else {
+                this->put(static_cast<std::uint8_t>(type | 27));
+                this->put(argument);
+            }
+            return;
+        }
+
+        if (argument > 0xffffffff) {
+            _Os.setstate(std::ios::failbit);
+            return;
+        }
+
+        switch (major) {
+        case major_text:
+            if (argument < 32) {
+                this->put(static_cast<std::uint8_t>(0xa0 | argument));
+            }
+            else if (argument <= 0xff) {
+                this->put(static_cast<std::uint8_t>(0xd9));
+                this->put(static_cast<std::uint8_t>(argument));
+            }
+            else if (argument <= 0xffff) {
+                this->put(static_cast<std::uint8_t>(0xda));
+                this->put(static_cast<std::uint16_t>(argument));
+            }
+            else {
+                this->put(static_cast<std::uint8_t>(0xdb));
+                this->put(static_cast<std::uint32_t>(argument));
+            }
+            break;
+        case major_array:
+        case major_map:
+            if (argument < 16) {
+                this->put(static_cast<std::uint8_t>((major == major_array ? 0x90 : 0x80) | argument));
+            }
+            else if (argument <= 0xffff) {
+                this->put(static_cast<std::uint8_t>(major == major_array ? 0xdc : 0xde));
+                this->put(static_cast<std::uint16_t>(argument));
+            }
+            else {
+                this->put(static_cast<std::uint8_t>(major == major_array ? 0xdd : 0xdf));
+                this->put(static_cast<std::uint32_t>(argument));
+            }
+            break;
+        default:
+            _Os.setstate(std::ios::failbit);
+            break;
+        }
+    }
+
+    void text(std::basic_string_view<Char, Traits> str) {
+        this->head(major_text, str.size());
+        _Os.write(reinterpret_cast<const char*>(str.data()), static_cast<std::streamsize>(str.size()));
+    }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::string_type>
-basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
-    typename basic_value<Char, Traits, Allocator>::string_type v{};
-    jvalue.get() = std::move(v << value);
-    return jvalue;
-}
+    void unsigned_integer(std::uint64_t number) {
+        if (_Format == binary_format::cbor) {
+            this->head(major_unsigned, number);
+        }
+        else if (number < 0x80) {
+            this->put(static_cast<std::uint8_t>(number));
+        }
+        else if (number <= 0xff) {
+            this->put(static_cast<std::uint8_t>(0xcc));
+            this->put(static_cast<std::uint8_t>(number));
+        }
+        else if (number <= 0xffff) {
+            this->put(static_cast<std::uint8_t>(0xcd));
+            this->put(static_cast<std::uint16_t>(number));
+        }
+        else if (number <= 0xffffffff) {
+            this->put(static_cast<std::uint8_t>(0xce));
+            this->put(static_cast<std::uint32_t>(number));
+        }
+        else {
+            this->put(static_cast<std::uint8_t>(0xcf));
+            this->put(number);
+        }
+    }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::string_type>
-const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
-    std::get<typename basic_value<Char, Traits, Allocator>::string_type>(jvalue.get()) >> value;
-    return jvalue;
-}
+    void integer(std::int64_t number) {
+        if (number >= 0) {
+            this->unsigned_integer(static_cast<std::uint64_t>(number));
+        }
+        else if (_Format == binary_format::cbor) {
+            this->head(major_negative, static_cast<std::uint64_t>(-(number + 1)));
+        }
+        else if (number >= -32) {
+            this->put(static_cast<std::uint8_t>(number));
+        }
+        else if (number >= std::numeric_limits<std::int8_t>::min()) {
+            this->put(static_cast<std::uint8_t>(0xd0));
+            this->put(static_cast<std::uint8_t>(number));
+        }
+        else if (number >= std::numeric_limits<std::int16_t>::min()) {
+            this->put(static_cast<std::uint8_t>(0xd1));
+            this->put(static_cast<std::uint16_t>(number));
+        }
+        else if (number >= std::numeric_limits<std::int32_t>::min()) {
+            this->put(static_cast<std::uint8_t>(0xd2));
+            this->put(static_cast<std::uint32_t>(number));
+        }
+        else {
+            this->put(static_cast<std::uint8_t>(0xd3));
+            this->put(static_cast<std::uint64_t>(number));
+        }
+    }
 
-template<typename Char, typename Traits, typename Allocator, std::size_t N>
-basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const Char(&value)[N]) {
-    jvalue.get() = typename basic_value<Char, Traits, Allocator>::string_type(value);
-    return jvalue;
-}
+    void floating(double number) {
+        bool single = !(std::abs(number) > std::numeric_limits<float>::max()) && static_cast<double>(static_cast<float>(number)) == number;
+        if (single) {
+            this->put(static_cast<std::uint8_t>(_Format == binary_format::cbor ? 0xfa : 0xca));
+            this->put(std::bit_cast<std::uint32_t>(static_cast<float>(number)));
+        }
+        else {
+            this->put(static_cast<std::uint8_t>(_Format == binary_format::cbor ? 0xfb : 0xcb));
+            this->put(std::bit_cast<std::uint64_t>(number));
+        }
+    }
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Both formats are big endian.
+    template<typename T> requires std::is_unsigned_v<T>
+    void put(T value) {
+        char buffer[sizeof(T)]{};
+        for (std::size_t i = 0; i < sizeof(T); ++i) {
+            buffer[i] = static_cast<char>(static_cast<std::uint8_t>(value >> (8 * (sizeof(T) - 1 - i))));
+        }
+        _Os.write(buffer, sizeof(T));
+    }
 
+    stream_type&  _Os;
+    binary_format _Format{ binary_format::cbor };
+};
 
-//
-// NUMBER
-//
+template<typename Char, typename Traits = std::char_traits<Char>>
+class basic_binary_reader {
+    static_assert(sizeof(Char) == 1, "Binary formats store strings as UTF-8");
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_number<T, typename basic_value<Char, Traits, Allocator>::number_type>
-basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
-    jvalue.get() = typename basic_value<Char, Traits, Allocator>::number_type(value);
-    return jvalue;
+public:
+    using char_type   = Char;
+    using traits_type = Traits;
+    using stream_type = std::istream;
+    using size_type   = std::size_t;
+
+    basic_binary_reader(stream_type& is, binary_format format = binary_format::cbor, basic_key_pool<Char, Traits>* pool = nullptr)
+        : _Is(is)
+        , _Format(format)
+        , _Pool(pool)
+    {
+    }
+
+    // Type of the next item, CBOR tags in front of it are skipped.
+    type_id type(void) {
+        if (_Format == binary_format::cbor) {
+            this->skip_tags();
+        }
+
+        auto ch = _Is.peek();
+        if (std::istream::traits_type::eq_int_type(ch, std::istream::traits_type::eof())) {
+            return type_id::invalid;
+        }
+
+        std::uint8_t byte = static_cast<std::uint8_t>(ch);
+        if (_Format == binary_format::cbor) {
+            switch (byte >> 5) {
+            case 0: case 1: return type_id::number;
+            case 2: case 3: return type_id::string;
+            case 4:         return type_id::array;
+            case 5:         return type_id::object;
+            default:
+                break;
+            }
+            switch (byte) {
+            case 0xf4: case 0xf5:             return type_id::boolean;
+            case 0xf6: case 0xf7:             return type_id::null;
+            case 0xf9: case 0xfa: case 0xfb:  return type_id::number;
+            default:
+                break;
+            }
+            return type_id::invalid;
+        }
+
+        if (byte < 0x80 || byte >= 0xe0)  return type_id::number;
+        if (byte < 0x90)                  return type_id::object;
+        if (byte < 0xa0)                  return type_id::array;
+        if (byte < 0xc0)                  return type_id::string;
+        switch (byte) {
+        case 0xc0:                                  return type_id::null;
+        case 0xc2: case 0xc3:                       return type_id::boolean;
+        case 0xc4: case 0xc5: case 0xc6:            return type_id::string;
+        case 0xd9: case 0xda: case 0xdb:            return type_id::string;
+        case 0xdc: case 0xdd:                       return type_id::array;
+        case 0xde: case 0xdf:                       return type_id::object;
+        case 0xca: case 0xcb:                       return type_id::number;
+        case 0xcc: case 0xcd: case 0xce: case 0xcf: return type_id::number;
+        case 0xd0: case 0xd1: case 0xd2: case 0xd3: return type_id::number;
+        default:
+            break;
+        }
+        return type_id::invalid;
+    }
+
+    basic_binary_reader& operator>>(std::nullptr_t) {
+        head h{};
+        if (this->read_head(h) && !(h.major == major_simple && (h.info == simple_null || h.info == simple_undefined))) {
+            _Is.setstate(std::ios::failbit);
+        }
+        return *this;
+    }
+
+    template<typename ... Ts>
+    basic_binary_reader& operator>>(std::basic_string<Char, Ts...>& str) {
+        head h{};
+        if (!this->read_head(h)) {
+            return *this;
+        }
+        if (h.major != major_bytes && h.major != major_text) {
+            _Is.setstate(std::ios::failbit);
+            return *this;
+        }
+
+        str.clear();
+        if (!h.indefinite) {
+            this->read_chars(str, h.argument);
+            return *this;
+        }
+
+        // Indefinite length strings are a sequence of definite chunks terminated by a break.
+        while (!this->consume_break()) {
+            head chunk{};
+            if (!this->read_head(chunk) || chunk.major != h.major || chunk.indefinite || !this->read_chars(str, chunk.argument)) {
+                _Is.setstate(std::ios::failbit);
+                break;
+            }
+        }
+        return *this;
+    }
+
+    template<typename T> requires (std::is_arithmetic_v<T> && !std::same_as<bool, T>)
+    basic_binary_reader& operator>>(T& number) {
+        basic_number<> value{};
+        if (this->read_number(value)) {
+            number = value.template as<T>();
+        }
+        return *this;
+    }
+
+    template<typename Int, typename UInt, typename Float>
+    basic_binary_reader& operator>>(basic_number<Int, UInt, Float>& number) {
+        this->read_number(number);
+        return *this;
+    }
+
+    template<typename T> requires std::same_as<bool, T>
+    basic_binary_reader& operator>>(T& b) {
+        head h{};
+        if (!this->read_head(h)) {
+            return *this;
+        }
+        if (h.major != major_simple || (h.info != simple_false && h.info != simple_true)) {
+            _Is.setstate(std::ios::failbit);
+            return *this;
+        }
+        b = h.info == simple_true;
+        return *this;
+    }
+
+    template<typename Key, typename Value>
+    basic_binary_reader& operator>>(std::pair<Key, Value>& pair) {
+        if constexpr (!detail::is_container<Key> && std::constructible_from<Key, const basic_interned_key<Char, Traits>&> && std::constructible_from<Key, std::basic_string_view<Char, Traits>>) {
+            (*this) >> _Key;
+            pair.first = this->template make_key<Key>();
+        }
+        else {
+            (*this) >> pair.first;
+        }
+        (*this) >> pair.second;
+        return *this;
+    }
+
+    template<typename Container> requires detail::is_single_container<Container>
+    basic_binary_reader& operator>>(Container& container) {
+        Container _Temp{};
+        head h{};
+        if (!this->begin(major_array, h, _Temp)) {
+            return *this;
+        }
+
+        auto it = std::back_inserter(_Temp);
+        for (std::uint64_t i = 0; this->next(h, i); ++i) {
+            typename Container::value_type _TempValue{};
+            (*this) >> _TempValue;
+            *it = std::move(_TempValue);
+            ++it;
+        }
+        if (*this) {
+            container = std::move(_Temp);
+        }
+        return *this;
+    }
+
+    template<typename Container> requires detail::is_pair_container<Container>
+    basic_binary_reader& operator>>(Container& container) {
+        using pair_type = std::pair<std::remove_const_t<typename Container::value_type::first_type>, typename Container::value_type::second_type>;
+
+        Container _Temp{};
+        head h{};
+        if (!this->begin(major_map, h, _Temp)) {
+            return *this;
+        }
+
+        auto it = std::inserter(_Temp, _Temp.end());
+        for (std::uint64_t i = 0; this->next(h, i); ++i) {
+            pair_type _TempValue{};
+            (*this) >> _TempValue;
+            *it = std::move(_TempValue);
+            ++it;
+        }
+        if (*this) {
+            container = std::move(_Temp);
+        }
+        return *this;
+    }
+
+    // User types are read through their basic_value mapping.
+    template<typename T> requires (is_user_value<T, basic_value<Char, Traits>> && !detail::is_container<T> && !std::is_arithmetic_v<T> && !std::same_as<T, std::nullptr_t>)
+    basic_binary_reader& operator>>(T& object) {
+        basic_value<Char, Traits> value{};
+        if ((*this) >> value) {
+            value >> object;
+        }
+        return *this;
+    }
+
+    binary_format format(void) const noexcept {
+        return _Format;
+    }
+
+    void pool(basic_key_pool<Char, Traits>* pool) noexcept {
+        _Pool = pool;
+    }
+
+    basic_key_pool<Char, Traits>* pool(void) const noexcept {
+        return _Pool;
+    }
+
+    operator bool() const noexcept {
+        return !(_Is.bad() || _Is.fail());
+    }
+
+protected:
+    static constexpr std::uint8_t major_unsigned = 0;
+    static constexpr std::uint8_t major_negative = 1;
+    static constexpr std::uint8_t major_bytes    = 2;
+    static constexpr std::uint8_t major_text     = 3;
+    static constexpr std::uint8_t major_array    = 4;
+    static constexpr std::uint8_t major_map      = 5;
+    static constexpr std::uint8_t major_tag      = 6;
+    static constexpr std::uint8_t major_simple   = 7;
+
+    static constexpr std::uint8_t simple_false     = 20;
+    static constexpr std::uint8_t simple_true      = 21;
+    static constexpr std::uint8_t simple_null      = 22;
+    static constexpr std::uint8_t simple_undefined = 23;
+    static constexpr std::uint8_t simple_half      = 25;
+    static constexpr std::uint8_t simple_single    = 26;
+    static constexpr std::uint8_t simple_double    = 27;
+
+    //
+    // Lengths come from the input, so preallocation is capped. Longer strings and containers grow
+    // while they are read and a corrupt length fails at the end of the stream instead of allocating.
+    //
+
+    static constexpr std::size_t reserve_limit = 4096;
+    static constexpr std::size_t chunk_size    = 1 << 16;
+
+    // One item header in CBOR terms, MessagePack headers are mapped onto the same major types.
+    struct head {
+        std::uint8_t  major{ 0 };
+        std::uint8_t  info{ 0 };
+        std::uint64_t argument{ 0 };
+        bool          indefinite{ false };
+    };
+
+    // Reads the header of an array or map and reserves room for its elements.
+    template<typename Container>
+    bool begin(std::uint8_t major, head& h, Container& container) {
+        if (!this->read_head(h)) {
+            return false;
+        }
+        if (h.major != major) {
+            _Is.setstate(std::ios::failbit);
+            return false;
+        }
+
+        if constexpr (detail::is_reservable<Container>) {
+            if (!h.indefinite) {
+                container.reserve(static_cast<typename Container::size_type>(std::min<std::uint64_t>(h.argument, reserve_limit)));
+            }
+        }
+        return true;
+    }
+
+    // Whether the container described by h has an element after the first count ones.
+    bool next(const head& h, std::uint64_t count) {
+        return *this && (h.indefinite ? !this->consume_break() : count < h.argument);
+    }
+
+    template<typename Int, typename UInt, typename Float>
+    bool read_number(basic_number<Int, UInt, Float>& number) {
+        head h{};
+        if (!this->read_head(h)) {
+            return false;
+        }
+
+        switch (h.major) {
+        case major_unsigned:
+            number = static_cast<UInt>(h.argument);
+            return true;
+        case major_negative:
+            if (h.argument <= static_cast<std::uint64_t>(std::numeric_limits<Int>::max())) {
+                number = static_cast<Int>(-1 - static_cast<Int>(h.argument));
+            }
+            else {
+                number = static_cast<Float>(-1.0 - static_cast<double>(h.argument));
+            }
+            return true;
+        case major_simple:
+            switch (h.info) {
+            case simple_half:   number = static_cast<Float>(half(static_cast<std::uint16_t>(h.argument))); return true;
+            case simple_single: number = static_cast<Float>(std::bit_cast<float>(static_cast<std::uint32_t>(h.argument))); return true;
+            case simple_double: number = static_cast<Float>(std::bit_cast<double>(h.argument)); return true;
+            default:
+                break;
+            }
+            break;
+        default:
+            break;
+        }
+
+        _Is.setstate(std::ios::failbit);
+        return false;
+    }
+
+    // RFC 8949 Appendix D.
+    static double half(std::uint16_t bits) noexcept {
+        int    exponent = (bits >> 10) & 0x1f;
+        int    mantissa = bits & 0x3ff;
+        double value    = 0.0;
+        if (exponent == 0) {
+            value = std::ldexp(mantissa, -24);
+        }
+        else if (exponent != 31) {
+            value = std::ldexp(mantissa + 1024, exponent - 25);
+        }
+        else {
+            value = mantissa == 0 ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+        }
+        return (bits & 0x8000) ? -value : value;
+    }
+
+    template<typename String>
+    bool read_chars(String& str, std::uint64_t length) {
+        while (length > 0) {
+            std::size_t count = static_cast<std::size_t>(std::min<std::uint64_t>(length, chunk_size));
+            std::size_t size  = str.size();
+            str.resize(size + count);
+            _Is.read(reinterpret_cast<char*>(str.data() + size), static_cast<std::streamsize>(count));
+            if (static_cast<std::size_t>(_Is.gcount()) != count) {
+                _Is.setstate(std::ios::failbit);
+                return false;
+            }
+            length -= count;
+        }
+        return true;
+    }
+
+    bool byte(std::uint8_t& value) {
+        auto ch = _Is.get();
+        if (std::istream::traits_type::eq_int_type(ch, std::istream::traits_type::eof())) {
+            _Is.setstate(std::ios::failbit);
+            return false;
+        }
+        value = static_cast<std::uint8_t>(ch);
+        return true;
+    }
+
+    template<typename T> requires std::is_unsigned_v<T>
+    bool get(T& value) {
+        unsigned char buffer[sizeof(T)]{};
+        _Is.read(reinterpret_cast<char*>(buffer), sizeof(T));
+        if (_Is.gcount() != static_cast<std::streamsize>(sizeof(T))) {
+            _Is.setstate(std::ios::failbit);
+            return false;
+        }
+        value = 0;
+        for (std::size_t i = 0; i < sizeof(T); ++i) {
+            value = static_cast<T>((value << 8) | buffer[i]);
+        }
+        return true;
+    }
+
+    template<typename T>
+    bool argument(std::uint64_t& value) {
+        T raw{};
+        if (!this->get(raw)) {
+            return false;
+        }
+        value = raw;
+        return true;
+    }
+
+    bool consume_break(void) {
+        if (_Format != binary_format::cbor || !std::istream::traits_type::eq_int_type(_Is.peek(), 0xff)) {
+            return false;
+        }
+        _Is.get();
+        return true;
+    }
+
+    void skip_tags(void) {
+        for (auto ch = _Is.peek(); !std::istream::traits_type::eq_int_type(ch, std::istream::traits_type::eof()) && (static_cast<std::uint8_t>(ch) >> 5) == major_tag; ch = _Is.peek()) {
+            head h{};
+            if (!this->read_cbor(h)) {
+                return;
+            }
+        }
+    }
+
+    bool read_head(head& h) {
+        if (_Format == binary_format::cbor) {
+            do {
+                if (!this->read_cbor(h)) {
+                    return false;
+                }
+            } while (h.major == major_tag);
+            return true;
+        }
+        return this->read_msgpack(h);
+    }
+
+    bool read_cbor(head& h) {
+        std::uint8_t b{};
+        if (!this->byte(b)) {
+            return false;
+        }
+        h.major      = static_cast<std::uint8_t>(b >> 5);
+        h.info       = static_cast<std::uint8_t>(b & 0x1f);
+        h.indefinite = false;
+        h.argument   = h.info;
+
+        switch (h.info) {
+        case 24: return this->template argument<std::uint8_t>(h.argument);
+        case 25: return this->template argument<std::uint16_t>(h.argument);
+        case 26: return this->template argument<std::uint32_t>(h.argument);
+        case 27: return this->template argument<std::uint64_t>(h.argument);
+        case 31:
+            if (h.major >= major_bytes && h.major <= major_map) {
+                h.indefinite = true;
+                return true;
+            }
+            break;
+        default:
+            if (h.info < 24) {
+                return true;
+            }
+            break;
+        }
+
+        _Is.setstate(std::ios::failbit);
+        return false;
+    }
+
+    bool read_msgpack(head& h) {
+        std::uint8_t b{};
+        if (!this->byte(b)) {
+            return false;
+        }
+        h = head{};
+
+        if (b < 0x80) {
+            h.major    = major_unsigned;
+            h.argument = b;
+            return true;
+        }
+        if (b >= 0xe0) {
+            h.major    = major_negative;
+            h.argument = static_cast<std::uint64_t>(-1 - static_cast<std::int8_t>(b));
+            return true;
+        }
+        if (b < 0xc0) {
+            h.major    = b < 0x90 ? major_map : (b < 0xa0 ? major_array : major_text);
+            h.argument = b < 0xa0 ? (b & 0x0f) : (b & 0x1f);
+            return true;
+        }
+
+        std::int64_t signed_value = 0;
+        switch (b) {
+        case 0xc0: h.major = major_simple; h.info = simple_null;  return true;
+        case 0xc2: h.major = major_simple; h.info = simple_false; return true;
+        case 0xc3: h.major = major_simple; h.info = simple_true;  return true;
+        case 0xc4: h.major = major_bytes; return this->template argument<std::uint8_t>(h.argument);
+        case 0xc5: h.major = major_bytes; return this->template argument<std::uint16_t>(h.argument);
+        case 0xc6: h.major = major_bytes; return this->template argument<std::uint32_t>(h.argument);
+        case 0xca: h.major = major_simple; h.info = simple_single; return this->template argument<std::uint32_t>(h.argument);
+        case 0xcb: h.major = major_simple; h.info = simple_double; return this->template argument<std::uint64_t>(h.argument);
+        case 0xcc: h.major = major_unsigned; return this->template argument<std::uint8_t>(h.argument);
+        case 0xcd: h.major = major_unsigned; return this->template argument<std::uint16_t>(h.argument);
+        case 0xce: h.major = major_unsigned; return this->template argument<std::uint32_t>(h.argument);
+        case 0xcf: h.major = major_unsigned; return this->template argument<std::uint64_t>(h.argument);
+        case 0xd0: if (!this->template argument<std::uint8_t>(h.argument))  return false; signed_value = static_cast<std::int8_t>(h.argument);  break;
+        case 0xd1: if (!this->template argument<std::uint16_t>(h.argument)) return false; signed_value = static_cast<std::int16_t>(h.argument); break;
+        case 0xd2: if (!this->template argument<std::uint32_t>(h.argument)) return false; signed_value = static_cast<std::int32_t>(h.argument); break;
+        case 0xd3: if (!this->template argument<std::uint64_t>(h.argument)) return false; signed_value = static_cast<std::int64_t>(h.argument); break;
+        case 0xd9: h.major = major_text;  return this->template argument<std::uint8_t>(h.argument);
+        case 0xda: h.major = major_text;  return this->template argument<std::uint16_t>(h.argument);
+        case 0xdb: h.major = major_text;  return this->template argument<std::uint32_t>(h.argument);
+        case 0xdc: h.major = major_array; return this->template argument<std::uint16_t>(h.argument);
+        case 0xdd: h.major = major_array; return this->template argument<std::uint32_t>(h.argument);
+        case 0xde: h.major = major_map;   return this->template argument<std::uint16_t>(h.argument);
+        case 0xdf: h.major = major_map;   return this->template argument<std::uint32_t>(h.argument);
+        default:
+            // Extension types have no json counterpart.
+            _Is.setstate(std::ios::failbit);
+            return false;
+        }
+
+        h.major    = signed_value < 0 ? major_negative : major_unsigned;
+        h.argument = signed_value < 0 ? static_cast<std::uint64_t>(-(signed_value + 1)) : static_cast<std::uint64_t>(signed_value);
+        return true;
+    }
+
+    template<typename Key>
+    Key make_key(void) const {
+        if (_Pool) {
+            return Key(_Pool->intern(_Key));
+        }
+        return Key(std::basic_string_view<Char, Traits>(_Key));
+    }
+
+    stream_type&                    _Is;
+    binary_format                   _Format{ binary_format::cbor };
+    basic_key_pool<Char, Traits>*   _Pool{ nullptr };
+    std::basic_string<Char, Traits> _Key{};
+};
+
+template<typename Char, typename Traits, typename JValue, typename Allocator>
+inline basic_binary_writer<Char, Traits>& operator<<(basic_binary_writer<Char, Traits>& w, const basic_array<JValue, Allocator>& jarray) {
+    using array_type = basic_array<JValue, Allocator>;
+
+    if (jarray.template packed<typename array_type::float_type>()) {
+        auto span = jarray.template span<typename array_type::float_type>();
+        return w.array(span.begin(), span.end());
+    }
+    if (jarray.template packed<typename array_type::integer_type>()) {
+        auto span = jarray.template span<typename array_type::integer_type>();
+        return w.array(span.begin(), span.end());
+    }
+    if (jarray.template packed<typename array_type::boolean_type>()) {
+        auto span = jarray.template span<typename array_type::boolean_type>();
+        return w.array(span.begin(), span.end(), [](typename array_type::boolean_type b) { return b != 0; });
+    }
+    return (w << jarray.get());
 }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_number<T, typename basic_value<Char, Traits, Allocator>::number_type>
-basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
-    jvalue.get() = typename basic_value<Char, Traits, Allocator>::number_type(std::forward<T>(value));
-    return jvalue;
+template<typename Char, typename Traits, typename JValue, typename Allocator>
+inline basic_binary_reader<Char, Traits>& operator>>(basic_binary_reader<Char, Traits>& r, basic_array<JValue, Allocator>& jarray) {
+    return (r >> jarray.get());
 }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_number<T, typename basic_value<Char, Traits, Allocator>::number_type>
-const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
-    value = T(std::get<typename basic_value<Char, Traits, Allocator>::number_type>(jvalue.get()));
-    return jvalue;
+template<typename Char, typename Traits, typename JKey, typename JValue, typename Allocator, typename Storage>
+inline basic_binary_writer<Char, Traits>& operator<<(basic_binary_writer<Char, Traits>& w, const basic_object<JKey, JValue, Allocator, Storage>& jobject) {
+    return (w << jobject.get());
 }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::number_type>
-basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
-    typename basic_value<Char, Traits, Allocator>::number_type v{};
-    jvalue.get() = std::move(v << value);
-    return jvalue;
+template<typename Char, typename Traits, typename JKey, typename JValue, typename Allocator, typename Storage>
+inline basic_binary_reader<Char, Traits>& operator>>(basic_binary_reader<Char, Traits>& r, basic_object<JKey, JValue, Allocator, Storage>& jobject) {
+    return (r >> jobject.get());
 }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::number_type>
-basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
-    typename basic_value<Char, Traits, Allocator>::number_type v{};
-    jvalue.get() = std::move(v << value);
-    return jvalue;
+template<typename Char, typename Traits, typename Allocator>
+inline basic_binary_writer<Char, Traits>& operator<<(basic_binary_writer<Char, Traits>& w, const basic_value<Char, Traits, Allocator>& jvalue) {
+    return std::visit([&](const auto& value) -> basic_binary_writer<Char, Traits>&{
+        return (w << value);
+    }, jvalue.get());
 }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::number_type>
-const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
-    std::get<typename basic_value<Char, Traits, Allocator>::number_type>(jvalue.get()) >> value;
-    return jvalue;
+template<typename Char, typename Traits, typename Allocator>
+inline basic_binary_reader<Char, Traits>& operator>>(basic_binary_reader<Char, Traits>& r, basic_value<Char, Traits, Allocator>& jvalue) {
+    switch (r.type()) {
+    case type_id::null:    return (r >> jvalue.to_null());
+    case type_id::string:  return (r >> jvalue.to_string());
+    case type_id::number:  return (r >> jvalue.to_number());
+    case type_id::array:   return (r >> jvalue.to_array());
+    case type_id::object:  return (r >> jvalue.to_object());
+    case type_id::boolean: return (r >> jvalue.to_boolean());
+    default:
+        break;
+    }
+    // Not a json item or the end of the stream, reading it as null fails the reader.
+    return (r >> nullptr);
 }
 
+using binary_writer   = basic_binary_writer<char>;
+using u8binary_writer = basic_binary_writer<char8_t>;
+using binary_reader   = basic_binary_reader<char>;
+using u8binary_reader = basic_binary_reader<char8_t>;
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
 //
-// BOOLEN
+// ASYNC
+// -------
+//  Coroutine types and readers that never block on input. generator<T> lazily yields values, task<T> is a
+//  lazily started coroutine that resumes its awaiter when done, awaitable from any other coroutine type.
+//  basic_async_reader pulls characters from a source whose read(std::span<Char>) returns an awaitable that
+//  yields the number of characters read, 0 at the end of input. It buffers until the next value is complete,
+//  scanning every character once, and only then parses it, so the coroutine suspends on input only and never
+//  inside the parser. records() yields the values of a JSON Lines stream one by one. basic_async_sink goes the
+//  other way, writing output to a stream on a background thread while the next buffer is being filled.
 //
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_boolean<T, typename basic_value<Char, Traits, Allocator>::boolean_type>
-basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
-    jvalue.get() = typename basic_value<Char, Traits, Allocator>::boolean_type(value);
-    return jvalue;
-}
+namespace detail {
+    // Read only stream buffer over characters owned by someone else.
+    template<typename Char, typename Traits>
+    class view_buf : public std::basic_streambuf<Char, Traits> {
+    public:
+        view_buf(void) = default;
+
+        view_buf(const Char* first, const Char* last) {
+            this->reset(first, last);
+        }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_boolean<T, typename basic_value<Char, Traits, Allocator>::boolean_type>
-basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
-    jvalue.get() = typename basic_value<Char, Traits, Allocator>::boolean_type(std::forward<T>(value));
-    return jvalue;
+        void reset(const Char* first, const Char* last) {
+            Char* begin = const_cast<Char*>(first);
+            this->setg(begin, begin, const_cast<Char*>(last));
+        }
+    };
 }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_default_boolean<T, typename basic_value<Char, Traits, Allocator>::boolean_type>
-const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
-    value = T(std::get<typename basic_value<Char, Traits, Allocator>::boolean_type>(jvalue.get()));
-    return jvalue;
-}
+template<typename T>
+class generator {
+public:
+    struct promise_type {
+        generator get_return_object(void) noexcept {
+            return generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::boolean_type>
-basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
-    typename basic_value<Char, Traits, Allocator>::boolean_type v{};
-    jvalue.get() = std::move(v << value);
-    return jvalue;
-}
+        std::suspend_always initial_suspend(void) const noexcept {
+            return {};
+        }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::boolean_type>
-basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
-    typename basic_value<Char, Traits, Allocator>::boolean_type v{};
-    jvalue.get() = std::move(v << value);
-    return jvalue;
-}
+        std::suspend_always final_suspend(void) const noexcept {
+            return {};
+        }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::boolean_type>
-const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
-    std::get<typename basic_value<Char, Traits, Allocator>::boolean_type>(jvalue.get()) >> value;
-    return jvalue;
+        std::suspend_always yield_value(T& value) noexcept {
+            _Value = std::addressof(value);
+            return {};
+        }
+
+        std::suspend_always yield_value(T&& value) noexcept {
+            _Value = std::addressof(value);
+            return {};
+        }
+
+        void return_void(void) const noexcept {
+        }
+
+        void unhandled_exception(void) noexcept {
+            _Exception = std::current_exception();
+        }
+
+        template<typename U>
+        std::suspend_never await_transform(U&&) = delete;
+
+        T*                 _Value{ nullptr };
+        std::exception_ptr _Exception{};
+    };
+
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    class iterator {
+    public:
+        using value_type      = T;
+        using reference       = T&;
+        using difference_type = std::ptrdiff_t;
+
+        iterator(void) = default;
+
+        explicit iterator(handle_type handle) noexcept
+            : _Handle(handle)
+        {
+        }
+
+        reference operator*(void) const noexcept {
+            return *_Handle.promise()._Value;
+        }
+
+        iterator& operator++(void) {
+            _Handle.resume();
+            generator::rethrow(_Handle);
+            return *this;
+        }
+
+        void operator++(int) {
+            ++(*this);
+        }
+
+        friend bool operator==(const iterator& it, std::default_sentinel_t) noexcept {
+            return !it._Handle || it._Handle.done();
+        }
+
+    private:
+        handle_type _Handle{};
+    };
+
+    generator(void) = default;
+
+    generator(const generator&) = delete;
+
+    generator(generator&& other) noexcept
+        : _Handle(std::exchange(other._Handle, {}))
+    {
+    }
+
+    generator& operator=(const generator&) = delete;
+
+    generator& operator=(generator&& other) noexcept {
+        if (this != &other) {
+            this->destroy();
+            _Handle = std::exchange(other._Handle, {});
+        }
+        return *this;
+    }
+
+    ~generator() {
+        this->destroy();
+    }
+
+    // Runs the coroutine up to its first value, a generator can only be iterated once.
+    iterator begin(void) {
+        if (_Handle) {
+            _Handle.resume();
+            rethrow(_Handle);
+        }
+        return iterator(_Handle);
+    }
+
+    std::default_sentinel_t end(void) const noexcept {
+        return {};
+    }
+
+private:
+    explicit generator(handle_type handle) noexcept
+        : _Handle(handle)
+    {
+    }
+
+    static void rethrow(handle_type handle) {
+        if (handle.done() && handle.promise()._Exception) {
+            std::rethrow_exception(std::exchange(handle.promise()._Exception, nullptr));
+        }
+    }
+
+    void destroy(void) noexcept {
+        if (_Handle) {
+            _Handle.destroy();
+            _Handle = {};
+        }
+    }
+
+    handle_type _Handle{};
+};
+
+template<typename T>
+class task {
+public:
+    struct promise_type {
+        task get_return_object(void) noexcept {
+            return task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend(void) const noexcept {
+            return {};
+        }
+
+        auto final_suspend(void) const noexcept {
+            struct final_awaiter {
+                bool await_ready(void) const noexcept {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) const noexcept {
+                    std::coroutine_handle<> continuation = handle.promise()._Continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+
+                void await_resume(void) const noexcept {
+                }
+            };
+            return final_awaiter{};
+        }
+
+        template<typename U> requires std::convertible_to<U, T>
+        void return_value(U&& value) {
+            _Result.template emplace<1>(std::forward<U>(value));
+        }
+
+        void unhandled_exception(void) noexcept {
+            _Result.template emplace<2>(std::current_exception());
+        }
+
+        T result(void) {
+            if (_Result.index() == 2) {
+                std::rethrow_exception(std::get<2>(_Result));
+            }
+            return std::move(std::get<1>(_Result));
+        }
+
+        std::coroutine_handle<>                           _Continuation{};
+        std::variant<std::monostate, T, std::exception_ptr> _Result{};
+    };
+
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    task(const task&) = delete;
+
+    task(task&& other) noexcept
+        : _Handle(std::exchange(other._Handle, {}))
+    {
+    }
+
+    task& operator=(const task&) = delete;
+
+    task& operator=(task&& other) noexcept {
+        if (this != &other) {
+            this->destroy();
+            _Handle = std::exchange(other._Handle, {});
+        }
+        return *this;
+    }
+
+    ~task() {
+        this->destroy();
+    }
+
+    bool await_ready(void) const noexcept {
+        return !_Handle || _Handle.done();
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept {
+        _Handle.promise()._Continuation = continuation;
+        return _Handle;
+    }
+
+    T await_resume(void) {
+        return _Handle.promise().result();
+    }
+
+    bool done(void) const noexcept {
+        return !_Handle || _Handle.done();
+    }
+
+    // Starts the task if it has not been started and returns its result, for callers outside of coroutines.
+    // Throws std::logic_error if the task is still waiting on an operation that did not complete synchronously.
+    T get(void) {
+        if (_Handle && !_Handle.done()) {
+            _Handle.resume();
+        }
+        if (!this->done()) {
+            throw std::logic_error("Task is suspended on an incomplete operation");
+        }
+        return _Handle.promise().result();
+    }
+
+private:
+    explicit task(handle_type handle) noexcept
+        : _Handle(handle)
+    {
+    }
+
+    void destroy(void) noexcept {
+        if (_Handle) {
+            _Handle.destroy();
+            _Handle = {};
+        }
+    }
+
+    handle_type _Handle{};
+};
+
+template<typename Source, typename Char>
+concept is_async_source = requires(Source& source, std::span<Char> buffer) {
+    source.read(buffer);
+};
+
+template<typename Source, typename Char, typename Traits = std::char_traits<Char>> requires is_async_source<Source, Char>
+class basic_async_reader {
+public:
+    using char_type   = Char;
+    using traits_type = Traits;
+    using source_type = Source;
+    using pool_type   = basic_key_pool<Char, Traits>;
+    using size_type   = std::size_t;
+
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+    basic_async_reader(Source& source, read_flags flags = read_flags::none, pool_type* pool = nullptr, size_type chunk = 4096)
+        : _Source(source)
+        , _Pool(pool)
+        , _Flags(flags)
+        , _Chunk(std::max<size_type>(chunk, 1))
+    {
+    }
+
+    // Reads the next value into value, false at the end of input or if the input is malformed, see fail().
+    // value has to stay alive until the task completes.
+    template<typename JValue>
+    task<bool> next(JValue& value) {
+        while (!_Failed) {
+            size_type end = this->scan();
+            if (end != npos) {
+                co_return this->parse(value, end);
+            }
+            if (_Eof) {
+                _Failed = _Started;
+                break;
+            }
+
+            this->compact();
+            size_type size = _Buffer.size();
+            _Buffer.resize(size + _Chunk);
+            size_type count = co_await _Source.read(std::span<Char>(_Buffer.data() + size, _Chunk));
+            _Buffer.resize(size + std::min(count, _Chunk));
+            _Eof = count == 0;
+        }
+        co_return false;
+    }
+
+    bool eof(void) const noexcept {
+        return _Eof && !_Started && _Position == _Buffer.size();
+    }
+
+    bool fail(void) const noexcept {
+        return _Failed;
+    }
+
+    read_flags flags(void) const noexcept {
+        return _Flags;
+    }
+
+    void flags(read_flags flags) noexcept {
+        _Flags = flags;
+    }
+
+protected:
+    static bool whitespace(Char ch) noexcept {
+        return ch == Char(' ') || ch == Char('\t') || ch == Char('\n') || ch == Char('\r');
+    }
+
+    // Continues scanning where the last call stopped, returns the end of the next value once it is complete.
+    size_type scan(void) {
+        for (; _Scan < _Buffer.size(); ++_Scan) {
+            Char ch = _Buffer[_Scan];
+            if (!_Started) {
+                if (whitespace(ch)) {
+                    _Position = _Scan + 1;
+                    continue;
+                }
+                _Started = true;
+                _Depth   = ch == Char('{') || ch == Char('[') ? 1 : 0;
+                _String  = ch == Char('"');
+                _Scalar  = _Depth == 0 && !_String;
+                continue;
+            }
+
+            if (_String) {
+                if (_Escape) {
+                    _Escape = false;
+                }
+                else if (ch == Char('\\')) {
+                    _Escape = true;
+                }
+                else if (ch == Char('"')) {
+                    _String = false;
+                    if (_Depth == 0) {
+                        return ++_Scan;
+                    }
+                }
+                continue;
+            }
+
+            if (_Scalar) {
+                if (whitespace(ch) || ch == Char(',') || ch == Char(']') || ch == Char('}')) {
+                    return _Scan;
+                }
+                continue;
+            }
+
+            switch (ch) {
+            case Char('"'):
+                _String = true;
+                break;
+            case Char('{'):
+            case Char('['):
+                ++_Depth;
+                break;
+            case Char('}'):
+            case Char(']'):
+                if (--_Depth == 0) {
+                    return ++_Scan;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        // A number or literal at the very end of the input ends with it.
+        if (_Eof && _Started && _Scalar) {
+            return _Scan;
+        }
+        return npos;
+    }
+
+    template<typename JValue>
+    bool parse(JValue& value, size_type end) {
+        detail::view_buf<Char, Traits> buffer(_Buffer.data() + _Position, _Buffer.data() + end);
+        std::basic_istream<Char, Traits> is(&buffer);
+        basic_reader<Char, Traits> r(is, _Flags, _Pool);
+        try {
+            r >> value;
+        }
+        catch (const std::bad_typeid&) {
+            // Thrown for a token that starts no value, which is malformed input as well.
+            is.setstate(std::ios::failbit);
+        }
+
+        _Position = end;
+        _Scan     = end;
+        _Started  = false;
+        _Scalar   = false;
+        _Failed   = !r;
+        return !_Failed;
+    }
+
+    // Drops the characters of values already read once they make up half of the buffer.
+    void compact(void) {
+        if (_Position > 0 && _Position >= _Buffer.size() / 2) {
+            _Buffer.erase(0, _Position);
+            _Scan    -= _Position;
+            _Position = 0;
+        }
+    }
+
+    Source&                         _Source;
+    pool_type*                      _Pool{ nullptr };
+    read_flags                      _Flags{ read_flags::none };
+    size_type                       _Chunk{ 4096 };
+    std::basic_string<Char, Traits> _Buffer{};
+    size_type                       _Position{ 0 };
+    size_type                       _Scan{ 0 };
+    size_type                       _Depth{ 0 };
+    bool                            _Started{ false };
+    bool                            _String{ false };
+    bool                            _Escape{ false };
+    bool                            _Scalar{ false };
+    bool                            _Eof{ false };
+    bool                            _Failed{ false };
+};
+
+template<typename Source> using async_reader    = basic_async_reader<Source, char>;
+template<typename Source> using wasync_reader   = basic_async_reader<Source, wchar_t>;
+template<typename Source> using u8async_reader  = basic_async_reader<Source, char8_t>;
+template<typename Source> using u16async_reader = basic_async_reader<Source, char16_t>;
+template<typename Source> using u32async_reader = basic_async_reader<Source, char32_t>;
+
+// Yields the values of a JSON Lines stream. The same value is reused for every record, so with
+// read_flags::reuse records of the same shape do not allocate. Move it out to keep it past the next record.
+// Throws std::runtime_error on a malformed record.
+template<typename Char, typename Traits, typename Allocator = std::allocator<Char>>
+inline generator<basic_value<Char, Traits, Allocator>> records(std::basic_istream<Char, Traits>& is, read_flags flags = read_flags::none, basic_key_pool<Char, Traits>* pool = nullptr) {
+    basic_reader<Char, Traits>           r(is, flags, pool);
+    basic_value<Char, Traits, Allocator> value{};
+    while (r.type() != type_id::invalid) {
+        if (!(r >> value)) {
+            throw std::runtime_error("Error reading record from stream");
+        }
+        co_yield value;
+    }
+    if (!is.eof()) {
+        throw std::runtime_error("Error reading record from stream");
+    }
 }
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stream buffer that writes to target on a background thread. Output fills one buffer while the thread writes
+// the other; when both are full the writing side waits for the thread. Hand it to a std::basic_ostream to use
+// it with basic_writer or basic_serializer. A failed write fails the stream on the next buffer switch, and
+// flush() and close() throw std::runtime_error. The destructor closes the sink and swallows the error, call
+// close() to see it.
+template<typename Char, typename Traits = std::char_traits<Char>>
+class basic_async_sink : public std::basic_streambuf<Char, Traits> {
+public:
+    using char_type = Char;
+    using traits_type = Traits;
+    using int_type = typename Traits::int_type;
+    using size_type = std::size_t;
+
+    explicit basic_async_sink(std::basic_ostream<Char, Traits>& target, size_type capacity = 1 << 16)
+        : _Target(target)
+        , _Front(std::max<size_type>(capacity, 1))
+        , _Back(std::max<size_type>(capacity, 1))
+    {
+        this->setp(_Front.data(), _Front.data() + _Front.size());
+        _Thread = std::thread([this] { this->run(); });
+    }
+
+    basic_async_sink(const basic_async_sink&) = delete;
+    basic_async_sink& operator=(const basic_async_sink&) = delete;
+
+    ~basic_async_sink() {
+        try {
+            this->close();
+        }
+        catch (const std::exception&) {
+        }
+    }
+
+    // Waits until everything written so far reached target and flushes it.
+    void flush(void) {
+        if (!this->submit()) {
+            this->rethrow();
+        }
+
+        std::unique_lock<std::mutex> lock(_Mutex);
+        _Free.wait(lock, [this] { return !_Full; });
+        if (!_Error && !_Target.flush()) {
+            _Error = true;
+        }
+        lock.unlock();
+
+        this->rethrow();
+    }
 
+    // Flushes and stops the background thread, later output fails the stream.
+    void close(void) {
+        if (_Closed) {
+            return;
+        }
+
+        this->submit();
+        _Closed = true;
+        this->setp(nullptr, nullptr);
+        {
+            std::lock_guard<std::mutex> lock(_Mutex);
+            _Stop = true;
+        }
+        _Ready.notify_one();
+        _Thread.join();
+
+        if (!_Error && !_Target.flush()) {
+            _Error = true;
+        }
+        this->rethrow();
+    }
+
+    bool fail(void) const {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        return _Error;
+    }
 
-//
-// ARRAY VALUE
-//
+protected:
+    int_type overflow(int_type ch) override {
+        if (_Closed || !this->submit()) {
+            return Traits::eof();
+        }
+        if (!Traits::eq_int_type(ch, Traits::eof())) {
+            *this->pptr() = Traits::to_char_type(ch);
+            this->pbump(1);
+        }
+        return Traits::not_eof(ch);
+    }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::array_type>
-inline basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
-    typename basic_value<Char, Traits, Allocator>::array_type v{};
-    jvalue.get() = std::move(v << value);
-    return jvalue;
-}
+    int sync(void) override {
+        if (_Closed) {
+            return -1;
+        }
+        try {
+            this->flush();
+            return 0;
+        }
+        catch (const std::exception&) {
+            return -1;
+        }
+    }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::array_type>
-inline basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
-    typename basic_value<Char, Traits, Allocator>::array_type v{};
-    jvalue.get() = std::move(v << value);
-    return jvalue;
-}
+private:
+    // Hands the filled buffer to the background thread once it is done with the previous one.
+    bool submit(void) {
+        std::unique_lock<std::mutex> lock(_Mutex);
+        _Free.wait(lock, [this] { return !_Full; });
+        if (_Error) {
+            return false;
+        }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::array_type>
-inline const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
-    std::get<typename basic_value<Char, Traits, Allocator>::array_type>(jvalue.get()) >> value;
-    return jvalue;
-}
+        const size_type length = static_cast<size_type>(this->pptr() - this->pbase());
+        if (length != 0) {
+            _Front.swap(_Back);
+            _Length = length;
+            _Full = true;
+            this->setp(_Front.data(), _Front.data() + _Front.size());
+            lock.unlock();
+            _Ready.notify_one();
+        }
+        return true;
+    }
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void run(void) {
+        std::unique_lock<std::mutex> lock(_Mutex);
+        while (true) {
+            _Ready.wait(lock, [this] { return _Stop || _Full; });
+            if (!_Full) {
+                break;
+            }
 
+            lock.unlock();
+            const bool written = static_cast<bool>(_Target.write(_Back.data(), static_cast<std::streamsize>(_Length)));
+            lock.lock();
 
-//
-// OBJECT VALUE
-//
+            _Error = _Error || !written;
+            _Full = false;
+            _Free.notify_all();
+        }
+    }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::object_type>
-inline basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, const T& value) {
-    typename basic_value<Char, Traits, Allocator>::object_type v{};
-    jvalue.get() = std::move(v << value);
-    return jvalue;
-}
+    void rethrow(void) const {
+        if (this->fail()) {
+            throw std::runtime_error("Error writing to target stream");
+        }
+    }
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::object_type>
-inline basic_value<Char, Traits, Allocator>& operator<<(basic_value<Char, Traits, Allocator>& jvalue, T&& value) {
-    typename basic_value<Char, Traits, Allocator>::object_type v{};
-    jvalue.get() = std::move(v << value);
-    return jvalue;
-}
+    std::basic_ostream<Char, Traits>&   _Target;
+    std::vector<Char>                   _Front{};
+    std::vector<Char>                   _Back{};
+    size_type                           _Length{ 0 };
+    mutable std::mutex                  _Mutex{};
+    std::condition_variable             _Ready{};
+    std::condition_variable             _Free{};
+    bool                                _Full{ false };
+    bool                                _Stop{ false };
+    bool                                _Error{ false };
+    bool                                _Closed{ false };
+    std::thread                         _Thread{};
+};
 
-template<typename T, typename Char, typename Traits, typename Allocator> requires is_user_value<T, typename basic_value<Char, Traits, Allocator>::object_type>
-inline const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<Char, Traits, Allocator>& jvalue, T& value) {
-    std::get<typename basic_value<Char, Traits, Allocator>::object_type>(jvalue.get()) >> value;
-    return jvalue;
-}
+using async_sink      = basic_async_sink<char>;
+using wasync_sink     = basic_async_sink<wchar_t>;
+using u8async_sink    = basic_async_sink<char8_t>;
+using u16async_sink   = basic_async_sink<char16_t>;
+using u32async_sink   = basic_async_sink<char32_t>;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -1261,10 +9007,7 @@ public:
 
     template<typename ... Ts>
     const basic_serializer& operator()(std::basic_ostream<Char, Ts...>& os, const basic_value<Char, Traits, Allocator>& value) const {
-        basic_writer<Char, Traits> jw(os, _Indentation);
-        if (!(jw << value)) {
-            throw std::exception("Error writing value to stream");
-        }
+        this->write(os, value);
         return *this;
     }
 
@@ -1276,10 +9019,7 @@ public:
 
     template<typename ... Ts>
     const basic_serializer& operator()(std::basic_ostream<Char, Ts...>& os, const typename basic_value<Char, Traits, Allocator>::object_type& value) const {
-        basic_writer<Char, Traits> jw(os, _Indentation);
-        if (!(jw << value)) {
-            throw std::exception("Error writing value to stream");
-        }
+        this->write(os, value);
         return *this;
     }
 
@@ -1291,10 +9031,7 @@ public:
 
     template<typename ... Ts>
     const basic_serializer& operator()(std::basic_ostream<Char, Ts...>& os, const typename basic_value<Char, Traits, Allocator>::array_type& value) const {
-        basic_writer<Char, Traits> jw(os, _Indentation);
-        if (!(jw << value)) {
-            throw std::exception("Error writing value to stream");
-        }
+        this->write(os, value);
         return *this;
     }
 
@@ -1307,7 +9044,11 @@ public:
     template<typename T, typename ... Ts> requires is_user_value<T, basic_value<Char, Traits, Allocator>>
     const basic_serializer& operator()(std::basic_ostream<Char, Ts...>& os, const T& value) const {
         basic_value<Char, Traits, Allocator> v{};
-        this->operator()(os, v << value);
+        {
+            detail::stats_timer timer(_Stats, &statistics::convert_time);
+            v << value;
+        }
+        this->write(os, v);
         return *this;
     }
 
@@ -1334,31 +9075,110 @@ public:
         return _Level;
     }
 
+    // See basic_writer::caching().
+    void caching(bool caching) noexcept {
+        _Caching = caching;
+    }
+
+    bool caching(void) const noexcept {
+        return _Caching;
+    }
+
+    void stats(statistics* stats) noexcept {
+        _Stats = stats;
+    }
+
+    statistics* stats(void) const noexcept {
+        return _Stats;
+    }
+
 private:
-    bool _Indentation{ false };
-    int  _Level{ 0 };
+    template<typename T, typename ... Ts>
+    void write(std::basic_ostream<Char, Ts...>& os, const T& value) const {
+        basic_writer<Char, Traits> jw(os, _Indentation);
+        jw.stats(_Stats);
+        jw.caching(_Caching);
+        const std::streamoff first = stats_enabled && _Stats ? detail::position(os, std::ios_base::out) : -1;
+        {
+            detail::stats_timer timer(_Stats, &statistics::write_time);
+            if (!(jw << value)) {
+                throw std::runtime_error("Error writing value to stream");
+            }
+        }
+        if (first >= 0) {
+            const std::streamoff last = detail::position(os, std::ios_base::out);
+            _Stats->bytes += last >= first ? static_cast<std::size_t>(last - first) : 0;
+        }
+    }
+
+    bool        _Indentation{ false };
+    int         _Level{ 0 };
+    statistics* _Stats{ nullptr };
+    bool        _Caching{ false };
 };
 
+// Fills stats for this call, see STATS.
+template<typename T, typename Char, typename Traits = std::char_traits<Char>, typename Allocator = std::allocator<Char>> requires is_serializable<T, basic_serializer<Char, Traits, Allocator>>
+inline std::optional<std::exception> serialize(std::basic_ostream<Char, Traits>& os, const T& value, statistics& stats, bool indentation = false, int level = 0) noexcept {
+    stats = statistics{};
+    try {
+        basic_serializer<Char, Traits, Allocator> js{ indentation, level };
+        js.stats(&stats);
+        js(os, value);
+    }
+    catch (const std::exception& e) {
+        return e;
+    }
+    if constexpr (stats_enabled) {
+        if (stats_hook* hook = stats_hook::installed()) {
+            hook->serialized(stats);
+        }
+    }
+    return std::optional<std::exception>{};
+}
+
+template<typename T, typename Char, typename Traits = std::char_traits<Char>, typename Allocator = std::allocator<Char>> requires is_serializable<T, basic_serializer<Char, Traits, Allocator>>
+inline std::optional<std::exception> serialize(std::basic_string<Char, Traits, Allocator>& str, const T& value, statistics& stats, bool indentation = false, int level = 0) noexcept {
+    std::basic_ostringstream<Char, Traits, Allocator> os{};
+    std::optional<std::exception> error = serialize<T, Char, Traits, Allocator>(os, value, stats, indentation, level);
+    if (!error) {
+        str = std::move(os).str();
+    }
+    return error;
+}
+
 template<typename T, typename Char, typename Traits = std::char_traits<Char>, typename Allocator = std::allocator<Char>> requires is_serializable<T, basic_serializer<Char, Traits, Allocator>>
 inline std::optional<std::exception> serialize(std::basic_ostream<Char, Traits>& os, const T& value, bool indentation = false, int level = 0) noexcept {
+    if constexpr (stats_enabled) {
+        if (stats_hook::installed()) {
+            statistics stats{};
+            return serialize<T, Char, Traits, Allocator>(os, value, stats, indentation, level);
+        }
+    }
     try {
         basic_serializer<Char, Traits, Allocator> js{ indentation, level };
         js(os, value);
         return std::optional<std::exception>{};
     }
-    catch (std::exception e) {
+    catch (const std::exception& e) {
         return e;
     }
 }
 
 template<typename T, typename Char, typename Traits = std::char_traits<Char>, typename Allocator = std::allocator<Char>> requires is_serializable<T, basic_serializer<Char, Traits, Allocator>>
 inline std::optional<std::exception> serialize(std::basic_string<Char, Traits, Allocator>& str, const T& value, bool indentation = false, int level = 0) noexcept {
+    if constexpr (stats_enabled) {
+        if (stats_hook::installed()) {
+            statistics stats{};
+            return serialize<T, Char, Traits, Allocator>(str, value, stats, indentation, level);
+        }
+    }
     try {
         basic_serializer<Char, Traits, Allocator> js{ indentation, level };
         str = std::move(js(value));
         return std::optional<std::exception>{};
     }
-    catch (std::exception e) {
+    catch (const std::exception& e) {
         return e;
     }
 }
@@ -1378,13 +9198,22 @@ public:
     using traits_type = Traits;
     using allocator_type = Allocator;
     using stream_type = std::basic_istream<Char, Traits>;
+    using pool_type = basic_key_pool<Char, Traits>;
+
+    basic_deserializer(pool_type* pool = nullptr)
+        : _Pool(pool)
+    {
+    }
+
+    basic_deserializer(read_flags flags, pool_type* pool = nullptr)
+        : _Pool(pool)
+        , _Flags(flags)
+    {
+    }
 
     template<typename ... Ts>
     const basic_deserializer& operator()(std::basic_istream<Char, Ts...>& is, basic_value<Char, Traits, Allocator>& value) const {
-        basic_reader<Char, Traits> jr(is);
-        if (!(jr >> value)) {
-            throw std::exception("Error reading value to stream");
-        }
+        this->read(is, value);
         return *this;
     }
 
@@ -1396,10 +9225,7 @@ public:
 
     template<typename ... Ts>
     const basic_deserializer& operator()(std::basic_istream<Char, Ts...>& is, typename basic_value<Char, Traits, Allocator>::object_type& value) const {
-        basic_reader<Char, Traits> jr(is);
-        if (!(jr >> value)) {
-            throw std::exception("Error reading value to stream");
-        }
+        this->read(is, value);
         return *this;
     }
 
@@ -1411,10 +9237,7 @@ public:
 
     template<typename ... Ts>
     const basic_deserializer& operator()(std::basic_istream<Char, Ts...>& is, typename basic_value<Char, Traits, Allocator>::array_type& value) const {
-        basic_reader<Char, Traits> jr(is);
-        if (!(jr >> value)) {
-            throw std::exception("Error reading value to stream");
-        }
+        this->read(is, value);
         return *this;
     }
 
@@ -1424,13 +9247,23 @@ public:
         return this->operator()(is, value);
     }
 
+    template<typename ... Ts>
+    const basic_deserializer& operator()(std::basic_istream<Char, Ts...>& is, basic_tape<Char, Traits, Allocator>& value) const {
+        this->read(is, value);
+        return *this;
+    }
+
+    template<typename ... Ts>
+    const basic_deserializer& operator()(const std::basic_string<Char, Ts...>& str, basic_tape<Char, Traits, Allocator>& value) const {
+        std::basic_istringstream<Char, Ts...> is{ str };
+        return this->operator()(is, value);
+    }
+
     template<typename T, typename ... Ts> requires is_user_value<T, basic_value<Char, Traits, Allocator>>
     const basic_deserializer& operator()(std::basic_istream<Char, Ts...>& is, T& value) const {
         basic_value<Char, Traits, Allocator> v{};
-        basic_reader<Char, Traits> jr(is);
-        if (!(jr >> v)) {
-            throw std::exception("Error reading value to stream");
-        }
+        this->read(is, v);
+        detail::stats_timer timer(_Stats, &statistics::convert_time);
         v >> value;
         return *this;
     }
@@ -1440,26 +9273,110 @@ public:
         std::basic_istringstream<Char, Ts...> is{ str };
         return this->operator()(is, value);
     }
+
+    void pool(pool_type* pool) noexcept {
+        _Pool = pool;
+    }
+
+    pool_type* pool(void) const noexcept {
+        return _Pool;
+    }
+
+    void flags(read_flags flags) noexcept {
+        _Flags = flags;
+    }
+
+    read_flags flags(void) const noexcept {
+        return _Flags;
+    }
+
+    void stats(statistics* stats) noexcept {
+        _Stats = stats;
+    }
+
+    statistics* stats(void) const noexcept {
+        return _Stats;
+    }
+
+private:
+    template<typename T, typename ... Ts>
+    void read(std::basic_istream<Char, Ts...>& is, T& value) const {
+        basic_reader<Char, Traits> jr(is, _Flags, _Pool);
+        jr.stats(_Stats);
+        const std::streamoff first = stats_enabled && _Stats ? detail::position(is, std::ios_base::in) : -1;
+        {
+            detail::stats_timer timer(_Stats, &statistics::parse_time);
+            if (!(jr >> value)) {
+                throw std::runtime_error("Error reading value to stream");
+            }
+        }
+        if (first >= 0) {
+            const std::streamoff last = detail::position(is, std::ios_base::in);
+            _Stats->bytes += last >= first ? static_cast<std::size_t>(last - first) : 0;
+        }
+    }
+
+    pool_type*  _Pool{ nullptr };
+    read_flags  _Flags{ read_flags::none };
+    statistics* _Stats{ nullptr };
 };
 
+// Fills stats for this call, see STATS.
+template<typename T, typename Char, typename Traits = std::char_traits<Char>, typename Allocator = std::allocator<Char>> requires is_deserializable<T, basic_deserializer<Char, Traits, Allocator>>
+inline std::optional<std::exception> deserialize(std::basic_istream<Char, Traits>& is, T& value, statistics& stats) noexcept {
+    stats = statistics{};
+    try {
+        basic_deserializer<Char, Traits, Allocator> jd{};
+        jd.stats(&stats);
+        jd(is, value);
+    }
+    catch (const std::exception& e) {
+        return e;
+    }
+    if constexpr (stats_enabled) {
+        if (stats_hook* hook = stats_hook::installed()) {
+            hook->parsed(stats);
+        }
+    }
+    return std::optional<std::exception>{};
+}
+
+template<typename T, typename Char, typename Traits = std::char_traits<Char>, typename Allocator = std::allocator<Char>> requires is_deserializable<T, basic_deserializer<Char, Traits, Allocator>>
+inline std::optional<std::exception> deserialize(const std::basic_string<Char, Traits, Allocator>& str, T& value, statistics& stats) noexcept {
+    std::basic_istringstream<Char, Traits, Allocator> is{ str };
+    return deserialize<T, Char, Traits, Allocator>(is, value, stats);
+}
+
 template<typename T, typename Char, typename Traits = std::char_traits<Char>, typename Allocator = std::allocator<Char>> requires is_deserializable<T, basic_deserializer<Char, Traits, Allocator>>
 inline std::optional<std::exception> deserialize(std::basic_istream<Char, Traits>& is, T& value) noexcept {
+    if constexpr (stats_enabled) {
+        if (stats_hook::installed()) {
+            statistics stats{};
+            return deserialize<T, Char, Traits, Allocator>(is, value, stats);
+        }
+    }
     try {
         basic_deserializer<Char, Traits, Allocator>{}(is, value);
         return std::optional<std::exception>{};
     }
-    catch (std::exception e) {
+    catch (const std::exception& e) {
         return e;
     }
 }
 
 template<typename T, typename Char, typename Traits = std::char_traits<Char>, typename Allocator = std::allocator<Char>> requires is_deserializable<T, basic_deserializer<Char, Traits, Allocator>>
 inline std::optional<std::exception> deserialize(const std::basic_string<Char, Traits, Allocator>& str, T& value) noexcept {
+    if constexpr (stats_enabled) {
+        if (stats_hook::installed()) {
+            statistics stats{};
+            return deserialize<T, Char, Traits, Allocator>(str, value, stats);
+        }
+    }
     try {
         basic_deserializer<Char, Traits, Allocator>{}(str, value);
         return std::optional<std::exception>{};
     }
-    catch (std::exception e) {
+    catch (const std::exception& e) {
         return e;
     }
 }
@@ -1467,6 +9384,189 @@ inline std::optional<std::exception> deserialize(const std::basic_string<Char, T
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
+//
+// BATCH
+// -------
+//  Parses many independent documents on a pool of threads, the calling thread being one of them. Every worker
+//  keeps one stream and reader for the lifetime of the pool and rewinds them over each document, so the setup
+//  basic_deserializer pays on every call is paid once per thread, and the reader's container size hints carry
+//  over between documents of the same shape. Workers claim documents in small chunks from a shared counter, so
+//  a worker that drew cheap documents simply claims more of them. Value i is written to out[i] and its error,
+//  if any, to the i-th entry of the result.
+//
+
+template<typename Char, typename Traits = std::char_traits<Char>, typename Allocator = std::allocator<Char>>
+class basic_batch_deserializer {
+public:
+    using char_type = Char;
+    using traits_type = Traits;
+    using allocator_type = Allocator;
+    using value_type = basic_value<Char, Traits, Allocator>;
+    using view_type = std::basic_string_view<Char, Traits>;
+    using pool_type = basic_key_pool<Char, Traits>;
+    using size_type = std::size_t;
+    using error_type = std::optional<std::exception>;
+
+    // 0 threads starts one per hardware thread.
+    explicit basic_batch_deserializer(size_type threads = 0, read_flags flags = read_flags::none, pool_type* pool = nullptr)
+        : _Pool(pool)
+        , _Flags(flags)
+        , _Local(flags, pool)
+    {
+        if (threads == 0) {
+            threads = std::max<size_type>(std::thread::hardware_concurrency(), 1);
+        }
+        _Threads.reserve(threads - 1);
+        for (size_type i = 1; i < threads; ++i) {
+            _Threads.emplace_back([this] { this->run(); });
+        }
+    }
+
+    basic_batch_deserializer(const basic_batch_deserializer&) = delete;
+    basic_batch_deserializer& operator=(const basic_batch_deserializer&) = delete;
+
+    ~basic_batch_deserializer() {
+        {
+            std::lock_guard<std::mutex> lock(_Mutex);
+            _Stop = true;
+        }
+        _Wake.notify_all();
+        for (auto& thread : _Threads) {
+            thread.join();
+        }
+    }
+
+    template<typename Documents> requires std::ranges::random_access_range<const Documents> && std::ranges::sized_range<const Documents> && std::convertible_to<std::ranges::range_reference_t<const Documents>, std::basic_string_view<Char, Traits>>
+    std::vector<error_type> operator()(const Documents& documents, std::span<value_type> out) {
+        const size_type size = std::ranges::size(documents);
+        if (out.size() < size) {
+            throw std::invalid_argument("Fewer values than documents");
+        }
+
+        std::vector<error_type> errors(size);
+        std::atomic<size_type> next{ 0 };
+        const size_type chunk = std::max<size_type>(size / (this->threads() * 8), 1);
+        std::function<void(worker&)> job = [&](worker& w) {
+            for (size_type first; (first = next.fetch_add(chunk, std::memory_order_relaxed)) < size;) {
+                const size_type last = std::min(first + chunk, size);
+                for (size_type i = first; i < last; ++i) {
+                    w.parse(view_type(std::ranges::begin(documents)[i]), out[i], errors[i]);
+                }
+            }
+        };
+
+        std::lock_guard<std::mutex> batch(_Batch);
+        this->dispatch(job);
+        return errors;
+    }
+
+    size_type threads(void) const noexcept {
+        return _Threads.size() + 1;
+    }
+
+    pool_type* pool(void) const noexcept {
+        return _Pool;
+    }
+
+    read_flags flags(void) const noexcept {
+        return _Flags;
+    }
+
+private:
+    class worker {
+    public:
+        worker(read_flags flags, pool_type* pool)
+            : _Stream(&_Buffer)
+            , _Reader(_Stream, flags, pool)
+        {
+        }
+
+        void parse(view_type document, value_type& value, error_type& error) noexcept {
+            _Buffer.reset(document.data(), document.data() + document.size());
+            _Stream.clear();
+            try {
+                if (!(_Reader >> value)) {
+                    throw std::runtime_error("Error reading value to stream");
+                }
+            }
+            catch (const std::exception& e) {
+                error = e;
+            }
+        }
+
+    private:
+        detail::view_buf<Char, Traits>     _Buffer{};
+        std::basic_istream<Char, Traits>   _Stream;
+        basic_reader<Char, Traits>         _Reader;
+    };
+
+    void dispatch(std::function<void(worker&)>& job) {
+        {
+            std::lock_guard<std::mutex> lock(_Mutex);
+            _Job = &job;
+            _Running = _Threads.size();
+            ++_Generation;
+        }
+        _Wake.notify_all();
+
+        job(_Local);
+
+        std::unique_lock<std::mutex> lock(_Mutex);
+        _Done.wait(lock, [this] { return _Running == 0; });
+        _Job = nullptr;
+    }
+
+    void run(void) {
+        worker w(_Flags, _Pool);
+        size_type generation = 0;
+
+        std::unique_lock<std::mutex> lock(_Mutex);
+        while (true) {
+            _Wake.wait(lock, [&] { return _Stop || _Generation != generation; });
+            if (_Stop) {
+                break;
+            }
+
+            generation = _Generation;
+            std::function<void(worker&)>* job = _Job;
+
+            lock.unlock();
+            (*job)(w);
+            lock.lock();
+
+            if (--_Running == 0) {
+                _Done.notify_one();
+            }
+        }
+    }
+
+    pool_type*                          _Pool{ nullptr };
+    read_flags                          _Flags{ read_flags::none };
+    worker                              _Local;
+    std::mutex                          _Batch{};
+    std::mutex                          _Mutex{};
+    std::condition_variable             _Wake{};
+    std::condition_variable             _Done{};
+    std::function<void(worker&)>*       _Job{ nullptr };
+    size_type                           _Running{ 0 };
+    size_type                           _Generation{ 0 };
+    bool                                _Stop{ false };
+    std::vector<std::thread>            _Threads{};
+};
+
+// Parses documents into out, resized to match, on a pool started for this call only. Keep a
+// basic_batch_deserializer around to reuse its threads between batches.
+template<typename Documents, typename Char, typename Traits, typename Allocator> requires std::ranges::random_access_range<const Documents> && std::ranges::sized_range<const Documents> && std::convertible_to<std::ranges::range_reference_t<const Documents>, std::basic_string_view<Char, Traits>>
+inline std::vector<std::optional<std::exception>> deserialize_batch(const Documents& documents, std::vector<basic_value<Char, Traits, Allocator>>& out, read_flags flags = read_flags::none) {
+    const std::size_t size = std::ranges::size(documents);
+    out.resize(size);
+    const std::size_t threads = std::clamp<std::size_t>(size, 1, std::max<std::size_t>(std::thread::hardware_concurrency(), 1));
+    return basic_batch_deserializer<Char, Traits, Allocator>(threads, flags)(documents, std::span<basic_value<Char, Traits, Allocator>>(out));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
 //
 // ALIASES
 //
@@ -1474,52 +9574,102 @@ inline std::optional<std::exception> deserialize(const std::basic_string<Char, T
 using value           = basic_value<char>;
 using null            = typename value::null_type;
 using string          = typename value::string_type;
+using key             = typename value::key_type;
+using key_view        = basic_key_view<char>;
+using key_pool        = basic_key_pool<char>;
 using number          = typename value::number_type;
 using array           = typename value::array_type;
 using object          = typename value::object_type;
 using boolean         = typename value::boolean_type;
 using serializer      = basic_serializer<char>;
 using deserializer    = basic_deserializer<char>;
+using batch_deserializer = basic_batch_deserializer<char>;
+using shared_value    = basic_shared_value<char>;
+using path            = basic_path<value>;
+using patch           = basic_patch<value>;
+using projection      = basic_projection<value>;
+using schema          = basic_schema<value>;
+using snapshot        = basic_snapshot<char>;
 
 using wvalue          = basic_value<wchar_t>;
 using wnull           = typename value::null_type;
 using wstring         = typename value::string_type;
+using wkey            = typename wvalue::key_type;
+using wkey_view       = basic_key_view<wchar_t>;
+using wkey_pool       = basic_key_pool<wchar_t>;
 using wnumber         = typename value::number_type;
 using warray          = typename value::array_type;
 using wobject         = typename value::object_type;
 using wboolean        = typename value::boolean_type;
 using wserializer     = basic_serializer<wchar_t>;
 using wdeserializer   = basic_deserializer<wchar_t>;
+using wbatch_deserializer = basic_batch_deserializer<wchar_t>;
+using wshared_value   = basic_shared_value<wchar_t>;
+using wpath           = basic_path<wvalue>;
+using wpatch          = basic_patch<wvalue>;
+using wprojection     = basic_projection<wvalue>;
+using wschema         = basic_schema<wvalue>;
+using wsnapshot       = basic_snapshot<wchar_t>;
 
 using u8value         = basic_value<char8_t>;
 using u8null          = typename value::null_type;
 using u8string        = typename value::string_type;
+using u8key           = typename u8value::key_type;
+using u8key_view      = basic_key_view<char8_t>;
+using u8key_pool      = basic_key_pool<char8_t>;
 using u8number        = typename value::number_type;
 using u8array         = typename value::array_type;
 using u8object        = typename value::object_type;
 using u8boolean       = typename value::boolean_type;
 using u8serializer    = basic_serializer<char8_t>;
 using u8deserializer  = basic_deserializer<char8_t>;
+using u8batch_deserializer = basic_batch_deserializer<char8_t>;
+using u8shared_value  = basic_shared_value<char8_t>;
+using u8path          = basic_path<u8value>;
+using u8patch         = basic_patch<u8value>;
+using u8projection    = basic_projection<u8value>;
+using u8schema        = basic_schema<u8value>;
+using u8snapshot      = basic_snapshot<char8_t>;
 
 using u16value        = basic_value<char16_t>;
 using u16null         = typename value::null_type;
 using u16string       = typename value::string_type;
+using u16key          = typename u16value::key_type;
+using u16key_view     = basic_key_view<char16_t>;
+using u16key_pool     = basic_key_pool<char16_t>;
 using u16number       = typename value::number_type;
 using u16array        = typename value::array_type;
 using u16object       = typename value::object_type;
 using u16boolean      = typename value::boolean_type;
 using u16serializer   = basic_serializer<char16_t>;
 using u16deserializer = basic_deserializer<char16_t>;
+using u16batch_deserializer = basic_batch_deserializer<char16_t>;
+using u16shared_value = basic_shared_value<char16_t>;
+using u16path         = basic_path<u16value>;
+using u16patch        = basic_patch<u16value>;
+using u16projection   = basic_projection<u16value>;
+using u16schema       = basic_schema<u16value>;
+using u16snapshot     = basic_snapshot<char16_t>;
 
 using u32value        = basic_value<char32_t>;
 using u32null         = typename value::null_type;
 using u32string       = typename value::string_type;
+using u32key          = typename u32value::key_type;
+using u32key_view     = basic_key_view<char32_t>;
+using u32key_pool     = basic_key_pool<char32_t>;
 using u32number       = typename value::number_type;
 using u32array        = typename value::array_type;
 using u32object       = typename value::object_type;
 using u32boolean      = typename value::boolean_type;
 using u32serializer   = basic_serializer<char32_t>;
 using u32deserializer = basic_deserializer<char32_t>;
+using u32batch_deserializer = basic_batch_deserializer<char32_t>;
+using u32shared_value = basic_shared_value<char32_t>;
+using u32path         = basic_path<u32value>;
+using u32patch        = basic_patch<u32value>;
+using u32projection   = basic_projection<u32value>;
+using u32schema       = basic_schema<u32value>;
+using u32snapshot     = basic_snapshot<char32_t>;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -1588,6 +9738,116 @@ inline const basic_value<Char, Traits, Allocator>& operator>>(const basic_value<
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+
+//
+// RECLAIMER
+// -----------
+//  Frees retired values on a background thread, so dropping a large document does not stall the caller.
+//  The destructor waits until everything retired so far is freed.
+//
+
+namespace detail {
+    struct retired_base {
+        virtual ~retired_base() = default;
+    };
+
+    template<typename T>
+    struct retired : retired_base {
+        explicit retired(T&& value)
+            : value(std::move(value))
+        {
+        }
+
+        T value;
+    };
+}
+
+class reclaimer {
+public:
+    reclaimer(void) {
+        _Thread = std::thread([this] { this->run(); });
+    }
+
+    reclaimer(const reclaimer&) = delete;
+    reclaimer& operator=(const reclaimer&) = delete;
+
+    ~reclaimer() {
+        {
+            std::lock_guard<std::mutex> lock(_Mutex);
+            _Stop = true;
+        }
+        _Pending.notify_one();
+        _Thread.join();
+    }
+
+    template<typename T> requires (!std::is_lvalue_reference_v<T>)
+    void retire(T&& value) {
+        auto retired = std::make_unique<detail::retired<T>>(std::move(value));
+        {
+            std::lock_guard<std::mutex> lock(_Mutex);
+            _Queue.push_back(std::move(retired));
+        }
+        _Pending.notify_one();
+    }
+
+    std::size_t pending(void) const {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        return _Queue.size();
+    }
+
+    void wait(void) {
+        std::unique_lock<std::mutex> lock(_Mutex);
+        _Idle.wait(lock, [this] { return _Queue.empty() && !_Busy; });
+    }
+
+private:
+    void run(void) {
+        std::unique_lock<std::mutex> lock(_Mutex);
+        while (true) {
+            _Pending.wait(lock, [this] { return _Stop || !_Queue.empty(); });
+            if (_Queue.empty()) {
+                break;
+            }
+
+            std::vector<std::unique_ptr<detail::retired_base>> batch = std::move(_Queue);
+            _Queue.clear();
+            _Busy = true;
+
+            lock.unlock();
+            batch.clear();
+            lock.lock();
+
+            _Busy = false;
+            _Idle.notify_all();
+        }
+    }
+
+    mutable std::mutex                                  _Mutex{};
+    std::condition_variable                             _Pending{};
+    std::condition_variable                             _Idle{};
+    std::vector<std::unique_ptr<detail::retired_base>> _Queue{};
+    bool                                                _Stop{ false };
+    bool                                                _Busy{ false };
+    std::thread                                         _Thread{};
+};
+
+inline reclaimer& default_reclaimer(void) {
+    static reclaimer instance{};
+    return instance;
+}
+
+template<typename Char, typename Traits, typename Allocator>
+inline void retire(basic_value<Char, Traits, Allocator>&& jvalue) {
+    default_reclaimer().retire(std::move(jvalue));
+}
+
+template<typename Char, typename Traits, typename Allocator>
+inline void retire(reclaimer& r, basic_value<Char, Traits, Allocator>&& jvalue) {
+    r.retire(std::move(jvalue));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 RW_JSON_NAMESPACE_END
 RW_NAMESPACE_END
 
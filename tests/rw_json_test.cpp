@@ -0,0 +1,439 @@
+//
+// RW_JSON_TEST
+// --------------
+//  Regression tests. Every test is a function that checks its expectations with CHECK, failures are printed
+//  with their line and make the run fail.
+//
+//  usage: rw_json_test
+//
+
+#include "rw-json.hpp"
+
+#include <atomic>
+#include <compare>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace {
+    using namespace rw::json;
+
+    int failures = 0;
+
+#define CHECK(condition)                                                                       \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++failures;                                                                        \
+        }                                                                                      \
+    } while (false)
+
+    value parse(std::string_view text, read_flags flags = read_flags::none) {
+        std::istringstream is{ std::string(text) };
+        reader r(is, flags);
+        value v{};
+        r >> v;
+        return v;
+    }
+
+    std::string write(const value& v, bool caching = false) {
+        std::ostringstream os{};
+        serializer s{};
+        s.caching(caching);
+        s(os, v);
+        return os.str();
+    }
+
+    // Documents written back as they were read.
+    void round_trip(void) {
+        const std::string_view text = R"({"a":[1,2.5,"x",true,null],"b":{"c":{}}})";
+        CHECK(write(parse(text)) == text);
+    }
+
+    // Integers above 2^53 that round to the same double hash differently and diff as changed.
+    void diff_above_2_53(void) {
+        const value a = parse(R"({"ids":[9007199254740993,1],"x":{"id":9007199254740993}})");
+        const value b = parse(R"({"ids":[9007199254740992,1],"x":{"id":9007199254740992}})");
+        CHECK(!(a == b));
+        CHECK(a.hash() != b.hash());
+        CHECK(write(patch::diff(a, b).to_value()) == R"([{"op":"replace","path":"/ids/0","value":9007199254740992},{"op":"replace","path":"/x/id","value":9007199254740992}])");
+        value patched = a;
+        patch::diff(a, b).apply(patched);
+        CHECK(patched == b);
+
+        const value packed_a = parse(R"({"ids":[9007199254740993,2,3]})", read_flags::pack_arrays);
+        const value packed_b = parse(R"({"ids":[9007199254740992,5,3,4]})", read_flags::pack_arrays);
+        CHECK(packed_a.object().at(key_view("ids")).array().packed());
+        CHECK(write(patch::diff(packed_a, packed_b).to_value()) == R"([{"op":"replace","path":"/ids/0","value":9007199254740992},{"op":"replace","path":"/ids/1","value":5},{"op":"add","path":"/ids/-","value":4}])");
+        CHECK(write(patch::diff(packed_a, parse(R"({"ids":[9007199254740993,2,3]})")).to_value()) == "[]");
+
+        const value one = parse("[1]");
+        const value real = parse("[1.0]");
+        CHECK(one == real);
+        CHECK(one.hash() == real.hash());
+        CHECK(!(parse("9007199254740993") == parse("9007199254740992.0")));
+    }
+
+    // Keys hold either their characters or a pool entry, and hash alike either way.
+    void key_storage(void) {
+        static_assert(sizeof(key) <= sizeof(std::string) + sizeof(void*));
+        key_pool pool{};
+        const key owned("name");
+        const key interned(pool.intern("name"));
+        CHECK(interned.interned() && !owned.interned());
+        CHECK(owned == interned && interned == key(pool.intern("name")));
+        CHECK(!(interned == key(pool.intern("other"))));
+        CHECK(owned.hash() == interned.hash() && owned.hash() == key_view("name").hash());
+        CHECK(std::string(key(std::string("moved")).str()) == "moved");
+    }
+
+    // Erasing keeps the index of large maps in step with the entries, keys cannot be changed in place.
+    void flat_map_erase(void) {
+        using map_type = basic_flat_map<std::string, int, std::hash<std::string>, std::equal_to<>>;
+        static_assert(std::is_const_v<std::remove_reference_t<decltype(std::declval<map_type&>().begin()->first)>>);
+
+        map_type map{};
+        std::vector<std::string> keys{};
+        for (int i = 0; i < 200; ++i) {
+            keys.push_back("key" + std::to_string(i));
+            map[keys.back()] = i;
+        }
+        std::uint32_t state = 1;
+        while (keys.size() > 10) {
+            state = state * 1664525 + 1013904223;
+            std::size_t victim = state % keys.size();
+            CHECK(map.erase(keys[victim]) == 1);
+            keys.erase(keys.begin() + static_cast<std::ptrdiff_t>(victim));
+            CHECK(map.size() == keys.size());
+            for (std::size_t i = 0; i < keys.size(); i += 7) {
+                CHECK(map.find(keys[i]) == map.begin() + static_cast<std::ptrdiff_t>(i));
+            }
+        }
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            CHECK((map.begin() + static_cast<std::ptrdiff_t>(i))->first == keys[i]);
+        }
+    }
+
+    // Edits through a reference kept from before hashing reach the cached hashes after invalidate().
+    void hash_retained_edits(void) {
+        value doc = parse(R"({"a":{"x":1,"y":[1,2]},"b":[{"z":true}]})");
+        value& x = doc.object()[key_view("a")].object()[key_view("x")];
+        value& z = doc.object()[key_view("b")].array()[0].object()[key_view("z")];
+        const std::size_t before = doc.hash();
+
+        x = parse("2");
+        z = parse("false");
+        doc.invalidate();
+        const std::size_t after = doc.hash();
+        CHECK(after != before);
+        CHECK(after == parse(R"({"a":{"x":2,"y":[1,2]},"b":[{"z":false}]})").hash());
+        CHECK(doc.object().at(key_view("a")).object().cached_hash() != 0);
+    }
+
+    // Erasing past the end of a shared array throws and leaves it as it was.
+    void shared_erase(void) {
+        const shared_value list = shared_value{}.push_back(shared_value{}).push_back(shared_value{});
+        bool threw = false;
+        try {
+            list.erase(2);
+        }
+        catch (const std::out_of_range&) {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(list.size() == 2);
+        CHECK(list.erase(1).size() == 1);
+    }
+
+    // Tape containers count their elements in their end word and skip to it in one step.
+    void tape_containers(void) {
+        std::string text = R"({"big":[)";
+        for (int i = 0; i < 1000; ++i) {
+            text += std::string(i == 0 ? "" : ",") + R"({"n":)" + std::to_string(i) + "}";
+        }
+        text += R"(],"s":"after","e":{}})";
+
+        std::istringstream is{ text };
+        reader r(is);
+        basic_tape<char> tape{};
+        r >> tape;
+        CHECK(tape.root().size() == 3);
+        CHECK(tape.root().at_key("big").size() == 1000);
+        CHECK(tape.root().at_key("big").at_index(999).at_key("n").number() == 999);
+        CHECK(tape.root().at_key("s").string() == "after");
+        CHECK(tape.root().at_key("e").size() == 0);
+        CHECK(tape.value() == parse(text));
+    }
+
+    // Offsets read from a snapshot image are checked for alignment before their elements are referenced.
+    void snapshot_alignment(void) {
+        auto corrupt = [](std::span<const std::byte> image, std::uint64_t kind, std::uint64_t length) {
+            // Moves the root by half its alignment and writes a header of kind there.
+            std::vector<std::uint64_t> words(image.size() / sizeof(std::uint64_t));
+            std::memcpy(words.data(), image.data(), image.size());
+            std::uint64_t root = words[1] + 2;
+            std::uint64_t head = (length << 8) | kind;
+            std::memcpy(reinterpret_cast<std::byte*>(words.data()) + root, &head, sizeof(head));
+            words[1] = root;
+            return words;
+        };
+        auto throws = [](auto&& read) {
+            try {
+                read();
+            }
+            catch (const std::out_of_range&) {
+                return true;
+            }
+            return false;
+        };
+
+        const snapshot packed(parse("[1,2,3]"));
+        CHECK(packed.root().span<std::int64_t>().size() == 3);
+        const std::vector<std::uint64_t> ints = corrupt(packed.image(), 9, 1);
+        const snapshot misaligned_ints(std::as_bytes(std::span(ints)));
+        CHECK(throws([&] { (void)misaligned_ints.root().span<std::int64_t>(); }));
+
+        wvalue text{};
+        text << std::wstring(L"hello");
+        const wsnapshot wide(text);
+        CHECK(wide.root().string() == L"hello");
+        const std::vector<std::uint64_t> chars = corrupt(wide.image(), 7, 1);
+        const wsnapshot misaligned_chars(std::as_bytes(std::span(chars)));
+        CHECK(throws([&] { (void)misaligned_chars.root().string(); }));
+    }
+
+    // Integers and floating numbers are ordered exactly, conversions saturate instead of overflowing.
+    void number_order(void) {
+        const number big(std::int64_t{ 9007199254740993 });
+        const number rounded(9007199254740992.0);
+        CHECK((big <=> rounded) > 0);
+        CHECK((rounded <=> big) < 0);
+        CHECK(!(big == rounded));
+        CHECK((number(2) <=> 2.5) < 0);
+        CHECK((number(-3) <=> -2.5) < 0);
+        CHECK((number(3) <=> 3.0) == 0);
+        CHECK((number(std::uint64_t{ 18446744073709551615u }) <=> 1.8446744073709552e19) < 0);
+        CHECK((number(1) <=> std::numeric_limits<double>::quiet_NaN()) == std::partial_ordering::unordered);
+
+        CHECK(number(1e30).as<int>() == std::numeric_limits<int>::max());
+        CHECK(number(-1e300).as<std::int64_t>() == std::numeric_limits<std::int64_t>::min());
+        CHECK(number(-5.0).as<std::size_t>() == 0);
+        CHECK(number(1e300).as<float>() == std::numeric_limits<float>::infinity());
+        CHECK(number(std::int64_t{ 300 }).as<std::int8_t>() == 127);
+        CHECK(number(std::numeric_limits<double>::quiet_NaN()).as<int>() == 0);
+        int narrow = 0;
+        parse("1e300") >> narrow;
+        CHECK(narrow == std::numeric_limits<int>::max());
+    }
+
+    // Packed integer arrays only turn into packed floats when every integer survives the conversion.
+    void pack_above_2_53(void) {
+        const std::string_view mixed = "[1,2,3.5,9007199254740993]";
+        CHECK(write(parse(mixed, read_flags::pack_arrays)) == mixed);
+        CHECK(write(parse("[1,9007199254740993,3.5]", read_flags::pack_arrays)) == "[1,9007199254740993,3.5]");
+        CHECK(write(parse("[3.5,9007199254740993,1]", read_flags::pack_arrays)) == "[3.5,9007199254740993,1]");
+
+        value packed = parse("[1,2,3.5]", read_flags::pack_arrays);
+        CHECK(packed.array().packed<array::float_type>());
+
+        value plain = parse(mixed);
+        CHECK(!plain.array().pack());
+        CHECK(write(plain) == mixed);
+    }
+
+    // Const access reads packed arrays in place, spans taken before stay valid.
+    void const_packed_access(void) {
+        const value doc = parse(R"({"ids":[1,2,3]})", read_flags::pack_arrays);
+        const array& ids = doc.object().at(key_view("ids")).array();
+        const auto span = ids.span<array::integer_type>();
+
+        std::int64_t sum = 0;
+        for (const value& element : ids) {
+            sum += element.number().as<std::int64_t>();
+        }
+        CHECK(sum == 6);
+        CHECK(ids.element(2) == parse("3"));
+        CHECK(ids.packed());
+        CHECK(span.data() == ids.span<array::integer_type>().data());
+
+        const path all = path::parse("$.ids[*]");
+        std::size_t matches = 0;
+        for (const value& element : all.match(doc)) {
+            matches += element.is_number() ? 1 : 0;
+        }
+        CHECK(matches == 3);
+        CHECK(ids.packed());
+    }
+
+    // Cached writes splice unchanged containers from a single copy of the text and rewrite modified paths.
+    void caching_nested_edits(void) {
+        std::string text{};
+        for (int i = 0; i < 200; ++i) {
+            text += R"({"pad":"padding that makes every level long enough to be cached","child":[)";
+        }
+        text += "null";
+        for (int i = 0; i < 200; ++i) {
+            text += "]}";
+        }
+
+        value doc = parse(text);
+        CHECK(write(doc, true) == text);
+        CHECK(write(doc, true) == text);
+        CHECK(memory_usage(doc).caches < 4 * text.size());
+
+        value* node = &doc;
+        for (int i = 0; i < 100; ++i) {
+            node = &node->object()[key_view("child")].array()[0];
+        }
+        node->object()[key_view("pad")].to_string() = "changed";
+        CHECK(write(doc, true) == write(doc));
+        CHECK(write(doc, true).find("changed") != std::string::npos);
+    }
+
+    // Edits through a reference kept from before a write reach the text only after invalidate().
+    void caching_retained_edits(void) {
+        const std::string text = R"({"a":{"x":1,"pad":"padding that makes the object long enough to be cached"},"b":[true]})";
+        value doc = parse(text);
+        value& x = doc.object()[key_view("a")].object()[key_view("x")];
+        CHECK(write(doc, true) == text);
+
+        x = parse("2");
+        doc.invalidate();
+        CHECK(write(doc, true) == write(doc));
+        CHECK(write(doc, true).find(R"("x":2)") != std::string::npos);
+    }
+
+    // Concurrent caching writes of one value all produce its text.
+    void caching_concurrent_writes(void) {
+        std::string text = "[";
+        for (int i = 0; i < 64; ++i) {
+            text += std::string(i == 0 ? "" : ",") + R"({"id":)" + std::to_string(i) + R"(,"pad":"padding that makes every element long enough to be cached","tags":[1,2,3]})";
+        }
+        text += "]";
+
+        const value doc = parse(text);
+        std::atomic<int> wrong{ 0 };
+        std::vector<std::thread> threads{};
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&] {
+                for (int i = 0; i < 200; ++i) {
+                    wrong += write(doc, true) != text ? 1 : 0;
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        CHECK(wrong == 0);
+    }
+
+    // Non-const matches unpack a packed array only when they are its elements, integer literals are exact.
+    void path_matches(void) {
+        value doc = parse(R"({"ids":[1,2,3],"items":[{"id":9007199254740992},{"id":9007199254740993}]})", read_flags::pack_arrays);
+        const array& ids = doc.object().at(key_view("ids")).array();
+        CHECK(ids.packed());
+
+        CHECK(path::parse("$.ids[1].x").find(doc) == nullptr);
+        CHECK(path::parse("$.ids[?(@.x)]").find(doc) == nullptr);
+        CHECK(path::parse("$.ids[*].x").find(doc) == nullptr);
+        CHECK(ids.packed());
+
+        value* match = path::parse("$.ids[1]").find(doc);
+        CHECK(!ids.packed());
+        CHECK(match == &doc.object()[key_view("ids")].array()[1]);
+
+        const value* item = path::parse("$.items[?(@.id == 9007199254740993)]").find(doc);
+        CHECK(item != nullptr && write(*item) == R"({"id":9007199254740993})");
+        const path below = path::parse("$.items[?(@.id < 9007199254740993)]");
+        int count = 0;
+        for (const value& v : below.match(std::as_const(doc))) {
+            count += write(v) == R"({"id":9007199254740992})" ? 1 : 0;
+        }
+        CHECK(count == 1);
+    }
+
+    // Destroying a document is iterative, however deep it is.
+    void deep_destruction(void) {
+        value doc{};
+        value* node = &doc;
+        for (int i = 0; i < 200000; ++i) {
+            node = i % 2 == 0 ? &node->to_array().get().emplace_back() : &node->to_object()[key_view("c")];
+        }
+        *node = parse("[1,2,3]");
+        doc = value{};
+        CHECK(doc.is_null());
+    }
+
+    // A patch that fails part way leaves the document as it was.
+    void patch_rollback(void) {
+        const std::string_view text = R"({"a":1,"b":[1,2,3],"c":{"d":true}})";
+        const value original = parse(text);
+
+        auto fails = [&](patch p) {
+            value doc = parse(text);
+            bool threw = false;
+            try {
+                p.apply(doc);
+            }
+            catch (const std::exception&) {
+                threw = true;
+            }
+            CHECK(threw);
+            CHECK(doc == original);
+            CHECK(write(doc) == text);
+        };
+
+        fails(patch{}.move("/a", "/x/y"));
+        fails(patch{}.move("/b/0", "/c/d/e"));
+        fails(patch{}.remove("/b/1").add("/c/e", parse("5")).add("/missing/f", parse("6")));
+        fails(patch{}.remove("/a").replace("/c/d", parse("false")).test("/b/0", parse("2")));
+        fails(patch{}.move("/c", "/z").copy("/b", "/y").test("/z/d", parse("false")));
+
+        value doc = parse(text);
+        patch{}.move("/a", "/c/a").remove("/b/0").apply(doc);
+        CHECK(write(doc) == R"({"b":[2,3],"c":{"d":true,"a":1}})");
+    }
+}
+
+int main(void) {
+    try {
+        round_trip();
+        diff_above_2_53();
+        key_storage();
+        flat_map_erase();
+        hash_retained_edits();
+        shared_erase();
+        tape_containers();
+        snapshot_alignment();
+        number_order();
+        pack_above_2_53();
+        const_packed_access();
+        caching_nested_edits();
+        caching_retained_edits();
+        caching_concurrent_writes();
+        path_matches();
+        deep_destruction();
+        patch_rollback();
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "rw_json_test: %s\n", e.what());
+        return 1;
+    }
+    if (failures != 0) {
+        std::fprintf(stderr, "rw_json_test: %d checks failed\n", failures);
+        return 1;
+    }
+    return 0;
+}